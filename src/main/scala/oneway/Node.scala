@@ -27,7 +27,8 @@ class Node(n: Int, size: Int) extends Module {
   val end = regTdmCounter === UInt(scheduleLength - 1)
   regTdmCounter := Mux(end, UInt(0), regTdmCounter + UInt(1))
 
-  val nrChannels = n * n - 1
+  // one channel for each injection, more than n * n - 1 in a weighted schedule
+  val nrChannels = st._2.count(v => v)
   val blockAddrWidth = log2Down(size/nrChannels)
   println(blockAddrWidth.toShort)
   println("Memory block size: " + scala.math.pow(2, blockAddrWidth).toInt)
@@ -28,7 +28,11 @@ object Schedule {
       case 2 => ScheduleTable.FourNodes
       case 3 => ScheduleTable.NineNodes
       case 4 => ScheduleTable.SixTeenNodes
-      case _ => throw new Error("Currently only 2x2, 3x3, and 4x4 NoCs supported, you requested: "+n+"x"+n)
+      case 5 => ScheduleTable.TwentyFiveNodes
+      case 6 => ScheduleTable.ThirtySixNodes
+      case 7 => ScheduleTable.FortyNineNodes
+      case 8 => ScheduleTable.SixtyFourNodes
+      case _ => throw new Error("Currently only 2x2 up to 8x8 NoCs supported, you requested: "+n+"x"+n)
     }
 
     def port(c: Char) = {
@@ -70,9 +74,10 @@ object Schedule {
         }
       }
     }
+    // the last route may be injected before the last but one cycle
     var line = 0
     for (i <- 0 until len - 1) {
-      valid(i) = split(line)(i) != ' '
+      valid(i) = line < split.length && i < split(line).length && split(line)(i) != ' '
       if (valid(i)) line += 1
     }
     println("Schedule is " + schedule.length + " clock cycles")
@@ -52,6 +52,188 @@ object ScheduleTable {
     "                sl|" +
     "                 wl|"
 
+  // 5x5 torus, schedule length 27, from onewaymem-schedule.c -i 200000 -f scala 5 5
+  val TwentyFiveNodes =
+    "wsl|" +
+    " enel|" +
+    "  wl|" +
+    "   swsl|" +
+    "    nl|" +
+    "     nnl|" +
+    "      wwl|" +
+    "       swwl|" +
+    "        sl|" +
+    "         nel|" +
+    "          nwl|" +
+    "           sseel|" +
+    "            el|" +
+    "             wwnl|" +
+    "              sswwl|" +
+    "               eel|" +
+    "                nneel|" +
+    "                 esl|" +
+    "                  nnel|" +
+    "                   wnnl|" +
+    "                    wwnnl|" +
+    "                     ssl|" +
+    "                      esel|" +
+    "                       essl|"
+
+  // 6x6 torus, schedule length 39, from onewaymem-schedule.c -i 200000 -f scala 6 6
+  val ThirtySixNodes =
+    "sssl|" +
+    " eenel|" +
+    "  neneel|" +
+    "   sl|" +
+    "    sswsl|" +
+    "     wl|" +
+    "      nnwwl|" +
+    "       esl|" +
+    "        esssel|" +
+    "         eeel|" +
+    "          nl|" +
+    "           wssl|" +
+    "            nwnl|" +
+    "             esel|" +
+    "              enel|" +
+    "               wwsl|" +
+    "                sessl|" +
+    "                 nnl|" +
+    "                  eeessl|" +
+    "                   wsl|" +
+    "                    nel|" +
+    "                     wwsssl|" +
+    "                      eel|" +
+    "                       wwl|" +
+    "                        eesssel|" +
+    "                         nnel|" +
+    "                          el|" +
+    "                           wnl|" +
+    "                            essl|" +
+    "                             wwnl|" +
+    "                              eennl|" +
+    "                               ssl|" +
+    "                                eessl|" +
+    "                                 seeel|" +
+    "                                  wwssl|"
+
+  // 7x7 torus, schedule length 52, from onewaymem-schedule.c -i 200000 -f scala 7 7
+  val FortyNineNodes =
+    "wnnnl|" +
+    " swswl|" +
+    "  sl|" +
+    "   esesel|" +
+    "    nwl|" +
+    "     swl|" +
+    "      essl|" +
+    "       wwssswl|" +
+    "        eel|" +
+    "         wnwnwl|" +
+    "          el|" +
+    "           nl|" +
+    "            ssswwl|" +
+    "             nwnnwwl|" +
+    "              esl|" +
+    "               esel|" +
+    "                essel|" +
+    "                 nennl|" +
+    "                  nwwwl|" +
+    "                   ssswl|" +
+    "                    enenel|" +
+    "                     enel|" +
+    "                      sswwwl|" +
+    "                       wnnl|" +
+    "                        sseesl|" +
+    "                         ennneel|" +
+    "                          ssl|" +
+    "                           wwwl|" +
+    "                            ennnel|" +
+    "                             swwl|" +
+    "                              sesseel|" +
+    "                               swwwl|" +
+    "                                nnl|" +
+    "                                 esssl|" +
+    "                                  nwnwl|" +
+    "                                   neeel|" +
+    "                                     nnnl|" +
+    "                                      seeel|" +
+    "                                       wwl|" +
+    "                                        sswl|" +
+    "                                         nneel|" +
+    "                                          enl|" +
+    "                                           sssl|" +
+    "                                            wnnnwl|" +
+    "                                             eeel|" +
+    "                                              wl|" +
+    "                                               wnwl|" +
+    "                                                ennl|"
+
+  // 8x8 torus, schedule length 82, from onewaymem-schedule.c -i 200000 -f scala 8 8
+  val SixtyFourNodes =
+    "sseesseel|" +
+    " enneel|" +
+    "  sswwsswl|" +
+    "   wl|" +
+    "    nl|" +
+    "     nwl|" +
+    "      nwnnl|" +
+    "       neenneel|" +
+    "        sseessel|" +
+    "         wwwl|" +
+    "          sl|" +
+    "           swl|" +
+    "            nwwwl|" +
+    "             nnnel|" +
+    "              ssssel|" +
+    "               enel|" +
+    "                wnnwwl|" +
+    "                 wwnl|" +
+    "                  ssssl|" +
+    "                   eeesel|" +
+    "                    nnnwwwl|" +
+    "                     wwl|" +
+    "                      eseeesl|" +
+    "                       nnl|" +
+    "                        sssl|" +
+    "                         nneeeel|" +
+    "                          wwsl|" +
+    "                           nnnl|" +
+    "                            wsswl|" +
+    "                             wnnnwl|" +
+    "                              wssssl|" +
+    "                               eel|" +
+    "                                wnnwl|" +
+    "                                 eeeel|" +
+    "                                  wswswl|" +
+    "                                   nnneeel|" +
+    "                                    sel|" +
+    "                                     wnnl|" +
+    "                                      sswsl|" +
+    "                                       wswwl|" +
+    "                                         eeel|" +
+    "                                          swsl|" +
+    "                                           seel|" +
+    "                                            nneel|" +
+    "                                             ssl|" +
+    "                                              wsswsl|" +
+    "                                               nnel|" +
+    "                                                el|" +
+    "                                                 sessel|" +
+    "                                                  nel|" +
+    "                                                   nnneel|" +
+    "                                                    essl|" +
+    "                                                      wsswwsl|" +
+    "                                                       neeel|" +
+    "                                                         sseel|" +
+    "                                                            seeel|" +
+    "                                                             sssel|" +
+    "                                                              wwssssl|" +
+    "                                                                neeeel|" +
+    "                                                                    sseeel|" +
+    "                                                                     essseel|" +
+    "                                                                         ssseeeel|" +
+    "                                                                           essssel|"
+
   def main(args: Array[String]): Unit = {
     var cnt = Source.fromFile(args(0)).getLines.length
     val lines = Source.fromFile(args(0)).getLines
@@ -21,6 +21,11 @@ object ScheduleTester {
         assert(slotref(j) == slottest(j))
       }
     }
+    // each node injects one word for every other node
+    for (n <- 2 to 8) {
+      val valid = Schedule.getSchedule(n)._2
+      assert(valid.count(v => v) == n * n - 1)
+    }
     println("Schedule test PASSED")
   }
 
@@ -0,0 +1,357 @@
+//onewaychannel.hpp
+#ifndef ONEWAYCHANNEL_HPP
+#define ONEWAYCHANNEL_HPP
+
+#include <string.h>
+#include <type_traits>
+#include "onewaysim.h"
+#include "onewaylatency.h"
+
+#if __cplusplus < 201703L
+#error "onewaychannel.hpp needs C++17"
+#endif
+
+// Typed channels between two cores of a fixed schedule, for C++17 code on
+// top of the C layer. The use-cases work on the raw words of core[].tx and
+// core[].rx, and a wrong offset or a payload that does not fit into a slot
+// only shows up when they run. Here the payload is a type, the cores are
+// template parameters, and the layout is checked against WORDS when the
+// channel type is instantiated. The slots of the channel come from the
+// route string (ROUTESSTRING) at compile time, as txrxmapsinit() finds them
+// at run time, so a channel between two cores without a slot does not
+// compile, and send() and receive() index core[] with constants and do the
+// same loads and stores as the loops of the use-cases.
+//
+//   TypedChannel<T, TX, RX, W>: the latest value of T from core TX to core
+//     RX, at words W .. W + words of T + 1 of their slot. The rx core takes
+//     each value at most once and may miss values that are overwritten before
+//     it has them (a sampled state, like the slots themselves). The tx core
+//     writes a value at most every three latency bounds, so that the rx core
+//     can take most of them.
+//   RingChannel<T, DEPTH, TX, RX, W>: a stream of T with DEPTH buffers and
+//     credits back, as in use-case 6: the credit in word W of the slot from
+//     RX to TX, and the buffers after word W of the slot from TX to RX. The
+//     tx core only writes into a free buffer, so no value is lost.
+//
+// The values are written like the buffers of use-case 6: the tail sequence
+// number and the payload first and the head sequence number last. The NI
+// sends word w of a slot in period w of each hyperperiod, so a value can
+// arrive over two hyperperiods, and head == tail can show around old payload
+// words. The rx core takes a value one hyperperiod after it first sees head
+// == tail (see bufsettled in onewaylatency.h). A TypedChannel is also
+// overwritten while the rx core reads it, so the rx core copies the value
+// then and keeps the copy only when head and tail are unchanged one latency
+// bound later (a seqlock over the NoC), when any word of a later value that
+// came before the copy has been followed by its head. Each end has init(),
+// which clears its words, and wait(), the wait hint for its next event.
+
+namespace oneway {
+
+// the schedule of ROUTESSTRING at compile time
+namespace schedule {
+
+constexpr char routes[] = ROUTESSTRING;
+
+// first character of the route of slot
+constexpr int routestart(int slot) {
+  int i = 0;
+  for (int s = 0; s < slot; s++) {
+    while (routes[i] != '|')
+      i++;
+    i++;
+  }
+  return i;
+}
+
+// the length of the route of slot with its leading spaces (the arrival
+// cycle of its word)
+constexpr int routelength(int slot) {
+  int stop = routestart(slot);
+  while (routes[stop] != '|')
+    stop++;
+  return stop - routestart(slot);
+}
+
+// the rx NI fills its slots in the order of the route lengths
+constexpr int rxslotoftxslot(int txslot) {
+  int rxslot = 0;
+  for (int i = 0; i < TDMSLOTS; i++)
+    if (routelength(i) < routelength(txslot))
+      rxslot++;
+  return rxslot;
+}
+
+// the core at the end of the route of txslot from txcore (the grids wrap
+// around, and a cluster is a grid of its own)
+constexpr int rxcore(int txcore, int txslot) {
+  int base = txcore - txcore % CLUSTERCORES;
+  int row = (txcore - base) / GRIDCOLS;
+  int col = (txcore - base) % GRIDCOLS;
+  for (int i = routestart(txslot); routes[i] != '|'; i++) {
+    switch (routes[i]) {
+      case 'n': row = (row - 1 >= 0) ? row - 1 : GRIDROWS - 1; break;
+      case 's': row = (row + 1 < GRIDROWS) ? row + 1 : 0; break;
+      case 'e': col = (col + 1 < GRIDCOLS) ? col + 1 : 0; break;
+      case 'w': col = (col - 1 >= 0) ? col - 1 : GRIDCOLS - 1; break;
+    }
+  }
+  return base + row * GRIDCOLS + col;
+}
+
+// the first tx slot from txcore to rxcore, and its rx slot on rxcore (-1
+// for none), like gettxslotfromtxcorerxcoreslot(txcore, rxcore, -1) and
+// getrxslotfromrxcoretxcoreslot(rxcore, txcore, txslot)
+constexpr int txslot(int txcore, int rxcore) {
+  if (txcore < 0 || txcore >= CORES || rxcore < 0 || rxcore >= CORES)
+    return -1;
+  for (int s = 0; s < TDMSLOTS; s++)
+    if (schedule::rxcore(txcore, s) == rxcore)
+      return s;
+  return -1;
+}
+
+constexpr int rxslot(int rxcore, int txcore) {
+  int s = txslot(txcore, rxcore);
+  return (s < 0) ? -1 : rxslotoftxslot(s);
+}
+
+} // namespace schedule
+
+// the words of a payload type
+template <typename T>
+constexpr int payloadwords() {
+  static_assert(std::is_trivially_copyable<T>::value, "a payload is copied word by word");
+  static_assert(sizeof(T) % sizeof(int) == 0, "a payload is whole words");
+  return sizeof(T) / sizeof(int);
+}
+
+// copy a payload into and out of the words of a slot (the memcpy to and from
+// the local words folds away)
+template <typename T>
+inline void slotwrite(volatile _SPM int *words, const T &value) {
+  int local[payloadwords<T>()];
+  memcpy(local, &value, sizeof(T));
+  for (int k = 0; k < payloadwords<T>(); k++)
+    words[k] = local[k];
+}
+
+template <typename T>
+inline void slotread(const volatile _SPM int *words, T &value) {
+  int local[payloadwords<T>()];
+  for (int k = 0; k < payloadwords<T>(); k++)
+    local[k] = words[k];
+  memcpy(&value, local, sizeof(T));
+}
+
+template <typename T, int TX, int RX, int W = 0>
+struct TypedChannel {
+  // words: head, payload, tail
+  static constexpr int words = payloadwords<T>();
+  static constexpr int head = W;
+  static constexpr int payload = W + 1;
+  static constexpr int tail = W + 1 + words;
+  // the first word after the channel
+  static constexpr int end = W + words + 2;
+  static constexpr int txslot = schedule::txslot(TX, RX);
+  static constexpr int rxslot = schedule::rxslot(RX, TX);
+
+  static_assert(W >= 0 && end <= WORDS, "the channel does not fit into a slot of WORDS words");
+  static_assert(txslot >= 0, "no slot from core TX to core RX in this schedule");
+
+  // first sight, settled copy, and check of a value fit between two values
+  static constexpr int gapbounds = 3;
+
+  // the end on core TX
+  class Tx {
+   public:
+    void init() {
+      seq = 0;
+      gap = gapbounds * getlatencybound(TX, RX);
+      next = 0;
+      slot()[head] = 0;
+      slot()[tail] = 0;
+    }
+
+    // the time for the next value has come
+    bool ready() const { return (int)(getnoccycles() - next) >= 0; }
+
+    // false when the value before is too recent
+    bool send(const T &value) {
+      if (!ready())
+        return false;
+      next = getnoccycles() + gap;
+      volatile _SPM int *s = slot();
+      seq++;
+      s[tail] = seq;
+      slotwrite(s + payload, value);
+      s[head] = seq;
+      return true;
+    }
+
+    void wait() { waitnoccycles(TX, next); }
+
+   private:
+    static volatile _SPM int *slot() { return core[TX].tx[txslot]; }
+    unsigned int seq;
+    // noc cycles between two values, and the noc cycle of the next value
+    unsigned int gap;
+    unsigned int next;
+  };
+
+  // the end on core RX
+  class Rx {
+   public:
+    void init() {
+      seq = 0;
+      bound = getlatencybound(TX, RX);
+      nextseq = 0;
+      settle = 0;
+      check = 0;
+    }
+
+    // the value when a new one has arrived, settled, and stayed
+    bool receive(T &value) {
+      const volatile _SPM int *s = core[RX].rx[rxslot];
+      unsigned int h = s[head];
+      unsigned int now = getnoccycles();
+      if (check != 0) {
+        if ((int)(now - check) < 0)
+          return false;
+        check = 0;
+        settle = 0;
+        // a later value has come over the copy
+        if (h != nextseq || (unsigned int)s[tail] != h)
+          return false;
+        value = copy;
+        seq = h;
+        return true;
+      }
+      if (h == seq || (unsigned int)s[tail] != h)
+        return false;
+      // a new value settles from its first sight
+      if (h != nextseq) {
+        nextseq = h;
+        settle = 0;
+      }
+      if (!bufsettled(&settle))
+        return false;
+      slotread(s + payload, copy);
+      check = now + bound;
+      // 0 means no copy
+      check = (check == 0) ? 1 : check;
+      return false;
+    }
+
+    void wait() {
+      waitrx(RX, rxslot, head);
+      if (check != 0)
+        waitnoccycles(RX, check);
+      else if (settle != 0)
+        waitnoccycles(RX, settle);
+    }
+
+   private:
+    unsigned int seq;
+    // the latency bound of the channel, the value that showed up, the noc
+    // cycle when it is whole (see bufsettled), the noc cycle when its copy is
+    // checked (0 while there is no copy), and the copy
+    unsigned int bound;
+    unsigned int nextseq;
+    unsigned int settle;
+    unsigned int check;
+    T copy;
+  };
+};
+
+template <typename T, int DEPTH, int TX, int RX, int W = 0>
+struct RingChannel {
+  // the credit word, then DEPTH buffers of head, payload, tail
+  static constexpr int words = payloadwords<T>();
+  static constexpr int ack = W;
+  static constexpr int bufwords = words + 2;
+  static constexpr int end = W + 1 + DEPTH * bufwords;
+  static constexpr int txslot = schedule::txslot(TX, RX);
+  static constexpr int rxslot = schedule::rxslot(RX, TX);
+  // the slots of the credit
+  static constexpr int acktxslot = schedule::txslot(RX, TX);
+  static constexpr int ackrxslot = schedule::rxslot(TX, RX);
+
+  static_assert(DEPTH >= 1, "a ring has at least one buffer");
+  static_assert(W >= 0 && end <= WORDS, "the buffers do not fit into a slot of WORDS words");
+  static_assert(txslot >= 0 && acktxslot >= 0, "no slots between core TX and core RX in this schedule");
+
+  // first word of the buffer for sequence number seq
+  static constexpr int buf(unsigned int seq) {
+    return W + 1 + (int)((seq - 1) % DEPTH) * bufwords;
+  }
+
+  // the end on core TX
+  class Tx {
+   public:
+    void init() { seq = 0; }
+
+    // a buffer is free when the credit of the value DEPTH before it is back
+    bool full() const {
+      unsigned int credit = core[TX].rx[ackrxslot][ack];
+      return seq + 1 - credit > DEPTH;
+    }
+
+    // false when all buffers are taken
+    bool send(const T &value) {
+      if (full())
+        return false;
+      unsigned int next = seq + 1;
+      volatile _SPM int *b = core[TX].tx[txslot] + buf(next);
+      b[bufwords - 1] = next;
+      slotwrite(b + 1, value);
+      b[0] = next;
+      seq = next;
+      return true;
+    }
+
+    void wait() { waitrx(TX, ackrxslot, ack); }
+
+   private:
+    unsigned int seq;
+  };
+
+  // the end on core RX, init() clears its credit
+  class Rx {
+   public:
+    void init() {
+      seq = 0;
+      settle = 0;
+      core[RX].tx[acktxslot][ack] = 0;
+    }
+
+    // the next value when it has arrived and settled, and its credit back
+    bool receive(T &value) {
+      unsigned int next = seq + 1;
+      const volatile _SPM int *b = core[RX].rx[rxslot] + buf(next);
+      if ((unsigned int)b[0] != next || (unsigned int)b[bufwords - 1] != next)
+        return false;
+      if (!bufsettled(&settle))
+        return false;
+      settle = 0;
+      slotread(b + 1, value);
+      seq = next;
+      core[RX].tx[acktxslot][ack] = seq;
+      return true;
+    }
+
+    void wait() {
+      waitrx(RX, rxslot, buf(seq + 1));
+      if (settle != 0)
+        waitnoccycles(RX, settle);
+    }
+
+   private:
+    unsigned int seq;
+    // noc cycle when the next value is whole (see bufsettled)
+    unsigned int settle;
+  };
+};
+
+} // namespace oneway
+
+#endif
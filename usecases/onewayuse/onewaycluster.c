@@ -0,0 +1,166 @@
+//onewaycluster.c
+#include "onewaycluster.h"
+#include "onewaylatency.h"
+
+// the routing table, written by the core that adds the routes
+static _UNCACHED int nclusterroutes;
+static _UNCACHED ClusterRoute clusterroutes[CLUSTERROUTESMAX];
+// channel words and bridge words that the routes use
+static _UNCACHED int channelused[CORES][CORES];
+static _UNCACHED int bridgeused[CLUSTERS][CLUSTERS];
+// the bridges from cluster to cluster
+static volatile _UNCACHED int bridges[CLUSTERS][CLUSTERS][BRIDGEWORDS];
+
+int getcluster(int core) {
+  return core / CLUSTERCORES;
+}
+
+// the gateways of a cluster are its first cores, one for each other cluster
+int getgateway(int cluster, int tocluster) {
+  return cluster * CLUSTERCORES + (tocluster - cluster + CLUSTERS) % CLUSTERS - 1;
+}
+
+void clusterroutesreset() {
+  nclusterroutes = 0;
+  for (int i = 0; i < CORES; i++)
+    for (int j = 0; j < CORES; j++)
+      channelused[i][j] = 0;
+  for (int i = 0; i < CLUSTERS; i++)
+    for (int j = 0; j < CLUSTERS; j++)
+      bridgeused[i][j] = 0;
+}
+
+// the channel word where n words from txcore to rxcore fit into one slot,
+// or -1
+static int channelfit(int txcore, int rxcore, int n) {
+  Channel ch;
+  channelinit(&ch, txcore, rxcore);
+  int w = channelused[txcore][rxcore];
+  if (w % WORDS + n > WORDS)
+    w += WORDS - w % WORDS;
+  return (n <= WORDS && w + n <= CHANNELWORDS(&ch)) ? w : -1;
+}
+
+int clusterrouteadd(int src, int dst, int words) {
+  if (nclusterroutes == CLUSTERROUTESMAX || src == dst || words <= 0)
+    return -1;
+  ClusterRoute r = {src, dst, words, -1, -1, -1, -1, -1};
+  int first = dst;
+  int last = src;
+  if (getcluster(src) != getcluster(dst)) {
+    r.gatewayout = getgateway(getcluster(src), getcluster(dst));
+    r.gatewayin = getgateway(getcluster(dst), getcluster(src));
+    first = r.gatewayout;
+    last = r.gatewayin;
+    r.bridgeoffset = bridgeused[getcluster(src)][getcluster(dst)];
+    if (r.bridgeoffset + words > BRIDGEWORDS)
+      return -1;
+  }
+  // the windows on the NoC (none from a gateway that is the source, or to a
+  // gateway that is the destination)
+  if (first != src) {
+    r.txoffset = channelfit(src, first, words);
+    if (r.txoffset < 0)
+      return -1;
+  }
+  if (last != dst) {
+    r.rxoffset = (last == src) ? r.txoffset : channelfit(last, dst, words);
+    if (r.rxoffset < 0)
+      return -1;
+  }
+
+  if (first != src)
+    channelused[src][first] = r.txoffset + words;
+  if (last != dst)
+    channelused[last][dst] = r.rxoffset + words;
+  if (r.gatewayout >= 0)
+    bridgeused[getcluster(src)][getcluster(dst)] += words;
+  clusterroutes[nclusterroutes] = r;
+  return nclusterroutes++;
+}
+
+int getclusterroutes() {
+  return nclusterroutes;
+}
+
+ClusterRoute getclusterroute(int id) {
+  return clusterroutes[id];
+}
+
+// the tx and rx words of a channel window
+static volatile _SPM int *channeltx(int txcore, int rxcore, int w) {
+  Channel ch;
+  channelinit(&ch, txcore, rxcore);
+  return &CHANNELTX(&ch, w);
+}
+
+static volatile _SPM int *channelrx(int txcore, int rxcore, int w) {
+  Channel ch;
+  channelinit(&ch, txcore, rxcore);
+  return &CHANNELRX(&ch, w);
+}
+
+// the bridge words of a route
+#define BRIDGE(r, i) bridges[getcluster((r).src)][getcluster((r).dst)][(r).bridgeoffset + (i)]
+
+void clusterwrite(int id, const unsigned int *data) {
+  ClusterRoute r = clusterroutes[id];
+  if (r.gatewayout == r.src) {
+    for (int i = 0; i < r.words; i++)
+      BRIDGE(r, i) = data[i];
+  } else {
+    volatile _SPM int *to = channeltx(r.src, r.gatewayout >= 0 ? r.gatewayout : r.dst, r.txoffset);
+    for (int i = 0; i < r.words; i++)
+      to[i] = data[i];
+  }
+}
+
+void clusterread(int id, unsigned int *data) {
+  ClusterRoute r = clusterroutes[id];
+  if (r.gatewayin == r.dst) {
+    for (int i = 0; i < r.words; i++)
+      data[i] = BRIDGE(r, i);
+  } else {
+    volatile _SPM int *from = channelrx(r.gatewayin >= 0 ? r.gatewayin : r.src, r.dst, r.rxoffset);
+    for (int i = 0; i < r.words; i++)
+      data[i] = from[i];
+  }
+}
+
+int clusterforward(int cpuid) {
+  int words = 0;
+  for (int id = 0; id < nclusterroutes; id++) {
+    ClusterRoute r = clusterroutes[id];
+    // from the rx slot of the source to the bridge
+    if (r.gatewayout == cpuid && r.src != cpuid) {
+      volatile _SPM int *from = channelrx(r.src, cpuid, r.txoffset);
+      for (int i = 0; i < r.words; i++)
+        BRIDGE(r, i) = from[i];
+      words += r.words;
+    }
+    // from the bridge to the tx slot of the destination
+    if (r.gatewayin == cpuid && r.dst != cpuid) {
+      volatile _SPM int *to = channeltx(cpuid, r.dst, r.rxoffset);
+      for (int i = 0; i < r.words; i++)
+        to[i] = BRIDGE(r, i);
+      words += r.words;
+    }
+  }
+  return words;
+}
+
+unsigned int getclusterlatency(int id, unsigned int forwardcycles) {
+  ClusterRoute r = clusterroutes[id];
+  if (r.gatewayout < 0)
+    return getmessagelatency(r.src, r.dst, r.txoffset, r.words).worst;
+  unsigned int latency = 0;
+  // to the gateway and its copy to the bridge
+  if (r.src != r.gatewayout)
+    latency += getmessagelatency(r.src, r.gatewayout, r.txoffset, r.words).worst + forwardcycles;
+  // the copy of the peer gateway (or the read of the destination when it is
+  // the gateway) and from it to the destination
+  latency += forwardcycles;
+  if (r.dst != r.gatewayin)
+    latency += getmessagelatency(r.gatewayin, r.dst, r.rxoffset, r.words).worst;
+  return latency;
+}
@@ -0,0 +1,83 @@
+//onewaycluster.h
+#ifndef ONEWAYCLUSTER_H
+#define ONEWAYCLUSTER_H
+
+#include "onewaysim.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Several OneWayMem clusters joined by gateway cores (SIMFLAGS="-D CLUSTERS=k",
+// see onewaysim.h). Each cluster is a NoC of CLUSTERCORES cores with the
+// schedule of NOCNODES, so its TDM round does not grow with CORES. Core
+// getgateway(a, b) of cluster a is the gateway to cluster b: it shares a
+// bridge memory (modeling the SPM of both) with getgateway(b, a).
+//
+// A route is a channel of some words from a source core to a destination
+// core. In one cluster, it is a window in the slots of the pair. Between
+// clusters, it is a window in the slots from the source to the gateway, a
+// window in the bridge, and a window in the slots from the peer gateway to
+// the destination. The gateways copy the windows in clusterforward(), once per
+// loop, so a route has a worst-case latency of the (at most) two NoC
+// channels plus two loops of the gateways. With CLUSTERS 1 all routes are in
+// one cluster, which is the flat grid to compare with.
+//
+// The routing table is shared: one core adds the routes before the cores
+// use them (see use-case 7).
+
+#if CLUSTERS > 1 && CLUSTERS - 1 > CLUSTERCORES
+#error "a cluster needs a gateway core for each other cluster"
+#endif
+
+// routes in the table
+#ifndef CLUSTERROUTESMAX
+#define CLUSTERROUTESMAX (4 * CORES)
+#endif
+// words of a bridge, as many as the rx memory of a core
+#define BRIDGEWORDS (CLUSTERS > 1 ? TDMSLOTS * WORDS : 1)
+
+typedef struct ClusterRoute {
+  int src;
+  int dst;
+  int words;
+  // the gateways on the way (-1 in one cluster)
+  int gatewayout;
+  int gatewayin;
+  // channel word of the window from src to the first core (gatewayout or
+  // dst), bridge word, and channel word of the window from the last core
+  // (gatewayin or src) to dst
+  int txoffset;
+  int bridgeoffset;
+  int rxoffset;
+} ClusterRoute;
+
+// the cluster of a core and the gateway core of cluster to tocluster
+int getcluster(int core);
+int getgateway(int cluster, int tocluster);
+
+// clear the routing table
+void clusterroutesreset();
+// add a route of words words from core src to core dst, returns its id or
+// -1 when the table or a window is full
+int clusterrouteadd(int src, int dst, int words);
+int getclusterroutes();
+ClusterRoute getclusterroute(int id);
+
+// write the words of a route on its source core and read them on its
+// destination core
+void clusterwrite(int id, const unsigned int *data);
+void clusterread(int id, unsigned int *data);
+
+// forward the routes of the gateway core cpuid once, returns the words copied
+int clusterforward(int cpuid);
+
+// worst-case write-to-read latency of a route in clock cycles, when the loop
+// of a gateway takes at most forwardcycles
+unsigned int getclusterlatency(int id, unsigned int forwardcycles);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,255 @@
+//onewaycodec.c
+#include "onewaycodec.h"
+#include "onewaykernels.h"
+#include "onewaylatency.h"
+
+#define CODECKEYCHUNK 0x80000000u
+#define CODECKEYID(id) ((unsigned int)(id) & 0x7fff)
+
+static unsigned int codecinfo(bool keychunk, int keyid, int low) {
+  return (keychunk ? CODECKEYCHUNK : 0) | (CODECKEYID(keyid) << 16) | (unsigned int)low;
+}
+
+// the words of the state in keyframe chunk c
+static int codecchunkwords(int c) {
+  int left = CODECSTATE - c * CODECBODY;
+  return left < CODECBODY ? left : CODECBODY;
+}
+
+void codectxinit(CodecTx *tx, int txcore, int rxcore, int w) {
+  int txslot = gettxslotfromtxcorerxcoreslot(txcore, rxcore, -1);
+  int ackslot = getrxslotfromrxcoretxcoreslot(txcore, rxcore,
+                                              gettxslotfromtxcorerxcoreslot(rxcore, txcore, -1));
+  tx->frame = core[txcore].tx[txslot] + w;
+  tx->ack = core[txcore].rx[ackslot] + w + CODECACK;
+  tx->seq = 0;
+  tx->gap = CODECGAPBOUNDS * getlatencybound(txcore, rxcore);
+  tx->next = 0;
+  tx->keyid = 0;
+  tx->pending = false;
+  tx->chunk = 0;
+  for (int i = 0; i < CODECSTATE; i++)
+    tx->key[i] = 0;
+  tx->stats = (CodecStats){0, 0, 0, 0, 0};
+  // the credit word belongs to the reverse channel
+  for (int i = 0; i < CODECACK; i++)
+    tx->frame[i] = 0;
+}
+
+void codecrxinit(CodecRx *rx, int rxcore, int txcore, int w) {
+  int txslot = gettxslotfromtxcorerxcoreslot(txcore, rxcore, -1);
+  int ackslot = gettxslotfromtxcorerxcoreslot(rxcore, txcore, -1);
+  rx->frame = core[rxcore].rx[getrxslotfromrxcoretxcoreslot(rxcore, txcore, txslot)] + w;
+  rx->ack = core[rxcore].tx[ackslot] + w + CODECACK;
+  rx->seq = 0;
+  rx->bound = getlatencybound(txcore, rxcore);
+  rx->nextseq = 0;
+  rx->settle = 0;
+  rx->check = 0;
+  rx->keyid = 0;
+  for (int k = 0; k < (CODECCHUNKS + 31) / 32; k++)
+    rx->chunks[k] = 0;
+  rx->nchunks = 0;
+  for (int i = 0; i < CODECSTATE; i++)
+    rx->key[i] = 0;
+  rx->stats = (CodecStats){0, 0, 0, 0, 0};
+  *rx->ack = 0;
+}
+
+// the first word from i on whose mask bit is set (or clear), or CODECSTATE
+static int codecbit(const unsigned int *mask, int i, bool set) {
+  while (i < CODECSTATE) {
+    unsigned int bits = (set ? mask[i / 32] : ~mask[i / 32]) & (~0u << (i % 32));
+    if (bits != 0) {
+      int b = (i / 32) * 32 + __builtin_ctz(bits);
+      return b < CODECSTATE ? b : CODECSTATE;
+    }
+    i = (i / 32 + 1) * 32;
+  }
+  return CODECSTATE;
+}
+
+// the runs of the words of state that differ from key into body, returns the
+// body words or -1 when they do not fit
+static int codecencode(const int *state, const int *key, const unsigned int *mask, int *body) {
+  int len = 0;
+  int pos = 0;
+  for (int i = codecbit(mask, 0, true); i < CODECSTATE; i = codecbit(mask, pos, true)) {
+    int j = codecbit(mask, i, false);
+    if (len + 1 + j - i > CODECBODY)
+      return -1;
+    body[len++] = ((i - pos) << 16) | (j - i);
+    kernelxor(body + len, state + i, key + i, j - i);
+    len += j - i;
+    pos = j;
+  }
+  return len;
+}
+
+bool codecready(const CodecTx *tx) {
+  return (int)(getnoccycles() - tx->next) >= 0;
+}
+
+int codecsend(CodecTx *tx, const int *state) {
+  int buf[CODECTAIL];
+  unsigned int mask[CODECMASKWORDS];
+
+  // the rx core has the next keyframe
+  if (tx->pending && CODECKEYID(*tx->ack) == CODECKEYID(tx->keyid + 1)) {
+    for (int i = 0; i < CODECSTATE; i++)
+      tx->key[i] = tx->nextkey[i];
+    tx->keyid++;
+    tx->pending = false;
+    tx->stats.keyframes++;
+  }
+
+  // the rx core has had the time to take the frame before
+  if (!codecready(tx))
+    return 0;
+  tx->next = getnoccycles() + tx->gap;
+
+  tx->seq++;
+  kerneldiffmask(state, tx->key, CODECSTATE, mask);
+  int len = codecencode(state, tx->key, mask, buf + CODECINFO + 1);
+  if (!tx->pending && (len < 0 || len * 100 > CODECREKEY * CODECBODY)) {
+    for (int i = 0; i < CODECSTATE; i++)
+      tx->nextkey[i] = state[i];
+    tx->pending = true;
+    tx->chunk = 0;
+  }
+  if (tx->pending && (len < 0 || tx->seq % 2 == 1)) {
+    len = codecchunkwords(tx->chunk);
+    for (int k = 0; k < len; k++)
+      buf[CODECINFO + 1 + k] = tx->nextkey[tx->chunk * CODECBODY + k];
+    buf[CODECINFO] = codecinfo(true, tx->keyid + 1, tx->chunk);
+    tx->chunk = (tx->chunk + 1) % CODECCHUNKS;
+    tx->stats.chunks++;
+  } else {
+    buf[CODECINFO] = codecinfo(false, tx->keyid, len);
+    tx->stats.deltas++;
+  }
+
+  // tail first and head last
+  tx->frame[CODECTAIL] = tx->seq;
+  for (int k = CODECINFO; k < CODECINFO + 1 + len; k++)
+    tx->frame[k] = buf[k];
+  tx->frame[CODECHEAD] = tx->seq;
+  tx->stats.frames++;
+  tx->stats.words += len + 3;
+  return len + 3;
+}
+
+// the runs of a delta stay within the body and the state
+static bool codecvalid(const int *body, int len) {
+  if (len > CODECBODY)
+    return false;
+  int pos = 0;
+  int k = 0;
+  while (k < len) {
+    unsigned int run = body[k];
+    pos += (run >> 16) + (run & 0xffff);
+    k += 1 + (run & 0xffff);
+  }
+  return k == len && pos <= CODECSTATE;
+}
+
+// a keyframe chunk, returns true when it completes the next keyframe
+static bool codecchunk(CodecRx *rx, int keyid, int c, const int *body) {
+  if (CODECKEYID(keyid) != CODECKEYID(rx->keyid + 1) || c >= CODECCHUNKS)
+    return false;
+  rx->stats.chunks++;
+  for (int k = 0; k < codecchunkwords(c); k++)
+    rx->nextkey[c * CODECBODY + k] = body[k];
+  if ((rx->chunks[c / 32] & (1u << (c % 32))) == 0) {
+    rx->chunks[c / 32] |= 1u << (c % 32);
+    rx->nchunks++;
+  }
+  if (rx->nchunks < CODECCHUNKS)
+    return false;
+  for (int i = 0; i < CODECSTATE; i++)
+    rx->key[i] = rx->nextkey[i];
+  for (int k = 0; k < (CODECCHUNKS + 31) / 32; k++)
+    rx->chunks[k] = 0;
+  rx->nchunks = 0;
+  rx->keyid++;
+  rx->stats.keyframes++;
+  return true;
+}
+
+// copy the frame that has settled, returns true when the copy is still the
+// frame one latency bound later
+static bool codectake(CodecRx *rx) {
+  unsigned int seq = rx->frame[CODECHEAD];
+  unsigned int now = getnoccycles();
+  if (rx->check != 0) {
+    if ((int)(now - rx->check) < 0)
+      return false;
+    rx->check = 0;
+    rx->settle = 0;
+    // a later frame has come over the copy
+    if (seq != rx->nextseq || (unsigned int)rx->frame[CODECTAIL] != seq)
+      return false;
+    rx->seq = seq;
+    return true;
+  }
+  if (seq == rx->seq || (unsigned int)rx->frame[CODECTAIL] != seq)
+    return false;
+  // a new frame settles from its first sight
+  if (seq != rx->nextseq) {
+    rx->nextseq = seq;
+    rx->settle = 0;
+  }
+  if (!bufsettled(&rx->settle))
+    return false;
+  kernelcopyout(rx->copy, rx->frame, CODECTAIL);
+  // the head is read first and the tail last, as the sender writes them the
+  // other way around
+  if ((unsigned int)rx->copy[CODECHEAD] != seq || (unsigned int)rx->frame[CODECTAIL] != seq) {
+    rx->settle = 0;
+    return false;
+  }
+  rx->check = now + rx->bound;
+  // 0 means no copy
+  rx->check = (rx->check == 0) ? 1 : rx->check;
+  return false;
+}
+
+bool codecreceive(CodecRx *rx, int *state) {
+  if (!codectake(rx))
+    return false;
+  rx->stats.frames++;
+
+  unsigned int info = rx->copy[CODECINFO];
+  int keyid = (info >> 16) & 0x7fff;
+  int low = info & 0xffff;
+  const int *body = rx->copy + CODECINFO + 1;
+  if (info & CODECKEYCHUNK) {
+    // credit back to the sender
+    if (codecchunk(rx, keyid, low, body))
+      *rx->ack = CODECKEYID(rx->keyid);
+    return false;
+  }
+  if (CODECKEYID(keyid) != CODECKEYID(rx->keyid) || !codecvalid(body, low))
+    return false;
+
+  // the keyframe with the runs
+  for (int i = 0; i < CODECSTATE; i++)
+    state[i] = rx->key[i];
+  int pos = 0;
+  for (int k = 0; k < low; ) {
+    unsigned int run = body[k];
+    int count = run & 0xffff;
+    pos += run >> 16;
+    kernelxor(state + pos, rx->key + pos, body + k + 1, count);
+    pos += count;
+    k += 1 + count;
+  }
+  rx->stats.deltas++;
+  return true;
+}
+
+unsigned int getcodecratio(const CodecTx *tx) {
+  if (tx->stats.words == 0)
+    return 0;
+  return (unsigned int)(100ULL * tx->stats.deltas * CODECSTATE / tx->stats.words);
+}
@@ -0,0 +1,133 @@
+//onewaycodec.h
+#ifndef ONEWAYCODEC_H
+#define ONEWAYCODEC_H
+
+#include "onewaysim.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// A state of CODECSTATE words published from a tx core to an rx core over a
+// region of CODECWORDS words of their slot, which can be several times
+// smaller than the state when the state changes little. The sender writes a
+// frame into the region in every call:
+//   delta:    the XOR of the state and the current keyframe, run-length
+//             encoded as runs of (zero words << 16 | literal words) followed
+//             by the literal words
+//   keychunk: CODECBODY words of a new keyframe
+// A delta is against the keyframe and not against the frame before, so the
+// rx core can miss frames, as it misses words of any slot that is written
+// faster than it reads, and still gets the whole state from the next delta.
+// The first keyframe is the zero state. When the delta takes more than
+// CODECREKEY percent of the body, the sender takes the state as the next
+// keyframe and sends its chunks in every other frame (in every frame when the
+// delta does not fit) until the rx core has all chunks and returns the
+// keyframe id in word CODECACK of its region of the reverse channel.
+//
+// A frame is written like the buffers of use-case 6: the tail sequence number
+// first and the head sequence number last. The NI sends word w of a slot in
+// period w of each hyperperiod, so a frame can arrive over two hyperperiods,
+// and the next frame overwrites the region while the rx core reads it. The
+// rx core therefore copies a frame one hyperperiod after it first sees head
+// == tail (see bufsettled in onewaylatency.h), and takes the copy only when
+// head and tail still have its sequence number one latency bound after the
+// copy, when any word of a later frame that came before the copy has been
+// followed by its head. The sender writes a frame at most every
+// CODECGAPBOUNDS latency bounds, so that the rx core can take most of them.
+// Frame words: head, info (bit 31 keychunk, bits 16..30 keyframe id, bits
+// 0..15 chunk or body words), body, tail, and the credit of the reverse
+// channel. The region is the words w .. w + CODECWORDS - 1 of the first slot
+// of the core pair.
+
+#define CODECHEAD 0
+#define CODECINFO 1
+#define CODECBODY (CODECWORDS - 4)
+#define CODECTAIL (CODECWORDS - 2)
+#define CODECACK (CODECWORDS - 1)
+#define CODECCHUNKS ((CODECSTATE + CODECBODY - 1) / CODECBODY)
+#define CODECMASKWORDS ((CODECSTATE + 31) / 32)
+// first sight, settled copy, and check of a frame fit between two frames
+#define CODECGAPBOUNDS 3
+
+#if CODECWORDS < 8 || CODECWORDS > WORDS
+#error "CODECWORDS must be at least 8 and fit into a slot of WORDS words"
+#endif
+#if CODECSTATE > 0xffff
+#error "CODECSTATE must fit into the 16 bits of a run"
+#endif
+
+// frames and words of one channel
+typedef struct CodecStats {
+  // frames written (tx) or taken (rx), and the deltas and keyframe chunks
+  int frames;
+  int deltas;
+  int chunks;
+  // keyframes completed
+  int keyframes;
+  // words written into the slot (tx)
+  unsigned int words;
+} CodecStats;
+
+typedef struct CodecTx {
+  volatile _SPM int *frame;
+  volatile _SPM int *ack;
+  unsigned int seq;
+  // noc cycles between two frames, and the noc cycle of the next frame
+  unsigned int gap;
+  unsigned int next;
+  int keyid;
+  // the next keyframe while its chunks are sent
+  bool pending;
+  int chunk;
+  int key[CODECSTATE];
+  int nextkey[CODECSTATE];
+  CodecStats stats;
+} CodecTx;
+
+typedef struct CodecRx {
+  volatile _SPM int *frame;
+  volatile _SPM int *ack;
+  unsigned int seq;
+  // the latency bound of the channel, the frame that showed up, the noc cycle
+  // when it is whole (see bufsettled), and the noc cycle when its copy is
+  // checked (0 while there is no copy)
+  unsigned int bound;
+  unsigned int nextseq;
+  unsigned int settle;
+  unsigned int check;
+  int copy[CODECTAIL];
+  int keyid;
+  // chunks of the next keyframe that have arrived
+  unsigned int chunks[(CODECCHUNKS + 31) / 32];
+  int nchunks;
+  int key[CODECSTATE];
+  int nextkey[CODECSTATE];
+  CodecStats stats;
+} CodecRx;
+
+// the two ends of the channel from txcore to rxcore at word w of the slot
+// (init also clears the region of the end)
+void codectxinit(CodecTx *tx, int txcore, int rxcore, int w);
+void codecrxinit(CodecRx *rx, int rxcore, int txcore, int w);
+
+// the time for the next frame has come
+bool codecready(const CodecTx *tx);
+
+// write the next frame of state when its time has come, returns the words
+// written (0 when it has not)
+int codecsend(CodecTx *tx, const int *state);
+
+// take the frame that has arrived and settled, returns true when it updated
+// state
+bool codecreceive(CodecRx *rx, int *state);
+
+// logical state words per 100 words written for the deltas and keyframes of
+// the tx end
+unsigned int getcodecratio(const CodecTx *tx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,185 @@
+//onewaydataflow.c
+#include "onewaydataflow.h"
+#include "onewaylatency.h"
+
+void dataflowinit(Dataflow *df, const char *name, DataflowSource source, int items, int core) {
+  df->stages = 1;
+  df->name[0] = name;
+  df->source = source;
+  df->items = items;
+  df->fn[0] = NULL;
+  df->core[0] = core;
+}
+
+int dataflowadd(Dataflow *df, const char *name, DataflowStage fn, int core) {
+  if (df->stages == DATAFLOWSTAGESMAX || core < 0 || core >= CORES ||
+      core / CLUSTERCORES != df->core[0] / CLUSTERCORES || getdataflowstage(df, core) >= 0)
+    return -1;
+  df->name[df->stages] = name;
+  df->fn[df->stages] = fn;
+  df->core[df->stages] = core;
+  return df->stages++;
+}
+
+int getdataflowstage(const Dataflow *df, int core) {
+  for (int s = 0; s < df->stages; s++)
+    if (df->core[s] == core)
+      return s;
+  return -1;
+}
+
+void dataflownodeinit(DataflowNode *node, const Dataflow *df, int cpuid) {
+  int s = getdataflowstage(df, cpuid);
+  node->cpuid = cpuid;
+  node->stage = s;
+  node->inslot = -1;
+  node->inackslot = -1;
+  node->outslot = -1;
+  node->outackslot = -1;
+  if (s > 0) {
+    int prev = df->core[s - 1];
+    node->inslot = getrxslotfromrxcoretxcoreslot(cpuid, prev, gettxslotfromtxcorerxcoreslot(prev, cpuid, -1));
+    node->inackslot = gettxslotfromtxcorerxcoreslot(cpuid, prev, node->inslot);
+    core[cpuid].tx[node->inackslot][DATAFLOWACK] = 0;
+  }
+  if (s >= 0 && s < df->stages - 1) {
+    int next = df->core[s + 1];
+    node->outslot = gettxslotfromtxcorerxcoreslot(cpuid, next, -1);
+    node->outackslot = getrxslotfromrxcoretxcoreslot(cpuid, next, node->outslot);
+  }
+  node->rxseq = 0;
+  node->txseq = 0;
+  node->rxsettle = 0;
+  node->itemsin = 0;
+  node->itemsout = 0;
+  node->done = (s < 0);
+  for (int k = 0; k < DATAFLOWACC; k++)
+    node->acc[k] = 0;
+  node->busy = 0;
+  node->inwaits = 0;
+  node->outwaits = 0;
+  node->latmin = 0;
+  node->latmax = 0;
+  node->latsum = 0;
+  node->first = 0;
+  node->last = 0;
+}
+
+// first word of the buffer for sequence number seq
+static int dataflowbuf(unsigned int seq) {
+  return 1 + ((seq - 1) % DOUBLEBUFFERS) * DATAFLOWBUFWORDS;
+}
+
+// the next item has arrived and settled: its length (-1 for the end of the
+// stream) and stamp, and its payload in item
+static bool dataflowtake(DataflowNode *node, int *item, int *n, unsigned int *stamp) {
+  unsigned int seq = node->rxseq + 1;
+  volatile _SPM int *buf = core[node->cpuid].rx[node->inslot] + dataflowbuf(seq);
+  if ((unsigned int)buf[DATAFLOWHEAD] != seq || (unsigned int)buf[DATAFLOWTAIL] != seq)
+    return false;
+  if (!bufsettled(&node->rxsettle))
+    return false;
+  node->rxsettle = 0;
+  *stamp = buf[DATAFLOWSTAMP];
+  *n = buf[DATAFLOWLENGTH];
+  *n = (*n > DATAFLOWITEMMAX) ? DATAFLOWITEMMAX : *n;
+  for (int k = 0; k < *n; k++)
+    item[k] = buf[DATAFLOWLENGTH + 1 + k];
+  node->rxseq = seq;
+  // credit back to the stage before
+  core[node->cpuid].tx[node->inackslot][DATAFLOWACK] = seq;
+  return true;
+}
+
+// a buffer is free for the next item
+static bool dataflowfree(DataflowNode *node) {
+  unsigned int ack = core[node->cpuid].rx[node->outackslot][DATAFLOWACK];
+  return node->txseq + 1 - ack <= DOUBLEBUFFERS;
+}
+
+// pass an item on, the payload and the tail first and the head last (the
+// stage after takes it when it has settled)
+static void dataflowpass(DataflowNode *node, const int *item, int n, unsigned int stamp) {
+  unsigned int seq = node->txseq + 1;
+  volatile _SPM int *buf = core[node->cpuid].tx[node->outslot] + dataflowbuf(seq);
+  buf[DATAFLOWTAIL] = seq;
+  buf[DATAFLOWSTAMP] = stamp;
+  buf[DATAFLOWLENGTH] = n;
+  for (int k = 0; k < n; k++)
+    buf[DATAFLOWLENGTH + 1 + k] = item[k];
+  buf[DATAFLOWHEAD] = seq;
+  node->txseq = seq;
+  if (n >= 0)
+    node->itemsout++;
+}
+
+// an item at the last stage
+static void dataflowsink(DataflowNode *node, unsigned int stamp) {
+  unsigned int now = getnoccycles();
+  unsigned int lat = now - stamp;
+  node->latmin = (node->itemsout == 0 || lat < node->latmin) ? lat : node->latmin;
+  node->latmax = (lat > node->latmax) ? lat : node->latmax;
+  node->latsum += lat;
+  if (node->itemsout == 0)
+    node->first = now;
+  node->last = now;
+  node->itemsout++;
+}
+
+bool dataflowstep(DataflowNode *node, const Dataflow *df) {
+  int item[DATAFLOWITEMMAX];
+  bool last = (node->outslot < 0);
+  for (int k = 0; k < DOUBLEBUFFERS && !node->done; k++) {
+    if (!last && !dataflowfree(node)) {
+      if (k == 0)
+        node->outwaits++;
+      break;
+    }
+    int n;
+    unsigned int stamp;
+    if (node->stage == 0) {
+      if (node->itemsin == df->items) {
+        dataflowpass(node, item, -1, 0);
+        node->done = true;
+        break;
+      }
+      stamp = getnoccycles();
+      unsigned int start = getcycles();
+      n = df->source(node->itemsin, item);
+      node->busy += getcycles() - start;
+    } else {
+      if (!dataflowtake(node, item, &n, &stamp)) {
+        if (k == 0)
+          node->inwaits++;
+        break;
+      }
+      if (n < 0) {
+        if (!last)
+          dataflowpass(node, item, -1, 0);
+        node->done = true;
+        break;
+      }
+      unsigned int start = getcycles();
+      n = df->fn[node->stage](item, n, node->acc);
+      node->busy += getcycles() - start;
+    }
+    node->itemsin++;
+    if (n > 0 && last)
+      dataflowsink(node, stamp);
+    else if (n > 0)
+      dataflowpass(node, item, n, stamp);
+  }
+  return node->done;
+}
+
+void dataflowwait(DataflowNode *node) {
+  if (node->done)
+    return;
+  if (node->inslot >= 0) {
+    waitrx(node->cpuid, node->inslot, dataflowbuf(node->rxseq + 1) + DATAFLOWHEAD);
+    if (node->rxsettle != 0)
+      waitnoccycles(node->cpuid, node->rxsettle);
+  }
+  if (node->outslot >= 0)
+    waitrx(node->cpuid, node->outackslot, DATAFLOWACK);
+}
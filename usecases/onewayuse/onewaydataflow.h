@@ -0,0 +1,110 @@
+//onewaydataflow.h
+#ifndef ONEWAYDATAFLOW_H
+#define ONEWAYDATAFLOW_H
+
+#include "onewaysim.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// A pipeline of stages, each on its own core: a source makes the items, and
+// each stage after it takes the items of the stage before, transforms them,
+// and passes them on (a filter drops some, the last stage aggregates them).
+// Two stages are connected by a stream in the slot of their core pair, as
+// in use-case 6: DOUBLEBUFFERS buffers of DATAFLOWBUFWORDS words after the
+// credit word, the head and tail sequence numbers around the item, and the
+// credit (the last sequence number taken) back in the slot of the reverse
+// pair. The NI sends word w of a slot in period w of each hyperperiod, so an
+// item can arrive over two hyperperiods, and a stage takes it one hyperperiod
+// after it first sees head == tail (see bufsettled in onewaylatency.h). A
+// stage only writes into a buffer whose credit has come back, so a
+// stream holds at most DOUBLEBUFFERS items, and it works on the next item
+// while the NoC moves the items before. The items carry the NoC cycle when
+// the source made them, for the latency at the last stage, and a final item
+// of length -1 ends the stream.
+
+#define DATAFLOWACK 0
+#define DATAFLOWBUFWORDS ((WORDS - 1) / DOUBLEBUFFERS)
+// item words: head, stamp, length, payload, tail
+#define DATAFLOWHEAD 0
+#define DATAFLOWSTAMP 1
+#define DATAFLOWLENGTH 2
+#define DATAFLOWTAIL (DATAFLOWBUFWORDS - 1)
+#define DATAFLOWITEMMAX (DATAFLOWBUFWORDS - 4)
+
+// the source writes item seq (from 0) and returns its words
+typedef int (*DataflowSource)(int seq, int *item);
+// a stage transforms the n words of an item in place and returns its new
+// length (0 drops it), acc is the accumulator of the stage
+typedef int (*DataflowStage)(int *item, int n, int *acc);
+
+typedef struct Dataflow {
+  // stage 0 is the source
+  int stages;
+  const char *name[DATAFLOWSTAGESMAX];
+  DataflowSource source;
+  int items;
+  DataflowStage fn[DATAFLOWSTAGESMAX];
+  int core[DATAFLOWSTAGESMAX];
+} Dataflow;
+
+// a pipeline with the source on core
+void dataflowinit(Dataflow *df, const char *name, DataflowSource source, int items, int core);
+// the next stage on core, returns its index or -1 when the core has a stage,
+// is not in the cluster of the source, or there is no room
+int dataflowadd(Dataflow *df, const char *name, DataflowStage fn, int core);
+// the stage of core (-1 for none)
+int getdataflowstage(const Dataflow *df, int core);
+
+// the stage of one core as it runs
+typedef struct DataflowNode {
+  int cpuid;
+  int stage;
+  // the slots of the stream from the stage before (rx slot and tx slot of
+  // its credit) and to the stage after (tx slot and rx slot of its credit),
+  // -1 for none
+  int inslot;
+  int inackslot;
+  int outslot;
+  int outackslot;
+  unsigned int rxseq;
+  unsigned int txseq;
+  // noc cycle when the next item is whole (see bufsettled)
+  unsigned int rxsettle;
+  // items taken and passed on, the end of the stream is through
+  int itemsin;
+  int itemsout;
+  bool done;
+  int acc[DATAFLOWACC];
+  // cpu cycles in the stage function, loops without an item to take or
+  // without a free buffer to pass it on
+  unsigned int busy;
+  int inwaits;
+  int outwaits;
+  // latency of the items at the last stage and noc cycles of its first and
+  // last item
+  unsigned int latmin;
+  unsigned int latmax;
+  unsigned long long latsum;
+  unsigned int first;
+  unsigned int last;
+} DataflowNode;
+
+// the node of core, also clears its credits
+void dataflownodeinit(DataflowNode *node, const Dataflow *df, int cpuid);
+
+// one loop of a node: take, transform, and pass on items until the input
+// is empty or the output is full, returns true when the end of the stream
+// has passed the node
+bool dataflowstep(DataflowNode *node, const Dataflow *df);
+
+// wait hints for a node that did not finish: the next item and its
+// settling, and the credit
+void dataflowwait(DataflowNode *node);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,121 @@
+//onewayinbox.c
+#include "onewayinbox.h"
+#include "onewaykernels.h"
+#include "onewaylatency.h"
+
+void inboxinit(Inbox *inbox, int cpuid) {
+  inbox->cpuid = cpuid;
+  inbox->strided = true;
+  for (int i = 0; i < TDMSLOTS; i++) {
+    inbox->rxseq[i] = 0;
+    inbox->txseq[i] = 0;
+    inbox->rxsettle[i] = 0;
+    inbox->strided = inbox->strided && (core[cpuid].rx[i] == core[cpuid].rx[0] + i * WORDS);
+    core[cpuid].tx[i][INBOXACK] = 0;
+    core[cpuid].tx[i][INBOXHEAD] = 0;
+    core[cpuid].tx[i][INBOXTAIL] = 0;
+  }
+  for (int k = 0; k < INBOXMASKWORDS; k++)
+    inbox->ready[k] = 0;
+  inbox->cursor = 0;
+  inbox->scans = 0;
+  inbox->checks = 0;
+  inbox->messages = 0;
+}
+
+int inboxscan(Inbox *inbox) {
+  inbox->scans++;
+  if (inbox->strided)
+    return kernelchangedmask(core[inbox->cpuid].rx[0] + INBOXHEAD, WORDS, inbox->rxseq,
+                             TDMSLOTS, inbox->ready);
+  int count = 0;
+  for (int k = 0; k < INBOXMASKWORDS; k++)
+    inbox->ready[k] = 0;
+  for (int i = 0; i < TDMSLOTS; i++) {
+    if ((unsigned int)core[inbox->cpuid].rx[i][INBOXHEAD] != inbox->rxseq[i]) {
+      inbox->ready[i / 32] |= 1u << (i % 32);
+      count++;
+    }
+  }
+  return count;
+}
+
+// the first ready slot from the cursor on (wrapping around), or -1
+static int inboxready(const Inbox *inbox) {
+  int k = inbox->cursor / 32;
+  unsigned int bits = inbox->ready[k] & (~0u << (inbox->cursor % 32));
+  // the word of the cursor comes again last with the slots before it
+  for (int n = 0; n <= INBOXMASKWORDS; n++) {
+    if (bits != 0)
+      return k * 32 + __builtin_ctz(bits);
+    k = (k + 1) % INBOXMASKWORDS;
+    bits = inbox->ready[k];
+  }
+  return -1;
+}
+
+bool inboxtake(Inbox *inbox, int rxslot, unsigned int *payload) {
+  volatile _SPM int *slot = core[inbox->cpuid].rx[rxslot];
+  unsigned int seq = inbox->rxseq[rxslot] + 1;
+  inbox->checks++;
+  if ((unsigned int)slot[INBOXHEAD] != seq || (unsigned int)slot[INBOXTAIL] != seq)
+    return false;
+  if (!bufsettled(&inbox->rxsettle[rxslot]))
+    return false;
+  inbox->rxsettle[rxslot] = 0;
+  for (int k = 0; k < INBOXPAYLOAD; k++)
+    payload[k] = slot[INBOXHEAD + 1 + k];
+  inbox->rxseq[rxslot] = seq;
+  inbox->messages++;
+  // credit back to the producer
+  int txcore = gettxcorefromrxcoreslot(inbox->cpuid, rxslot);
+  int ackslot = gettxslotfromtxcorerxcoreslot(inbox->cpuid, txcore, rxslot);
+  core[inbox->cpuid].tx[ackslot][INBOXACK] = seq;
+  return true;
+}
+
+int inboxnext(Inbox *inbox, unsigned int *payload) {
+  for (int pass = 0; pass < 2; pass++) {
+    int i;
+    while ((i = inboxready(inbox)) >= 0) {
+      inbox->ready[i / 32] &= ~(1u << (i % 32));
+      inbox->cursor = (i + 1) % TDMSLOTS;
+      // a head that is not (yet) the next settled message comes again with
+      // the next scan
+      if (inboxtake(inbox, i, payload))
+        return i;
+    }
+    if (inboxscan(inbox) == 0)
+      break;
+  }
+  return -1;
+}
+
+bool inboxsend(Inbox *inbox, int rxcore, const unsigned int *payload) {
+  int cpuid = inbox->cpuid;
+  int txslot = gettxslotfromtxcorerxcoreslot(cpuid, rxcore, -1);
+  int ackslot = getrxslotfromrxcoretxcoreslot(cpuid, rxcore, txslot);
+  unsigned int seq = inbox->txseq[txslot] + 1;
+  if ((unsigned int)core[cpuid].rx[ackslot][INBOXACK] != seq - 1)
+    return false;
+  volatile _SPM int *slot = core[cpuid].tx[txslot];
+  slot[INBOXTAIL] = seq;
+  for (int k = 0; k < INBOXPAYLOAD; k++)
+    slot[INBOXHEAD + 1 + k] = payload[k];
+  slot[INBOXHEAD] = seq;
+  inbox->txseq[txslot] = seq;
+  return true;
+}
+
+void inboxwaitrx(Inbox *inbox) {
+  for (int i = 0; i < TDMSLOTS; i++) {
+    waitrx(inbox->cpuid, i, INBOXHEAD);
+    if (inbox->rxsettle[i] != 0)
+      waitnoccycles(inbox->cpuid, inbox->rxsettle[i]);
+  }
+}
+
+void inboxwaittx(Inbox *inbox, int rxcore) {
+  int txslot = gettxslotfromtxcorerxcoreslot(inbox->cpuid, rxcore, -1);
+  waitrx(inbox->cpuid, getrxslotfromrxcoretxcoreslot(inbox->cpuid, rxcore, txslot), INBOXACK);
+}
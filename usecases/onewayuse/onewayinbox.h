@@ -0,0 +1,88 @@
+//onewayinbox.h
+#ifndef ONEWAYINBOX_H
+#define ONEWAYINBOX_H
+
+#include "onewaysim.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// All rx slots of a core as one queue with many producers. Each slot carries
+// one message at a time in its first INBOXWORDS words, like the buffers of
+// use-case 6: the producer writes the tail sequence number and the payload
+// first and the head sequence number last. The NI sends word w of a slot in
+// period w of each hyperperiod, so a write can go out over two hyperperiods,
+// and head == tail == the next sequence number of the slot can show around
+// old payload words. The consumer takes the message one hyperperiod after it
+// first sees head == tail, when all its words have arrived (see bufsettled in
+// onewaylatency.h), and returns the sequence number as credit in word
+// INBOXACK of its tx slot back to the producer, which only writes its next
+// message when the credit has come back.
+//
+// The consumer does not poll the slots one by one. One pass over the head
+// words of all rx slots (kernelchangedmask(), vectorized on the pc) sets a
+// bit in the ready mask for each slot whose head differs from its last
+// consumed sequence number, and inboxnext() takes the messages from the mask
+// round-robin from the slot after the last one. Only when the mask is empty
+// does it scan again, so a message costs one bit and one slot check, and
+// all slots one pass when there is nothing to fetch.
+
+#define INBOXACK 0
+#define INBOXHEAD 1
+#define INBOXTAIL (INBOXWORDS - 1)
+#define INBOXPAYLOAD (INBOXWORDS - 3)
+#define INBOXMASKWORDS ((TDMSLOTS + 31) / 32)
+
+#if INBOXWORDS < 4 || INBOXWORDS > WORDS
+#error "INBOXWORDS must be at least 4 and fit into a slot of WORDS words"
+#endif
+
+typedef struct Inbox {
+  int cpuid;
+  // the head words of the rx slots are WORDS apart (one kernel pass on them)
+  bool strided;
+  // last sequence number consumed on each rx slot and sent on each tx slot
+  unsigned int rxseq[TDMSLOTS];
+  unsigned int txseq[TDMSLOTS];
+  // noc cycle when the next message on each rx slot is whole (see bufsettled)
+  unsigned int rxsettle[TDMSLOTS];
+  // rx slots whose head changed at the last scan and are not checked yet
+  unsigned int ready[INBOXMASKWORDS];
+  // rx slot where the next fetch starts
+  int cursor;
+  // passes over the head words, slot checks, and messages consumed
+  int scans;
+  int checks;
+  int messages;
+} Inbox;
+
+// the inbox of a core, also clears the credits and sequence numbers in its
+// tx slots (the rx slots have them one NoC latency later)
+void inboxinit(Inbox *inbox, int cpuid);
+
+// one pass over all head words, returns the ready slots
+int inboxscan(Inbox *inbox);
+
+// the next message (INBOXPAYLOAD words) into payload, returns its rx slot or
+// -1 when there is none
+int inboxnext(Inbox *inbox, unsigned int *payload);
+
+// consume the message on rx slot when it has arrived and settled (per-slot
+// polling), returns true when it has
+bool inboxtake(Inbox *inbox, int rxslot, unsigned int *payload);
+
+// send the next message to rxcore, returns false when the credit of the
+// previous one has not come back
+bool inboxsend(Inbox *inbox, int rxcore, const unsigned int *payload);
+
+// wait hints: the heads of all rx slots and the settling of the messages
+// that showed up, the credit from rxcore
+void inboxwaitrx(Inbox *inbox);
+void inboxwaittx(Inbox *inbox, int rxcore);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
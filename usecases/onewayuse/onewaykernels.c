@@ -0,0 +1,389 @@
+//onewaykernels.c
+#include "onewaykernels.h"
+
+// SSE4.1 and AVX2 paths on the PC, unless KERNELSCALAR is defined
+#if !defined(RUNONPATMOS) && !defined(KERNELSCALAR) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define KERNELSIMD
+#include <immintrin.h>
+#endif
+
+static unsigned int checksumfold(unsigned int s1, unsigned int s2) {
+  return s1 ^ ((s2 << 16) | (s2 >> 16));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// scalar kernels (patmos and fallback)
+///////////////////////////////////////////////////////////////////////////////
+
+static unsigned int checksumscalar(const volatile _SPM int *buf, int n) {
+  unsigned int s1 = 0;
+  unsigned int s2 = 0;
+  for (int i = 0; i < n; i++) {
+    unsigned int w = buf[i];
+    s1 += w;
+    s2 += (unsigned int)(n - i) * w;
+  }
+  return checksumfold(s1, s2);
+}
+
+static int comparescalar(const volatile _SPM int *buf, const unsigned int *expected, int n) {
+  for (int i = 0; i < n; i++)
+    if ((unsigned int)buf[i] != expected[i])
+      return i;
+  return -1;
+}
+
+static void summaryscalar(const volatile _SPM int *buf, int n, KernelSummary *summary) {
+  unsigned int sum = 0;
+  int min = buf[0];
+  int max = min;
+  for (int i = 0; i < n; i++) {
+    int w = buf[i];
+    sum += w;
+    min = (w < min) ? w : min;
+    max = (w > max) ? w : max;
+  }
+  summary->sum = sum;
+  summary->min = min;
+  summary->max = max;
+}
+
+static void copyoutscalar(int *dst, const volatile _SPM int *buf, int n) {
+  for (int i = 0; i < n; i++)
+    dst[i] = buf[i];
+}
+
+static void maskclear(unsigned int *mask, int n) {
+  for (int k = 0; k < (n + 31) / 32; k++)
+    mask[k] = 0;
+}
+
+static int changedscalar(const volatile _SPM int *buf, int stride, const unsigned int *seen,
+                         int i, int n, unsigned int *mask) {
+  int count = 0;
+  for (; i < n; i++) {
+    if ((unsigned int)buf[i * stride] != seen[i]) {
+      mask[i / 32] |= 1u << (i % 32);
+      count++;
+    }
+  }
+  return count;
+}
+
+static int diffscalar(const int *a, const int *b, int i, int n, unsigned int *mask) {
+  int count = 0;
+  for (; i < n; i++) {
+    if (a[i] != b[i]) {
+      mask[i / 32] |= 1u << (i % 32);
+      count++;
+    }
+  }
+  return count;
+}
+
+static void xorscalar(int *dst, const int *a, const int *b, int i, int n) {
+  for (; i < n; i++)
+    dst[i] = a[i] ^ b[i];
+}
+
+#ifdef KERNELSIMD
+///////////////////////////////////////////////////////////////////////////////
+// SSE4.1 kernels (4 words at a time)
+///////////////////////////////////////////////////////////////////////////////
+
+__attribute__((target("sse4.1")))
+static unsigned int hsumsse(__m128i v) {
+  v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+  v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(v);
+}
+
+__attribute__((target("sse4.1")))
+static unsigned int checksumsse(const int *buf, int n) {
+  __m128i s1 = _mm_setzero_si128();
+  __m128i s2 = _mm_setzero_si128();
+  __m128i weight = _mm_setr_epi32(n, n - 1, n - 2, n - 3);
+  __m128i step = _mm_set1_epi32(4);
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(buf + i));
+    s1 = _mm_add_epi32(s1, v);
+    s2 = _mm_add_epi32(s2, _mm_mullo_epi32(v, weight));
+    weight = _mm_sub_epi32(weight, step);
+  }
+  unsigned int a = hsumsse(s1);
+  unsigned int b = hsumsse(s2);
+  for (; i < n; i++) {
+    a += buf[i];
+    b += (unsigned int)(n - i) * buf[i];
+  }
+  return checksumfold(a, b);
+}
+
+__attribute__((target("sse4.1")))
+static int comparesse(const int *buf, const unsigned int *expected, int n) {
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(buf + i)),
+                                 _mm_loadu_si128((const __m128i *)(expected + i)));
+    unsigned int mask = _mm_movemask_ps(_mm_castsi128_ps(eq));
+    if (mask != 0xf)
+      return i + __builtin_ctz(~mask);
+  }
+  for (; i < n; i++)
+    if ((unsigned int)buf[i] != expected[i])
+      return i;
+  return -1;
+}
+
+__attribute__((target("sse4.1")))
+static void summarysse(const int *buf, int n, KernelSummary *summary) {
+  __m128i sum = _mm_setzero_si128();
+  __m128i min = _mm_set1_epi32(buf[0]);
+  __m128i max = min;
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(buf + i));
+    sum = _mm_add_epi32(sum, v);
+    min = _mm_min_epi32(min, v);
+    max = _mm_max_epi32(max, v);
+  }
+  int mins[4], maxs[4];
+  _mm_storeu_si128((__m128i *)mins, min);
+  _mm_storeu_si128((__m128i *)maxs, max);
+  summary->sum = hsumsse(sum);
+  summary->min = mins[0];
+  summary->max = maxs[0];
+  for (int k = 1; k < 4; k++) {
+    summary->min = (mins[k] < summary->min) ? mins[k] : summary->min;
+    summary->max = (maxs[k] > summary->max) ? maxs[k] : summary->max;
+  }
+  for (; i < n; i++) {
+    summary->sum += buf[i];
+    summary->min = (buf[i] < summary->min) ? buf[i] : summary->min;
+    summary->max = (buf[i] > summary->max) ? buf[i] : summary->max;
+  }
+}
+
+// 4 words at a time, which stay in one mask word
+__attribute__((target("sse4.1")))
+static int changedsse(const int *buf, int stride, const unsigned int *seen, int n, unsigned int *mask) {
+  int count = 0;
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const int *w = buf + i * stride;
+    __m128i v = _mm_setr_epi32(w[0], w[stride], w[2 * stride], w[3 * stride]);
+    __m128i eq = _mm_cmpeq_epi32(v, _mm_loadu_si128((const __m128i *)(seen + i)));
+    unsigned int bits = ~_mm_movemask_ps(_mm_castsi128_ps(eq)) & 0xf;
+    mask[i / 32] |= bits << (i % 32);
+    count += __builtin_popcount(bits);
+  }
+  return count + changedscalar(buf, stride, seen, i, n, mask);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// AVX2 kernels (8 words at a time)
+///////////////////////////////////////////////////////////////////////////////
+
+__attribute__((target("avx2")))
+static unsigned int hsumavx2(__m256i v) {
+  return hsumsse(_mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+}
+
+__attribute__((target("avx2")))
+static unsigned int checksumavx2(const int *buf, int n) {
+  __m256i s1 = _mm256_setzero_si256();
+  __m256i s2 = _mm256_setzero_si256();
+  __m256i weight = _mm256_setr_epi32(n, n - 1, n - 2, n - 3, n - 4, n - 5, n - 6, n - 7);
+  __m256i step = _mm256_set1_epi32(8);
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(buf + i));
+    s1 = _mm256_add_epi32(s1, v);
+    s2 = _mm256_add_epi32(s2, _mm256_mullo_epi32(v, weight));
+    weight = _mm256_sub_epi32(weight, step);
+  }
+  unsigned int a = hsumavx2(s1);
+  unsigned int b = hsumavx2(s2);
+  for (; i < n; i++) {
+    a += buf[i];
+    b += (unsigned int)(n - i) * buf[i];
+  }
+  return checksumfold(a, b);
+}
+
+__attribute__((target("avx2")))
+static int compareavx2(const int *buf, const unsigned int *expected, int n) {
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(buf + i)),
+                                    _mm256_loadu_si256((const __m256i *)(expected + i)));
+    unsigned int mask = _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+    if (mask != 0xff)
+      return i + __builtin_ctz(~mask);
+  }
+  for (; i < n; i++)
+    if ((unsigned int)buf[i] != expected[i])
+      return i;
+  return -1;
+}
+
+__attribute__((target("avx2")))
+static void summaryavx2(const int *buf, int n, KernelSummary *summary) {
+  __m256i sum = _mm256_setzero_si256();
+  __m256i min = _mm256_set1_epi32(buf[0]);
+  __m256i max = min;
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(buf + i));
+    sum = _mm256_add_epi32(sum, v);
+    min = _mm256_min_epi32(min, v);
+    max = _mm256_max_epi32(max, v);
+  }
+  int mins[8], maxs[8];
+  _mm256_storeu_si256((__m256i *)mins, min);
+  _mm256_storeu_si256((__m256i *)maxs, max);
+  summary->sum = hsumavx2(sum);
+  summary->min = mins[0];
+  summary->max = maxs[0];
+  for (int k = 1; k < 8; k++) {
+    summary->min = (mins[k] < summary->min) ? mins[k] : summary->min;
+    summary->max = (maxs[k] > summary->max) ? maxs[k] : summary->max;
+  }
+  for (; i < n; i++) {
+    summary->sum += buf[i];
+    summary->min = (buf[i] < summary->min) ? buf[i] : summary->min;
+    summary->max = (buf[i] > summary->max) ? buf[i] : summary->max;
+  }
+}
+
+__attribute__((target("avx2")))
+static void copyoutavx2(int *dst, const int *buf, int n) {
+  int i = 0;
+  for (; i + 8 <= n; i += 8)
+    _mm256_storeu_si256((__m256i *)(dst + i), _mm256_loadu_si256((const __m256i *)(buf + i)));
+  for (; i < n; i++)
+    dst[i] = buf[i];
+}
+
+// 8 words at a time with one gather, which stay in one mask word
+__attribute__((target("avx2")))
+static int changedavx2(const int *buf, int stride, const unsigned int *seen, int n, unsigned int *mask) {
+  __m256i index = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+  int count = 0;
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = (stride == 1) ? _mm256_loadu_si256((const __m256i *)(buf + i)) :
+                                _mm256_i32gather_epi32(buf + i * stride, index, 4);
+    __m256i eq = _mm256_cmpeq_epi32(v, _mm256_loadu_si256((const __m256i *)(seen + i)));
+    unsigned int bits = ~_mm256_movemask_ps(_mm256_castsi256_ps(eq)) & 0xff;
+    mask[i / 32] |= bits << (i % 32);
+    count += __builtin_popcount(bits);
+  }
+  return count + changedscalar(buf, stride, seen, i, n, mask);
+}
+
+__attribute__((target("avx2")))
+static void xoravx2(int *dst, const int *a, const int *b, int n) {
+  int i = 0;
+  for (; i + 8 <= n; i += 8)
+    _mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(a + i)),
+                                                                _mm256_loadu_si256((const __m256i *)(b + i))));
+  xorscalar(dst, a, b, i, n);
+}
+
+// 0: scalar, 1: SSE4.1, 2: AVX2
+static int simdlevel = -1;
+
+static int kernelsimdlevel() {
+  if (simdlevel < 0) {
+    __builtin_cpu_init();
+    simdlevel = __builtin_cpu_supports("avx2") ? 2 :
+                __builtin_cpu_supports("sse4.1") ? 1 : 0;
+  }
+  return simdlevel;
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// kernels
+///////////////////////////////////////////////////////////////////////////////
+
+unsigned int kernelchecksum(const volatile _SPM int *buf, int n) {
+#ifdef KERNELSIMD
+  // on the PC the buffer is plain memory
+  if (kernelsimdlevel() == 2)
+    return checksumavx2((const int *)buf, n);
+  if (kernelsimdlevel() == 1)
+    return checksumsse((const int *)buf, n);
+#endif
+  return checksumscalar(buf, n);
+}
+
+int kernelcompare(const volatile _SPM int *buf, const unsigned int *expected, int n) {
+#ifdef KERNELSIMD
+  if (kernelsimdlevel() == 2)
+    return compareavx2((const int *)buf, expected, n);
+  if (kernelsimdlevel() == 1)
+    return comparesse((const int *)buf, expected, n);
+#endif
+  return comparescalar(buf, expected, n);
+}
+
+void kernelsummary(const volatile _SPM int *buf, int n, KernelSummary *summary) {
+#ifdef KERNELSIMD
+  if (kernelsimdlevel() == 2) {
+    summaryavx2((const int *)buf, n, summary);
+    return;
+  }
+  if (kernelsimdlevel() == 1) {
+    summarysse((const int *)buf, n, summary);
+    return;
+  }
+#endif
+  summaryscalar(buf, n, summary);
+}
+
+void kernelcopyout(int *dst, const volatile _SPM int *buf, int n) {
+#ifdef KERNELSIMD
+  if (kernelsimdlevel() == 2) {
+    copyoutavx2(dst, (const int *)buf, n);
+    return;
+  }
+#endif
+  copyoutscalar(dst, buf, n);
+}
+
+int kernelchangedmask(const volatile _SPM int *buf, int stride, const unsigned int *seen,
+                      int n, unsigned int *mask) {
+  maskclear(mask, n);
+#ifdef KERNELSIMD
+  if (kernelsimdlevel() == 2)
+    return changedavx2((const int *)buf, stride, seen, n, mask);
+  if (kernelsimdlevel() == 1)
+    return changedsse((const int *)buf, stride, seen, n, mask);
+#endif
+  return changedscalar(buf, stride, seen, 0, n, mask);
+}
+
+int kerneldiffmask(const int *a, const int *b, int n, unsigned int *mask) {
+  maskclear(mask, n);
+#ifdef KERNELSIMD
+  if (kernelsimdlevel() == 2)
+    return changedavx2(a, 1, (const unsigned int *)b, n, mask);
+  if (kernelsimdlevel() == 1)
+    return changedsse(a, 1, (const unsigned int *)b, n, mask);
+#endif
+  return diffscalar(a, b, 0, n, mask);
+}
+
+void kernelxor(int *dst, const int *a, const int *b, int n) {
+#ifdef KERNELSIMD
+  if (kernelsimdlevel() == 2) {
+    xoravx2(dst, a, b, n);
+    return;
+  }
+#endif
+  xorscalar(dst, a, b, 0, n);
+}
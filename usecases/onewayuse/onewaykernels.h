@@ -0,0 +1,53 @@
+//onewaykernels.h
+#ifndef ONEWAYKERNELS_H
+#define ONEWAYKERNELS_H
+
+#include "onewaysim.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Kernels for slot-sized rx (and tx) buffers. On the PC they use SSE4.1 or
+// AVX2 when the CPU has it (checked at run time), otherwise, and on patmos,
+// plain loops with one volatile load per word. A kernel reads each word of
+// the buffer once, so a buffer that the NoC updates meanwhile may mix old
+// and new words, as with any other read of the buffer.
+
+// sum, minimum, and maximum of the words of a buffer
+typedef struct KernelSummary {
+  unsigned int sum;
+  int min;
+  int max;
+} KernelSummary;
+
+// Fletcher-style checksum: the word sum and the position weighted word sum
+// (sum of (n - i) * word i) folded into 32 bits, so reordered words differ
+unsigned int kernelchecksum(const volatile _SPM int *buf, int n);
+
+// index of the first word that differs from expected (-1 when all match)
+int kernelcompare(const volatile _SPM int *buf, const unsigned int *expected, int n);
+
+// sum, min, and max of n > 0 words
+void kernelsummary(const volatile _SPM int *buf, int n, KernelSummary *summary);
+
+// copy n words out of a buffer
+void kernelcopyout(int *dst, const volatile _SPM int *buf, int n);
+
+// set bit i of mask ((n + 31) / 32 words) when word i * stride of buf
+// differs from seen[i], e.g., one word of each of n slots; returns the number
+// of set bits
+int kernelchangedmask(const volatile _SPM int *buf, int stride, const unsigned int *seen,
+                      int n, unsigned int *mask);
+
+// the same for two arrays in local memory: bit i when a[i] != b[i]
+int kerneldiffmask(const int *a, const int *b, int n, unsigned int *mask);
+
+// dst[i] = a[i] ^ b[i] for arrays in local memory (dst may be a or b)
+void kernelxor(int *dst, const int *a, const int *b, int n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
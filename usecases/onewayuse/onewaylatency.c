@@ -0,0 +1,133 @@
+//onewaylatency.c
+#include "onewaylatency.h"
+
+// The NI reads a word in the cycle of its phase, so a word written in cycle t
+// goes with the first read after t. For a message, the latency from t is the
+// longest wait of its words plus the delay of their route. It goes down
+// until the cycle before a read of one of its words and jumps up by a
+// hyperperiod after it, so the best case is in a cycle before a read and
+// the worst case in the cycle of a read.
+
+// the slots of a core pair with the injection cycle and the route delay
+typedef struct LatencyPair {
+  int slots;
+  int inject[PAIRSLOTSMAX];
+  int delay[PAIRSLOTSMAX];
+} LatencyPair;
+
+static _SIMLOCAL LatencyPair latencypairs[CORES][CORES];
+static _SIMLOCAL int latencyperiod;
+static _SIMLOCAL unsigned int latencymax;
+
+void latencyinit() {
+  Channel ch;
+  latencyperiod = getschedulelength();
+  latencymax = 0;
+  for (int txcore = 0; txcore < CORES; txcore++) {
+    for (int rxcore = 0; rxcore < CORES; rxcore++) {
+      LatencyPair *p = &latencypairs[txcore][rxcore];
+      p->slots = 0;
+      if (rxcore == txcore)
+        continue;
+      channelinit(&ch, txcore, rxcore);
+      p->slots = ch.slots;
+      for (int k = 0; k < ch.slots; k++) {
+        p->inject[k] = getrouteinject(ch.txslot[k]);
+        p->delay[k] = getroutehops(ch.txslot[k]) + NIDELAY;
+        unsigned int worst = gethyperperiodcycles() + p->delay[k];
+        latencymax = (worst > latencymax) ? worst : latencymax;
+      }
+    }
+  }
+}
+
+// cycles from a write in cycle t (of the hyperperiod) until the words w ..
+// w+n-1 of the pair are all readable
+static unsigned int latencycompletion(const LatencyPair *p, int w, int n, int t) {
+  unsigned int done = 0;
+  for (int k = 0; k < p->slots; k++) {
+    int first = (w > k * WORDS) ? w - k * WORDS : 0;
+    int last = (w + n < (k + 1) * WORDS) ? w + n - 1 - k * WORDS : WORDS - 1;
+    if (first > last)
+      continue;
+    int wait;
+    if (t < first * latencyperiod + p->inject[k]) {
+      // all words are read later in this hyperperiod
+      wait = last * latencyperiod + p->inject[k] - t;
+    } else {
+      // the last word read up to t waits for the next hyperperiod
+      int before = (t - p->inject[k]) / latencyperiod;
+      before = (before < last) ? before : last;
+      wait = before * latencyperiod + p->inject[k] - t + gethyperperiodcycles();
+    }
+    if ((unsigned int)(wait + p->delay[k]) > done)
+      done = wait + p->delay[k];
+  }
+  return done;
+}
+
+LatencyBound getmessagelatency(int txcore, int rxcore, int w, int n) {
+  LatencyBound bound = {0, 0, 0};
+  const LatencyPair *p = &latencypairs[txcore][rxcore];
+  if (w < 0 || n <= 0 || w + n > p->slots * WORDS)
+    return bound;
+  int hyperperiod = gethyperperiodcycles();
+  bound.best = 0xffffffff;
+  for (int k = 0; k < p->slots; k++) {
+    int first = (w > k * WORDS) ? w - k * WORDS : 0;
+    int last = (w + n < (k + 1) * WORDS) ? w + n - 1 - k * WORDS : WORDS - 1;
+    for (int i = first; i <= last; i++) {
+      int phase = i * latencyperiod + p->inject[k];
+      unsigned int best = latencycompletion(p, w, n, (phase + hyperperiod - 1) % hyperperiod);
+      unsigned int worst = latencycompletion(p, w, n, phase);
+      bound.best = (best < bound.best) ? best : bound.best;
+      bound.worst = (worst > bound.worst) ? worst : bound.worst;
+    }
+  }
+  // written in the last cycle before the hyperperiod
+  bound.round = latencycompletion(p, w, n, hyperperiod - 1);
+  return bound;
+}
+
+LatencyBound getwordlatency(int txcore, int rxcore, int w) {
+  return getmessagelatency(txcore, rxcore, w, 1);
+}
+
+LatencyBound getbufferlatency(int txcore, int rxcore, int buffers, int b) {
+  int size = latencypairs[txcore][rxcore].slots * WORDS / buffers;
+  return getmessagelatency(txcore, rxcore, b * size, size);
+}
+
+unsigned int getmaxlatency() {
+  return latencymax;
+}
+
+bool bufsettled(unsigned int *until) {
+  unsigned int now = getnoccycles();
+  if (*until == 0) {
+    *until = now + gethyperperiodcycles();
+    // 0 means not seen
+    *until = (*until == 0) ? 1 : *until;
+  }
+  return (int)(now - *until) >= 0;
+}
+
+void showlatencies(int buffers) {
+  printf("bound,txcore,rxcore,slots,hops,wordbest,wordworst,buffer,bufferbest,bufferworst,bufferround\n");
+  for (int txcore = 0; txcore < CORES; txcore++) {
+    for (int rxcore = 0; rxcore < CORES; rxcore++) {
+      const LatencyPair *p = &latencypairs[txcore][rxcore];
+      if (p->slots == 0)
+        continue;
+      LatencyBound word = getwordlatency(txcore, rxcore, 0);
+      for (int b = 0; b < buffers; b++) {
+        LatencyBound buffer = getbufferlatency(txcore, rxcore, buffers, b);
+        printf("bound,%d,%d,%d,%d,%u,%u,%d,%u,%u,%u\n", txcore, rxcore, p->slots,
+               p->delay[0] - NIDELAY, word.best, word.worst, b, buffer.best,
+               buffer.worst, buffer.round);
+      }
+    }
+  }
+  printf("largest worst-case latency: %u cycles (hyperperiod %d cycles)\n",
+         getmaxlatency(), gethyperperiodcycles());
+}
@@ -0,0 +1,65 @@
+//onewaylatency.h
+#ifndef ONEWAYLATENCY_H
+#define ONEWAYLATENCY_H
+
+#include "onewaysim.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Static write-to-read latency of the words of each core pair, from the route
+// strings, WORDS, and the slots of the pair (its Channel). The tx NI reads word
+// w of tx slot s in cycle w * L + getrouteinject(s) of each hyperperiod of
+// H = WORDS * L cycles (L the schedule length), and the word is in the rx
+// memory getroutehops(s) + NIDELAY cycles later. So a word is readable at the
+// earliest one cycle more than that delay after its write (written just before
+// the NI reads it) and at the latest H cycles more (written when the NI reads
+// it). A message of several words is readable when its last word is. A
+// message written just before a hyperperiod, as a core does in a round, has
+// one latency, the round latency.
+// The latencies of the buffers of a slot (DOUBLEBUFFERS, as use-cases 4 and 6
+// use) are those of messages of their words.
+
+typedef struct LatencyBound {
+  // clock cycles from the write on the tx core until the rx core can read
+  unsigned int best;
+  unsigned int worst;
+  // written in the last cycle before a hyperperiod
+  unsigned int round;
+} LatencyBound;
+
+// analyze all core pairs (called by txrxmapsinit())
+void latencyinit();
+
+// word w of the channel from txcore to rxcore (see Channel)
+LatencyBound getwordlatency(int txcore, int rxcore, int w);
+// the n words from word w of the channel, written at once
+LatencyBound getmessagelatency(int txcore, int rxcore, int w, int n);
+// buffer b when the channel is split into buffers of equal size
+LatencyBound getbufferlatency(int txcore, int rxcore, int buffers, int b);
+// the largest worst case of all core pairs and words
+unsigned int getmaxlatency();
+
+// Torn buffers: the tx NI sends word w of a slot in period w of each
+// hyperperiod, so a write that starts while the NI is in the middle of the
+// slot goes out over two hyperperiods: the words above the NI in this one and
+// the words below it in the next. An rx core can thus see the new head and
+// tail of a buffer around words that are still old, and head == tail does not
+// mean that the buffer has arrived. A word that was written before the head
+// is readable at the latest one hyperperiod after the head is, so a buffer is
+// whole one hyperperiod after the rx core first sees its new head and tail.
+// bufsettled() keeps that noc cycle in *until (0 before the first sight, the
+// caller clears it when it takes the buffer) and returns true when it has
+// come; until then the caller waits with waitnoccycles(cpuid, *until).
+bool bufsettled(unsigned int *until);
+
+// print the latencies of all core pairs, for their words and for the
+// buffers of a channel split into buffers
+void showlatencies(int buffers);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
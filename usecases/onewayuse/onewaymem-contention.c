@@ -0,0 +1,97 @@
+/*
+  One-Way Shared Memory
+  Contention micro-benchmark for the per core state layout, runs on the PC
+
+  Copyright: CBS, DTU
+  Authors: Rasmus Ulslev Pedersen, Martin Schoeberl
+  License: Simplified BSD
+*/
+
+#include "onewaysim.h"
+
+// Each of CORES host threads updates its own loop counter, state, ready flag,
+// and print cursor, like the control loop of a use-case does. This is done
+// once with the densely packed arrays of the old layout and once with the
+// cache line aligned State, CoreFlags, and PrintCursor blocks.
+//
+// make contention
+
+#define CONTENTIONLOOPS 20000000
+
+// the old layout of the common state, flags, and print cursors
+typedef struct PackedState {
+  int state;
+  int loopcount;
+  bool corerunning;
+  bool coredone;
+  bool runcore;
+  void *local;
+} PackedState;
+
+static PackedState packedstates[CORES];
+static volatile bool packedready[CORES];
+static volatile int packedmi[CORES];
+
+static State alignedstates[CORES];
+static volatile CoreFlags alignedflags[CORES];
+static volatile PrintCursor alignedcursors[CORES];
+
+static bool aligned;
+
+// the cpu id passed to each thread (declared in onewaysim.h)
+int coreid[CORES];
+
+static void *contentionwork(void *cpuidptr) {
+  int cpuid = *((int*)cpuidptr);
+  if (aligned) {
+    volatile State *state = &alignedstates[cpuid];
+    for (int i = 0; i < CONTENTIONLOOPS; i++) {
+      state->state = i & 0x7;
+      state->loopcount++;
+      alignedflags[cpuid].ready = !alignedflags[cpuid].ready;
+      alignedcursors[cpuid].mi++;
+    }
+  } else {
+    volatile PackedState *state = &packedstates[cpuid];
+    for (int i = 0; i < CONTENTIONLOOPS; i++) {
+      state->state = i & 0x7;
+      state->loopcount++;
+      packedready[cpuid] = !packedready[cpuid];
+      packedmi[cpuid]++;
+    }
+  }
+  return NULL;
+}
+
+// run all cores as threads and return the wall time in ms
+static double contentionrun(bool usealigned) {
+  pthread_t threads[CORES];
+  struct timespec start, end;
+  aligned = usealigned;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int c = 0; c < CORES; c++)
+    pthread_create(&threads[c], NULL, contentionwork, &coreid[c]);
+  for (int c = 0; c < CORES; c++)
+    pthread_join(threads[c], NULL);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+  for (int c = 0; c < CORES; c++)
+    coreid[c] = c;
+
+  printf("contention: %d threads, %d loops each\n", CORES, CONTENTIONLOOPS);
+  printf("  packed:  sizeof(State) = %2d, %d cores per %d byte line\n",
+         (int)sizeof(PackedState), CACHELINE / (int)sizeof(PackedState), CACHELINE);
+  printf("  aligned: sizeof(State) = %2d, sizeof(CoreFlags) = %d, sizeof(PrintCursor) = %d\n",
+         (int)sizeof(State), (int)sizeof(CoreFlags), (int)sizeof(PrintCursor));
+
+  double packedms = contentionrun(false);
+  double alignedms = contentionrun(true);
+  printf("  packed:  %8.1f ms\n", packedms);
+  printf("  aligned: %8.1f ms\n", alignedms);
+  printf("  speedup: %8.2f\n", packedms / alignedms);
+  return 0;
+}
@@ -0,0 +1,174 @@
+/*
+  One-Way Shared Memory
+  Live monitor of a simulation on the PC through its monitor segment
+
+  Copyright: CBS, DTU
+  Authors: Rasmus Ulslev Pedersen, Martin Schoeberl
+  License: Simplified BSD
+*/
+
+#include "onewaymonitor.h"
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+// The monitor maps the segment of a simulator that runs with -m <name> (see
+// onewaymonitor.h) read only and copies it at each refresh. For each rx slot
+// that changed since the previous refresh, it prints the tx slot routed to it,
+// the rounds with a change per 1000 simulated rounds, the last round with a
+// change, and how many words differ from the previous copy with the first of
+// them. The simulator only keeps the counters and the copy of the rx memory,
+// so it runs at full speed whatever the refresh rate.
+//
+// usage: monitor [-i <ms>] [-n <refreshes>] [-a] [<name>]
+//   -i refresh interval (default 500 ms), -n stop after that many refreshes,
+//   -a print all slots, not only the changed ones
+
+typedef struct MonitorCopy {
+  MonitorHeader header;
+  MonitorSlot *slots;
+  int *rx;
+} MonitorCopy;
+
+static double walltime() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void sleepms(int ms) {
+  struct timespec t = {ms / 1000, (ms % 1000) * 1000000L};
+  nanosleep(&t, NULL);
+}
+
+// map the segment, or NULL while there is no simulator
+static MonitorHeader *monitorattach(const char *name) {
+  int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0)
+    return NULL;
+  MonitorHeader header;
+  MonitorHeader *segment = NULL;
+  if (pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+      memcmp(header.magic, MONITORMAGIC, sizeof(MONITORMAGIC)) == 0) {
+    void *p = mmap(NULL, MONITORSIZE(header.cores, header.tdmslots, header.words),
+                   PROT_READ, MAP_SHARED, fd, 0);
+    segment = (p == MAP_FAILED) ? NULL : p;
+  }
+  close(fd);
+  return segment;
+}
+
+// a consistent copy of the segment (between two rounds), false when the
+// simulator kept delivering
+static bool monitorcopy(const MonitorHeader *segment, MonitorCopy *copy) {
+  size_t nslots = (size_t)segment->cores * segment->tdmslots;
+  for (int retry = 0; retry < 1000; retry++) {
+    unsigned int seq = __atomic_load_n(&segment->seq, __ATOMIC_ACQUIRE);
+    if (seq & 1)
+      continue;
+    copy->header = *segment;
+    memcpy(copy->slots, MONITORSLOTS(segment), nslots * sizeof(MonitorSlot));
+    memcpy(copy->rx, MONITORRX(segment), nslots * segment->words * sizeof(int));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&segment->seq, __ATOMIC_RELAXED) == seq)
+      return true;
+  }
+  return false;
+}
+
+static void monitorprint(const MonitorCopy *now, const MonitorCopy *prev, double seconds, bool all) {
+  const MonitorHeader *h = &now->header;
+  unsigned int rounds = h->round - prev->header.round;
+  int changed = 0;
+  for (int i = 0; i < h->cores * h->tdmslots; i++)
+    changed += now->slots[i].updates != prev->slots[i].updates;
+  if (isatty(STDOUT_FILENO))
+    printf("\033[H\033[J");
+  printf("round %u (+%u, %.0f rounds/s), use-case %d%s: %d of %d rx slots changed\n",
+         h->round, rounds, seconds > 0 ? rounds / seconds : 0.0, h->usecase,
+         h->running ? "" : " (done)", changed, h->cores * h->tdmslots);
+  for (int c = 0; c < h->cores; c++) {
+    for (int j = 0; j < h->tdmslots; j++) {
+      int i = c * h->tdmslots + j;
+      const MonitorSlot *slot = &now->slots[i];
+      unsigned int updates = slot->updates - prev->slots[i].updates;
+      if (!all && updates == 0)
+        continue;
+      const int *rx = &now->rx[i * h->words];
+      const int *old = &prev->rx[i * h->words];
+      int diff = 0;
+      int first = -1;
+      for (int w = 0; w < h->words; w++) {
+        if (rx[w] != old[w]) {
+          first = (first < 0) ? w : first;
+          diff++;
+        }
+      }
+      printf("  rx %2d.%-2d <- tx %2d.%-2d  %4u/1000 rounds  last %8u  diff %5d words",
+             c, j, slot->txcore, slot->txslot, rounds > 0 ? updates * 1000 / rounds : 0,
+             slot->lastround, diff);
+      if (first >= 0)
+        printf(", [%d] 0x%08x -> 0x%08x", first, old[first], rx[first]);
+      printf("\n");
+    }
+  }
+  fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+  const char *name = MONITORNAME;
+  int interval = 500;
+  int refreshes = -1;
+  bool all = false;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+      interval = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      refreshes = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-a") == 0) {
+      all = true;
+    } else if (argv[i][0] == '-') {
+      printf("usage: %s [-i <ms>] [-n <refreshes>] [-a] [<name>]\n", argv[0]);
+      exit(1);
+    } else {
+      name = argv[i];
+    }
+  }
+
+  MonitorHeader *segment;
+  printf("monitor: waiting for %s\n", name);
+  while ((segment = monitorattach(name)) == NULL)
+    sleepms(interval);
+
+  size_t nslots = (size_t)segment->cores * segment->tdmslots;
+  MonitorCopy copies[2];
+  for (int k = 0; k < 2; k++) {
+    copies[k].slots = calloc(nslots, sizeof(MonitorSlot));
+    copies[k].rx = calloc(nslots * segment->words, sizeof(int));
+  }
+  MonitorCopy *prev = &copies[0];
+  MonitorCopy *now = &copies[1];
+  monitorcopy(segment, prev);
+  double last = walltime();
+  for (int n = 0; refreshes < 0 || n < refreshes; n++) {
+    sleepms(interval);
+    if (!monitorcopy(segment, now))
+      continue;
+    double t = walltime();
+    monitorprint(now, prev, t - last, all);
+    last = t;
+    MonitorCopy *swap = prev;
+    prev = now;
+    now = swap;
+    if (!prev->header.running)
+      break;
+  }
+  return 0;
+}
@@ -57,8 +57,8 @@ void nocstart(void (*corefuncptr)(void *)){
   runcores = true;
   
   for(int i = 0; i < CORES; i++){ 
-    coreready[i] = false;
-    coredone[i] = false;
+    coreflags[i].ready = false;
+    coreflags[i].done = false;
     coreid[i] = i;
   }
 
@@ -89,56 +89,49 @@ void nocwaitdone()
 ///////////////////////////////////////////////////////////////////////////////
 
 // we are core 0
+// there is no command line on patmos: run the use-case given with
+// 'make usecase=<id> onpatmos' or all registered use-cases one after the other
 int main(int argc, char *argv[])
 {
   setlocale(LC_ALL,"");
-  printf("*******************************************\n");
-  printf("****onewaymem: run use-case %d on patmos****\n", USECASE);
-  printf("*******************************************\n");
-
-  // thread function pointer which is the use case
-  void (*corefuncptr)(void *);
-  
-#if USECASE==0
-  printf("USECASE = 0; corethreadtestwork\n");
-  corefuncptr = &corethreadtestwork;
-#elif USECASE==1
-  printf("USECASE == 1: corethreadtbswork\n");
-  corefuncptr = &corethreadtbswork;
-#elif USECASE==2
-  printf("USECASE == 2: corethreadhswork\n");
-  corefuncptr = &corethreadhswork;
-#elif USECASE==3
-  printf("USECASE == 3: corethreadeswork\n");
-  corefuncptr = &corethreadeswork;
-#elif USECASE==4
-  printf("USECASE == 4: corethreadsdbwork\n");
-  corefuncptr = &corethreadsdbwork;
-#else
-  printf("Unimplemented USECASE value. Exit...\n");
-  exit(0);
-#endif
 
   printf("Init...\n");
   nocinit();
-  printf("Start...\n");
-  
-  nocstart(corefuncptr);
-  
-  printf("Wait...\n");
-  
-  // core 0 is done, wait for the others
-  nocwaitdone();
-  printf("Done...\n");
-  
-  for (int i=0; i<CORES; ++i) {
-    printf("Sync print from core %d:\n", i);
-    sync_print_core(i);
+
+  for (int u = 0; u < NUSECASES; u++) {
+    const UseCase *usecase = usecases[u];
+#ifdef USECASE
+    if (usecase->id != USECASE)
+      continue;
+#endif
+    printf("*******************************************\n");
+    printf("****onewaymem: run use-case %d on patmos****\n", usecase->id);
+    printf("*******************************************\n");
+    printf("USECASE == %d: %s\n", usecase->id, usecase->name);
+
+    statearenareset();
+    if (!usecasestatesinit(usecase))
+      exit(0);
+
+    printf("Start...\n");
+    nocstart(usecase->corefunc);
+
+    printf("Wait...\n");
+
+    // core 0 is done, wait for the others
+    nocwaitdone();
+    printf("Done...\n");
+
+    for (int i=0; i<CORES; ++i) {
+      printf("Sync print from core %d:\n", i);
+      sync_print_core(i);
+    }
+    sync_printreset();
+
+    printf("***********************************\n");
+    printf("Use-case %d result [pass/fail]: %s\n", usecase->id, allfinishedok());
+    printf("***********************************\n");
   }
 
-  printf("***********************************\n");
-  printf("Use-case %d result [pass/fail]: %s\n", USECASE, allfinishedok());
-  printf("***********************************\n");
-  
   return 0;
 }
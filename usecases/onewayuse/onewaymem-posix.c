@@ -0,0 +1,295 @@
+/*
+  One-Way Shared Memory
+  Runs each core as a Linux process with a NoC daemon process
+
+  Copyright: CBS, DTU
+  Authors: Rasmus Ulslev Pedersen, Martin Schoeberl
+  License: Simplified BSD
+*/
+
+#define _GNU_SOURCE
+#include "onewaysim.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+// The tx and rx window of each core lives in its own POSIX shared memory
+// segment (/oneway-tx<core> and /oneway-rx<core>), laid out like the
+// ONEWAY_BASE window on patmos: slot j starts at word j*WORDS. The main
+// process forks one process per core, which keeps only its own windows
+// mapped, and then acts as the NoC daemon: it copies the tx slots to the rx slots word for
+// word like the TDM schedule until the use-case is done.
+//
+// The flags, registers, states, and use-case data that the cores share in
+// main memory on patmos (_UNCACHED and _SHARED) are in the onewayshared
+// section, which is mapped shared between the processes before the fork.
+//
+// make posix usecase=<id>
+
+// start and end of the onewayshared section and start of .bss, which
+// should follow it directly (provided by the linker)
+extern char __start_onewayshared[];
+extern char __stop_onewayshared[];
+extern char __bss_start[];
+
+volatile int *alltxmem[CORES];
+volatile int *allrxmem[CORES];
+
+// rx core and rx slot of each tx core and tx slot
+static int routerxcore[CORES][TDMSLOTS];
+static int routerxslot[CORES][TDMSLOTS];
+
+static pid_t corepids[CORES];
+
+void statework(State **state, int cpuid) {
+  *state = &states[cpuid];
+  (*state)->runcore = true;
+}
+
+// page align the start of the onewayshared section and of .bss, so the
+// pages of the section hold no other data
+static _SHARED char sharedalign[1] __attribute__((used, aligned(4096)));
+static char bssalign[1] __attribute__((used, aligned(4096)));
+
+// map the onewayshared section shared, so it stays shared after the fork
+static void sharedinit() {
+  uintptr_t pagesize = sysconf(_SC_PAGESIZE);
+  uintptr_t start = (uintptr_t)__start_onewayshared;
+  uintptr_t stop = ((uintptr_t)__stop_onewayshared + pagesize - 1) & ~(pagesize - 1);
+  size_t size = stop - start;
+  if ((start & (pagesize - 1)) != 0 || (uintptr_t)__stop_onewayshared != (uintptr_t)__bss_start) {
+    printf("onewayshared section shares pages with other data\n");
+    exit(1);
+  }
+
+  // fill a shared mapping and move it over the section in one step
+  void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (p != MAP_FAILED)
+    memcpy(p, (void *)start, size);
+  if (p == MAP_FAILED ||
+      mremap(p, size, size, MREMAP_MAYMOVE | MREMAP_FIXED, (void *)start) == MAP_FAILED) {
+    perror("onewayshared");
+    exit(1);
+  }
+}
+
+// create and map one window segment
+static volatile int *windowinit(const char *dir, int c) {
+  char name[32];
+  size_t size = TDMSLOTS * WORDS * sizeof(int);
+  sprintf(name, "/oneway-%s%d", dir, c);
+  int fd = shm_open(name, O_CREAT | O_RDWR | O_TRUNC, 0600);
+  if (fd < 0 || ftruncate(fd, size) != 0) {
+    perror(name);
+    exit(1);
+  }
+  void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) {
+    perror(name);
+    exit(1);
+  }
+  return p;
+}
+
+static void windowsunlink() {
+  char name[32];
+  for (int c = 0; c < CORES; c++) {
+    sprintf(name, "/oneway-tx%d", c);
+    shm_unlink(name);
+    sprintf(name, "/oneway-rx%d", c);
+    shm_unlink(name);
+  }
+}
+
+// point the core[] views into the windows and clear them
+static void nocmem() {
+  for (int i = 0; i < CORES; i++) {
+    for (int j = 0; j < TDMSLOTS; j++) {
+      core[i].tx[j] = alltxmem[i] + j * WORDS;
+      core[i].rx[j] = allrxmem[i] + j * WORDS;
+    }
+    memset((void *)alltxmem[i], 0, TDMSLOTS * WORDS * sizeof(int));
+    memset((void *)allrxmem[i], 0, TDMSLOTS * WORDS * sizeof(int));
+  }
+}
+
+// shared memory and window initialization
+void nocinit()
+{
+  printf("in nocinit()...\n");
+  sharedinit();
+  txrxmapsinit();
+  showmappings();
+
+  for (int c = 0; c < CORES; c++) {
+    alltxmem[c] = windowinit("tx", c);
+    allrxmem[c] = windowinit("rx", c);
+    coreid[c] = c;
+  }
+  for (int txcore = 0; txcore < CORES; txcore++) {
+    for (int txslot = 0; txslot < TDMSLOTS; txslot++) {
+      int rxcore = getrxcorefromtxcoreslot(txcore, txslot);
+      routerxcore[txcore][txslot] = rxcore;
+      routerxslot[txcore][txslot] = getrxslotfromrxcoretxcoreslot(rxcore, txcore, txslot);
+    }
+  }
+  nocmem();
+}
+
+// the control loop of one core process
+static void coreprocess(int cpuid, void (*corefuncptr)(void *)) {
+  // keep only the own windows mapped
+  for (int c = 0; c < CORES; c++) {
+    if (c == cpuid)
+      continue;
+    munmap((void *)alltxmem[c], TDMSLOTS * WORDS * sizeof(int));
+    munmap((void *)allrxmem[c], TDMSLOTS * WORDS * sizeof(int));
+  }
+
+  // start all cores together
+  coreflags[cpuid].ready = true;
+  for (int c = 0; c < CORES; c++)
+    while (!coreflags[c].ready)
+      sched_yield();
+
+  while (runcores) {
+    corefuncptr(&coreid[cpuid]);
+    sched_yield();
+  }
+  _exit(0);
+}
+
+// fork the core processes
+void nocstart(void (*corefuncptr)(void *)) {
+  runcores = true;
+  HYPERPERIOD_REGISTER = 0;
+  TDMROUND_REGISTER = 0;
+  for (int c = 0; c < CORES; c++) {
+    coreflags[c].ready = false;
+    coreflags[c].done = false;
+  }
+  fflush(stdout);
+
+  for (int c = 0; c < CORES; c++) {
+    corepids[c] = fork();
+    if (corepids[c] < 0) {
+      perror("fork");
+      runcores = false;
+      return;
+    }
+    if (corepids[c] == 0)
+      coreprocess(c, corefuncptr);
+  }
+}
+
+// the NoC daemon: deliver one memory block per round until the cores stop
+void noccontrol()
+{
+  while (runcores) {
+    for (int w = 0; w < WORDS; w++) {
+      for (int txcore = 0; txcore < CORES; txcore++) {
+        for (int txslot = 0; txslot < TDMSLOTS; txslot++) {
+          allrxmem[routerxcore[txcore][txslot]][routerxslot[txcore][txslot] * WORDS + w] =
+            alltxmem[txcore][txslot * WORDS + w];
+        }
+      }
+    }
+    TDMROUND_REGISTER += WORDS;
+    HYPERPERIOD_REGISTER++;
+
+    // a core process that died stops the use-case
+    int status;
+    pid_t pid = waitpid(-1, &status, WNOHANG);
+    if (pid > 0) {
+      for (int c = 0; c < CORES; c++) {
+        if (corepids[c] == pid) {
+          corepids[c] = 0;
+          if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            printf("core %d process died (status 0x%x): use case not ok\n", c, status);
+            runcores = false;
+          }
+        }
+      }
+    }
+    sched_yield();
+  }
+}
+
+void nocwaitdone()
+{
+  for (int c = 0; c < CORES; c++) {
+    if (corepids[c] > 0)
+      waitpid(corepids[c], NULL, 0);
+    corepids[c] = 0;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//posix main
+///////////////////////////////////////////////////////////////////////////////
+
+// we are the NoC daemon, the cores are child processes
+// usage: a.out all | <use-case id> ...
+//   the selected use-cases run one after the other
+int main(int argc, char *argv[])
+{
+  const UseCase *selected[NUSECASES];
+  int nselected = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "all") == 0) {
+      for (int u = 0; u < NUSECASES && nselected < NUSECASES; u++)
+        selected[nselected++] = usecases[u];
+    } else {
+      const UseCase *usecase = getusecase(atoi(argv[i]));
+      if (usecase == NULL || nselected == NUSECASES) {
+        printf("Unimplemented use-case %s. Exit\n", argv[i]);
+        exit(0);
+      }
+      selected[nselected++] = usecase;
+    }
+  }
+  if (nselected == 0) {
+    printf("usage: %s all | <use-case id> ...\n", argv[0]);
+    for (int u = 0; u < NUSECASES; u++)
+      printf("  %d: %s\n", usecases[u]->id, usecases[u]->name);
+    exit(0);
+  }
+
+  nocinit();
+
+  for (int i = 0; i < nselected; i++) {
+    const UseCase *usecase = selected[i];
+    printf("*******************************************\n");
+    printf("****onewaymem: run use-case %d as %d processes****\n", usecase->id, CORES);
+    printf("*******************************************\n");
+    printf("USECASE == %d: %s\n", usecase->id, usecase->name);
+
+    nocmem();
+    statearenareset();
+    if (!usecasestatesinit(usecase))
+      break;
+
+    nocstart(usecase->corefunc);
+    noccontrol();
+    nocwaitdone();
+    printf("Done...\n");
+
+    for (int c = 0; c < CORES; ++c) {
+      printf("Sync print from core %d:\n", c);
+      sync_print_core(c);
+    }
+    sync_printreset();
+
+    printf("***************************************************************\n");
+    printf("Use-case %d result [pass/fail]: %s\n", usecase->id, allfinishedok());
+    printf("***************************************************************\n");
+  }
+
+  windowsunlink();
+  return 0;
+}
@@ -0,0 +1,235 @@
+/*
+  One-Way Shared Memory
+  Parallel parameter sweep: many simulated NoCs as threads in one process
+
+  Copyright: CBS, DTU
+  Authors: Rasmus Ulslev Pedersen, Martin Schoeberl
+  License: Simplified BSD
+*/
+
+#include <dlfcn.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Each configuration (grid size with its schedule, WORDS, DOUBLEBUFFERS) is a
+// simulator library oneway-<nodes>-<words>-<doublebuffers>.so built with
+// RUNINSWEEP, where all simulator globals are thread local. A job runs one
+// use-case on one configuration with sweeprun() in the library. The jobs are
+// spread over one deque per worker thread. A worker takes jobs from the
+// bottom of its own deque and, when that is empty, steals from the top of
+// the others. All results go into one table with the columns of 'make sweep'
+// and the use-case:
+//   nodes,words,doublebuffers,usecase,kind,txcore,rxcore,value
+// with the kinds result (1 pass, 0 fail), rounds, ms, the "throughput,"
+// report lines (pair, util, bisection, total), and the "latency," report
+// lines (latmin, latmedian, latp99, latmax, latbound).
+//
+// usage: psweep [-j <threads>] <table.csv> <library.so> ... -u <use-case id> ...
+//   the default is one thread per host core
+
+typedef char *(*SweepRun)(int usecaseid, bool *pass, int *rounds);
+
+typedef struct Config {
+  const char *path;
+  int nodes;
+  int words;
+  int doublebuffers;
+  SweepRun run;
+} Config;
+
+typedef struct Job {
+  Config *config;
+  int usecase;
+  bool pass;
+  int rounds;
+  double ms;
+  char *log;
+} Job;
+
+// the jobs of one worker: it pops at the bottom, thieves take the top
+typedef struct Deque {
+  pthread_mutex_t lock;
+  int *jobs;
+  int top;
+  int bottom;
+} Deque;
+
+static Job *jobs;
+static int njobs;
+static Deque *deques;
+static int nworkers;
+
+static int dequepop(Deque *d) {
+  int job = -1;
+  pthread_mutex_lock(&d->lock);
+  if (d->bottom > d->top)
+    job = d->jobs[--d->bottom];
+  pthread_mutex_unlock(&d->lock);
+  return job;
+}
+
+static int dequesteal(Deque *d) {
+  int job = -1;
+  pthread_mutex_lock(&d->lock);
+  if (d->bottom > d->top)
+    job = d->jobs[d->top++];
+  pthread_mutex_unlock(&d->lock);
+  return job;
+}
+
+static double walltime() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void *worker(void *arg) {
+  int self = (int)(long)arg;
+  for (;;) {
+    int job = dequepop(&deques[self]);
+    // no job spawns new jobs, so all deques empty means done
+    for (int i = 1; job < 0 && i < nworkers; i++)
+      job = dequesteal(&deques[(self + i) % nworkers]);
+    if (job < 0)
+      return NULL;
+    Job *j = &jobs[job];
+    double start = walltime();
+    j->log = j->config->run(j->usecase, &j->pass, &j->rounds);
+    j->ms = (walltime() - start) * 1000;
+  }
+}
+
+// the report lines of a job log as table rows
+static void jobrows(FILE *table, Job *j) {
+  char prefix[64];
+  sprintf(prefix, "%d,%d,%d,%d", j->config->nodes, j->config->words,
+          j->config->doublebuffers, j->usecase);
+  fprintf(table, "%s,result,-1,-1,%d\n", prefix, j->pass);
+  fprintf(table, "%s,rounds,-1,-1,%d\n", prefix, j->rounds);
+  fprintf(table, "%s,ms,-1,-1,%.1f\n", prefix, j->ms);
+  for (char *line = j->log; line != NULL && *line != '\0'; ) {
+    char *end = strchr(line, '\n');
+    if (end != NULL)
+      *end = '\0';
+    char kind[16];
+    int txcore, rxcore, samples;
+    unsigned int value, min, median, p99, max, bound;
+    char *report;
+    if ((report = strstr(line, "throughput,")) != NULL &&
+        sscanf(report, "throughput,%15[a-z],%d,%d,%u", kind, &txcore, &rxcore, &value) == 4) {
+      fprintf(table, "%s,%s,%d,%d,%u\n", prefix, kind, txcore, rxcore, value);
+    } else if ((report = strstr(line, "latency,")) != NULL &&
+               sscanf(report, "latency,%d,%d,%d,%u,%u,%u,%u,%u", &txcore, &rxcore, &samples,
+                      &min, &median, &p99, &max, &bound) == 8) {
+      fprintf(table, "%s,latmin,%d,%d,%u\n", prefix, txcore, rxcore, min);
+      fprintf(table, "%s,latmedian,%d,%d,%u\n", prefix, txcore, rxcore, median);
+      fprintf(table, "%s,latp99,%d,%d,%u\n", prefix, txcore, rxcore, p99);
+      fprintf(table, "%s,latmax,%d,%d,%u\n", prefix, txcore, rxcore, max);
+      fprintf(table, "%s,latbound,%d,%d,%u\n", prefix, txcore, rxcore, bound);
+    }
+    line = (end != NULL) ? end + 1 : NULL;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  int first = 1;
+  nworkers = sysconf(_SC_NPROCESSORS_ONLN);
+  if (argc > 2 && strcmp(argv[1], "-j") == 0) {
+    nworkers = atoi(argv[2]);
+    first = 3;
+  }
+  if (argc < first + 3) {
+    printf("usage: %s [-j <threads>] <table.csv> <library.so> ... -u <use-case id> ...\n", argv[0]);
+    exit(1);
+  }
+  const char *tablename = argv[first];
+  Config *configs = calloc(argc, sizeof(Config));
+  int *usecases = calloc(argc, sizeof(int));
+  int nconfigs = 0;
+  int nusecases = 0;
+  bool inusecases = false;
+  for (int i = first + 1; i < argc; i++) {
+    if (strcmp(argv[i], "-u") == 0) {
+      inusecases = true;
+    } else if (inusecases) {
+      usecases[nusecases++] = atoi(argv[i]);
+    } else {
+      Config *c = &configs[nconfigs];
+      const char *name = strrchr(argv[i], '/') != NULL ? strrchr(argv[i], '/') + 1 : argv[i];
+      if (sscanf(name, "oneway-%d-%d-%d.so", &c->nodes, &c->words, &c->doublebuffers) != 3) {
+        printf("%s: not oneway-<nodes>-<words>-<doublebuffers>.so\n", argv[i]);
+        exit(1);
+      }
+      // each library keeps its own globals
+      void *lib = dlopen(argv[i], RTLD_NOW | RTLD_LOCAL);
+      c->run = (lib != NULL) ? (SweepRun)dlsym(lib, "sweeprun") : NULL;
+      if (c->run == NULL) {
+        printf("%s: %s\n", argv[i], dlerror());
+        exit(1);
+      }
+      c->path = argv[i];
+      nconfigs++;
+    }
+  }
+
+  njobs = nconfigs * nusecases;
+  jobs = calloc(njobs, sizeof(Job));
+  for (int c = 0; c < nconfigs; c++) {
+    for (int u = 0; u < nusecases; u++) {
+      jobs[c * nusecases + u].config = &configs[c];
+      jobs[c * nusecases + u].usecase = usecases[u];
+    }
+  }
+
+  if (nworkers < 1)
+    nworkers = 1;
+  if (nworkers > njobs)
+    nworkers = njobs > 0 ? njobs : 1;
+  // deal the jobs out round robin, the large grids end up on all workers
+  deques = calloc(nworkers, sizeof(Deque));
+  for (int w = 0; w < nworkers; w++) {
+    pthread_mutex_init(&deques[w].lock, NULL);
+    deques[w].jobs = calloc(njobs / nworkers + 1, sizeof(int));
+  }
+  for (int j = 0; j < njobs; j++) {
+    Deque *d = &deques[j % nworkers];
+    d->jobs[d->bottom++] = j;
+  }
+
+  printf("psweep: %d configurations x %d use-cases on %d threads\n", nconfigs, nusecases, nworkers);
+  double start = walltime();
+  pthread_t *threads = calloc(nworkers, sizeof(pthread_t));
+  for (int w = 0; w < nworkers; w++)
+    pthread_create(&threads[w], NULL, worker, (void *)(long)w);
+  for (int w = 0; w < nworkers; w++)
+    pthread_join(threads[w], NULL);
+  double seconds = walltime() - start;
+
+  FILE *table = fopen(tablename, "w");
+  if (table == NULL) {
+    perror(tablename);
+    exit(1);
+  }
+  fprintf(table, "nodes,words,doublebuffers,usecase,kind,txcore,rxcore,value\n");
+  int failed = 0;
+  double cpums = 0;
+  for (int j = 0; j < njobs; j++) {
+    jobrows(table, &jobs[j]);
+    cpums += jobs[j].ms;
+    if (!jobs[j].pass) {
+      failed++;
+      printf("fail: use-case %d on %s\n", jobs[j].usecase, jobs[j].config->path);
+    }
+    free(jobs[j].log);
+  }
+  fclose(table);
+  printf("psweep: %d jobs, %d failed, %.2f s (%.2f s of simulation)\n",
+         njobs, failed, seconds, cpums / 1000);
+  return 0;
+}
@@ -0,0 +1,397 @@
+/*
+  One-Way Shared Memory
+  All-to-all TDM schedules for the S4NOC on an n x m torus
+
+  Copyright: CBS, DTU
+  Authors: Rasmus Ulslev Pedersen, Martin Schoeberl
+  License: Simplified BSD
+*/
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The schedule generator writes the routes from one node to all others in the
+// format of ROUTESSTRING (onewaysim.h) and of ScheduleTable.scala: one route
+// per tx slot, in the order of injection, each with a leading space for every
+// cycle it waits, one of 'n', 'e', 's', or 'w' for each hop, and 'l' for the
+// cycle where it leaves the router to the rx NI. All routers run the same
+// schedule, so two routes must not use the same output port in the same
+// cycle, and the NI injects and takes one word per cycle.
+//
+// A weighted schedule has more than one route, and thus more than one tx and
+// rx slot, from each node to the node some rows down and columns right (-w),
+// for core pairs that carry more words than the others. As all nodes share
+// the schedule, each node gets the extra slots to its node at that offset.
+//
+// The routes are shortest paths on the torus, so the longest route is the
+// diameter of the grid. The generator searches for the shortest schedule:
+// it places the routes one after the other at the earliest cycle where one
+// of their paths is free, trying the preferred path of the route first. It
+// starts from the longest to the shortest route and from random orders of
+// about the same length, and then improves the best of them by swapping two
+// routes or changing the preferred path of one route, keeping the change when
+// the schedule gets no longer and the routes arrive no later in sum. It stops
+// at the lower bound (one injection per cycle, the longest route, and the
+// hops in each direction) or when it has done its tries.
+//
+// usage: schedule [-i <tries>] [-r <seed>] [-f c|scala] [-n <name>]
+//                 [-w <down>,<right>,<slots>]... <rows> <cols>
+//   -i tries of the search (default 20000), -r seed of the random choices,
+//   -f the format of the output (default c), -n the name of the schedule,
+//   -w the slots from each node to the node down rows and right columns
+
+#define MAXGRID 16
+#define MAXCORES 64
+// the routes of a weighted schedule
+#define MAXROUTES (4 * MAXCORES)
+// the longest schedule that the search considers
+#define MAXLEN 1024
+
+// the occupied ports of one cycle
+#define PORTN 0x01
+#define PORTE 0x02
+#define PORTS 0x04
+#define PORTW 0x08
+#define PORTL 0x10
+#define INJECT 0x20
+
+typedef struct Destination {
+  int hops;
+  // the shortest paths, each hops characters
+  int npaths;
+  char *paths;
+} Destination;
+
+typedef struct Route {
+  int dest;
+  // the path that is tried first
+  int pref;
+  int start;
+  int path;
+} Route;
+
+static int rows, cols, ndests, nroutes;
+static Destination dests[MAXCORES];
+static unsigned char busy[MAXLEN];
+static unsigned int seed = 1;
+
+static unsigned int schedrandom() {
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 16) & 0x7fff;
+}
+
+static int portbit(char c) {
+  switch (c) {
+  case 'n': return PORTN;
+  case 'e': return PORTE;
+  case 's': return PORTS;
+  case 'w': return PORTW;
+  default: return PORTL;
+  }
+}
+
+static void addpath(Destination *d, const char *path) {
+  d->paths = realloc(d->paths, (size_t)(d->npaths + 1) * d->hops);
+  memcpy(d->paths + (size_t)d->npaths * d->hops, path, d->hops);
+  d->npaths++;
+}
+
+// all orders of v vertical and h horizontal hops
+static void interleave(Destination *d, char *path, int at, int v, char vc, int h, char hc) {
+  if (v == 0 && h == 0) {
+    addpath(d, path);
+    return;
+  }
+  if (v > 0) {
+    path[at] = vc;
+    interleave(d, path, at + 1, v - 1, vc, h, hc);
+  }
+  if (h > 0) {
+    path[at] = hc;
+    interleave(d, path, at + 1, v, vc, h - 1, hc);
+  }
+}
+
+// the shortest paths to the node dy rows down and dx columns right: on an
+// even side, half way around goes either direction
+static void initdestination(Destination *d, int dy, int dx) {
+  int down = dy;
+  int up = (rows - dy) % rows;
+  int right = dx;
+  int left = (cols - dx) % cols;
+  int v = (down < up) ? down : up;
+  int h = (right < left) ? right : left;
+  char path[2 * MAXGRID];
+  d->hops = v + h;
+  d->npaths = 0;
+  d->paths = NULL;
+  for (int vdir = 0; vdir < 2; vdir++) {
+    if ((vdir == 0 && down != v) || (vdir == 1 && (up != v || up == down)))
+      continue;
+    for (int hdir = 0; hdir < 2; hdir++) {
+      if ((hdir == 0 && right != h) || (hdir == 1 && (left != h || left == right)))
+        continue;
+      interleave(d, path, 0, v, vdir == 0 ? 's' : 'n', h, hdir == 0 ? 'e' : 'w');
+    }
+  }
+}
+
+static bool fits(const char *path, int hops, int start) {
+  if (start + hops >= MAXLEN || (busy[start] & INJECT) || (busy[start + hops] & PORTL))
+    return false;
+  for (int i = 0; i < hops; i++)
+    if (busy[start + i] & portbit(path[i]))
+      return false;
+  return true;
+}
+
+static void occupy(const char *path, int hops, int start) {
+  busy[start] |= INJECT;
+  for (int i = 0; i < hops; i++)
+    busy[start + i] |= portbit(path[i]);
+  busy[start + hops] |= PORTL;
+}
+
+// place the routes in the given order, the schedule length or MAXLEN when
+// it gets longer than limit, and the sum of the arrival cycles
+static int place(Route *routes, int limit, int *arrivals) {
+  memset(busy, 0, sizeof(busy));
+  int len = 0;
+  *arrivals = 0;
+  for (int r = 0; r < nroutes; r++) {
+    Destination *d = &dests[routes[r].dest];
+    int first = routes[r].pref;
+    routes[r].start = -1;
+    for (int start = 0; routes[r].start < 0; start++) {
+      if (start + d->hops + 1 > limit)
+        return MAXLEN;
+      for (int k = 0; k < d->npaths; k++) {
+        int p = (first + k) % d->npaths;
+        if (fits(d->paths + (size_t)p * d->hops, d->hops, start)) {
+          routes[r].start = start;
+          routes[r].path = p;
+          break;
+        }
+      }
+    }
+    occupy(d->paths + (size_t)routes[r].path * d->hops, d->hops, routes[r].start);
+    if (routes[r].start + d->hops + 1 > len)
+      len = routes[r].start + d->hops + 1;
+    *arrivals += routes[r].start + d->hops;
+  }
+  return len;
+}
+
+static int byhops(const void *a, const void *b) {
+  const Route *x = a;
+  const Route *y = b;
+  return dests[y->dest].hops - dests[x->dest].hops;
+}
+
+static int bystart(const void *a, const void *b) {
+  return ((const Route *)a)->start - ((const Route *)b)->start;
+}
+
+// a random order, sorted by the length of the routes give or take a hop
+static void shuffle(Route *routes) {
+  int key[MAXROUTES];
+  for (int r = nroutes - 1; r > 0; r--) {
+    int k = schedrandom() % (r + 1);
+    Route t = routes[r];
+    routes[r] = routes[k];
+    routes[k] = t;
+  }
+  for (int r = 0; r < nroutes; r++) {
+    key[r] = 2 * dests[routes[r].dest].hops + schedrandom() % 3;
+    routes[r].pref = schedrandom() % dests[routes[r].dest].npaths;
+  }
+  for (int r = 1; r < nroutes; r++) {
+    for (int k = r; k > 0 && key[k] > key[k - 1]; k--) {
+      int t = key[k];
+      key[k] = key[k - 1];
+      key[k - 1] = t;
+      Route rt = routes[k];
+      routes[k] = routes[k - 1];
+      routes[k - 1] = rt;
+    }
+  }
+}
+
+// the route string of a tx slot
+static void routestring(const Route *route, char *s) {
+  const Destination *d = &dests[route->dest];
+  memset(s, ' ', route->start);
+  memcpy(s + route->start, d->paths + (size_t)route->path * d->hops, d->hops);
+  s[route->start + d->hops] = 'l';
+  s[route->start + d->hops + 1] = '\0';
+}
+
+static void printschedule(const Route *routes, int len, bool scala, const char *name) {
+  char s[MAXLEN + 1];
+  if (scala) {
+    printf("  // %dx%d torus, %d slots, schedule length %d\n", rows, cols, nroutes, len);
+    printf("  val %s =\n", name);
+    for (int r = 0; r < nroutes; r++) {
+      routestring(&routes[r], s);
+      printf("    \"%s|\"%s\n", s, r + 1 < nroutes ? " +" : "");
+    }
+  } else {
+    printf("// %dx%d torus, %d slots, schedule length %d (onewaymem-schedule.c)\n",
+           rows, cols, nroutes, len);
+    printf("#define %sROWS %d\n", name, rows);
+    printf("#define %sCOLS %d\n", name, cols);
+    printf("#define %sSLOTS %d\n", name, nroutes);
+    for (int r = 0; r < nroutes; r++) {
+      routestring(&routes[r], s);
+      if (r == 0)
+        printf("#define %sNODES \"%s|\"%s\n", name, s, r + 1 < nroutes ? "\\" : "");
+      else
+        printf("\"%s|\"%s\n", s, r + 1 < nroutes ? "\\" : "");
+    }
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  int tries = 20000;
+  bool scala = false;
+  const char *name = NULL;
+  int weights[MAXCORES][3];
+  int nweights = 0;
+  int nargs = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+      tries = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      seed = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+      scala = strcmp(argv[++i], "scala") == 0;
+    } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      name = argv[++i];
+    } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc && nweights < MAXCORES) {
+      int *w = weights[nweights++];
+      if (sscanf(argv[++i], "%d,%d,%d", &w[0], &w[1], &w[2]) != 3) {
+        nargs = -1;
+        break;
+      }
+    } else if (argv[i][0] != '-' && nargs == 0) {
+      rows = atoi(argv[i]);
+      nargs++;
+    } else if (argv[i][0] != '-' && nargs == 1) {
+      cols = atoi(argv[i]);
+      nargs++;
+    } else {
+      nargs = -1;
+      break;
+    }
+  }
+  if (nargs != 2 || rows < 1 || cols < 1 || rows > MAXGRID || cols > MAXGRID ||
+      rows * cols < 2 || rows * cols > MAXCORES) {
+    printf("usage: %s [-i <tries>] [-r <seed>] [-f c|scala] [-n <name>]\n"
+           "    [-w <down>,<right>,<slots>]... <rows> <cols>\n", argv[0]);
+    printf("  (up to %d nodes and %d rows or columns)\n", MAXCORES, MAXGRID);
+    exit(1);
+  }
+  for (int k = 0; k < nweights && nargs == 2; k++) {
+    if (weights[k][0] < 0 || weights[k][0] >= rows || weights[k][1] < 0 ||
+        weights[k][1] >= cols || weights[k][0] + weights[k][1] == 0) {
+      fprintf(stderr, "schedule: -w %d,%d is not another node of the grid\n", weights[k][0], weights[k][1]);
+      exit(1);
+    }
+  }
+  if (name == NULL)
+    name = scala ? "GeneratedNodes" : "GENERATED";
+
+  Route routes[MAXROUTES];
+  Route best[MAXROUTES];
+  int bound = 0;
+  int vertical = 0;
+  int horizontal = 0;
+  ndests = 0;
+  nroutes = 0;
+  for (int dy = 0; dy < rows; dy++) {
+    for (int dx = 0; dx < cols; dx++) {
+      if (dy == 0 && dx == 0)
+        continue;
+      int slots = 1;
+      for (int k = 0; k < nweights; k++)
+        if (weights[k][0] == dy && weights[k][1] == dx)
+          slots = weights[k][2];
+      if (slots < 1 || nroutes + slots > MAXROUTES) {
+        fprintf(stderr, "schedule: 1 to %d slots in all\n", MAXROUTES);
+        exit(1);
+      }
+      initdestination(&dests[ndests], dy, dx);
+      if (dests[ndests].hops + 1 > bound)
+        bound = dests[ndests].hops + 1;
+      for (int k = 0; k < slots; k++) {
+        vertical += (dy < rows - dy) ? dy : rows - dy;
+        horizontal += (dx < cols - dx) ? dx : cols - dx;
+        routes[nroutes].dest = ndests;
+        routes[nroutes].pref = 0;
+        nroutes++;
+      }
+      ndests++;
+    }
+  }
+  // the last injection is at nroutes - 1 at the earliest
+  if (nroutes + 1 > bound)
+    bound = nroutes + 1;
+  // the hops of a dimension use its two directions before the last cycle
+  if ((vertical + 1) / 2 + 1 > bound)
+    bound = (vertical + 1) / 2 + 1;
+  if ((horizontal + 1) / 2 + 1 > bound)
+    bound = (horizontal + 1) / 2 + 1;
+
+  // a tenth of the tries for the start, the rest to improve it
+  qsort(routes, nroutes, sizeof(Route), byhops);
+  int len = MAXLEN;
+  int arrivals = 0;
+  int found = 0;
+  int t = 0;
+  for (; t < tries / 10 + 1 && len > bound; t++) {
+    if (t > 0)
+      shuffle(routes);
+    int a;
+    int l = place(routes, len - 1, &a);
+    if (l < len) {
+      len = l;
+      arrivals = a;
+      found = t;
+      memcpy(best, routes, sizeof(routes));
+    }
+  }
+  for (; t < tries && len > bound; t++) {
+    memcpy(routes, best, sizeof(routes));
+    int i = schedrandom() % nroutes;
+    if (schedrandom() % 2 == 0) {
+      int k = schedrandom() % nroutes;
+      Route rt = routes[i];
+      routes[i] = routes[k];
+      routes[k] = rt;
+    } else {
+      routes[i].pref = schedrandom() % dests[routes[i].dest].npaths;
+    }
+    int a;
+    int l = place(routes, len, &a);
+    if (l < len || (l == len && a <= arrivals)) {
+      if (l < len)
+        found = t;
+      len = l;
+      arrivals = a;
+      memcpy(best, routes, sizeof(routes));
+    }
+  }
+  if (len == MAXLEN) {
+    fprintf(stderr, "schedule: no schedule found\n");
+    exit(1);
+  }
+  fprintf(stderr, "schedule: %dx%d torus, length %d (lower bound %d) after %d tries\n",
+          rows, cols, len, bound, found + 1);
+
+  qsort(best, nroutes, sizeof(Route), bystart);
+  printschedule(best, len, scala, name);
+  return 0;
+}
@@ -8,9 +8,94 @@
 */
 
 #include "onewaysim.h"
+#include "onewaykernels.h"
+#include "onewaytrace.h"
+#include "onewaymonitor.h"
+#include "onewayrouter.h"
+#include "onewaylatency.h"
 
-int alltxmem[CORES][TDMSLOTS][WORDS];
-int allrxmem[CORES][TDMSLOTS][WORDS];
+#include <fcntl.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+// Sparse delivery: simcontrol() copies only the words of the hot tx pages to
+// their rx slots, so mostly idle links cost (almost) nothing. A cold page is
+// write protected. The first write of a core to it faults, and the fault
+// handler makes the page hot and writable again. Every SIMCOOLROUNDS rounds,
+// all hot pages are copied and then become cold again, so a page that is
+// written in every round costs one fault per SIMCOOLROUNDS rounds. When more
+// than half of the pages were hot since the last cooling, the faults cost
+// more than the copies they save, and all pages stay hot and writable until
+// the memory of the next use-case is cleared (nocmem). The rx
+// memory equals the tx memory after each delivery, as with copying all
+// words, because only the NoC writes the rx memory. The partial page at the
+// end of the tx memory, which may hold other data, is always copied. With
+// SIMFLAGS="-D SIMALLWORDS", or when the page size is not SIMPAGE, all words
+// are copied.
+//
+// The faults are SIGSEGV: in gdb, use 'handle SIGSEGV nostop noprint pass'.
+
+// the SIGSEGV handler is per process, not per sweep thread, and the router
+// model reads all tx words
+#if (defined(RUNINSWEEP) || defined(SIMROUTER)) && !defined(SIMALLWORDS)
+#define SIMALLWORDS
+#endif
+
+#define SIMPAGE 4096
+#define TXWORDS (CORES * TDMSLOTS * WORDS)
+#define TXPAGEWORDS (SIMPAGE / (int)sizeof(int))
+// the full pages of the tx memory
+#define TXPAGES (TXWORDS / TXPAGEWORDS)
+#define SIMCOOLROUNDS 16
+
+_SIMLOCAL int alltxmem[CORES][TDMSLOTS][WORDS] __attribute__((aligned(SIMPAGE)));
+_SIMLOCAL int allrxmem[CORES][TDMSLOTS][WORDS];
+
+// rx core and rx slot of each tx core and tx slot
+static _SIMLOCAL int routerxcore[CORES][TDMSLOTS];
+static _SIMLOCAL int routerxslot[CORES][TDMSLOTS];
+
+static _SIMLOCAL bool txtracking;
+// the pages are write protected when cold (txtracking and not dense)
+static _SIMLOCAL bool txsparse;
+static volatile _SIMLOCAL bool txhot[TXPAGES + 1];
+static _SIMLOCAL int txrounds;
+static struct sigaction segvdefault;
+
+// recording a trace (-t) of the run
+static bool tracing;
+
+// the _UNCACHED data of the use-cases, which a trace records after each call
+// of a core (the onewayuncached section, thread local in a sweep), and a copy
+// of it in words for the trace
+#ifdef SIMSNAPSHOT
+extern char __start_onewayuncached[];
+extern char __stop_onewayuncached[];
+#define SIMSHARED __start_onewayuncached
+#define SIMSHAREDSIZE ((size_t)(__stop_onewayuncached - __start_onewayuncached))
+#else
+static char simsharednone[sizeof(int)];
+#define SIMSHARED simsharednone
+#define SIMSHAREDSIZE ((size_t)0)
+#endif
+static int *simshared;
+
+static int simsharedwords() {
+  return (SIMSHAREDSIZE + sizeof(int) - 1) / sizeof(int);
+}
+
+// checking the wait hints (-w): the cores that wait are called as well, and a
+// core that changes its state or its tx memory (what the other cores see)
+// although none of its events has happened had a wrong hint, which fails its
+// use-case
+static bool hintcheck;
+static _SIMLOCAL int hinttx[TDMSLOTS][WORDS];
+
+// the live monitor segment (-m), see onewaymonitor.h; like the trace, it is a
+// resource of the process and not part of a snapshot
+static MonitorHeader *monitor;
 
 void statework(State **state, int cpuid) {
   *state = &states[cpuid];
@@ -44,24 +129,169 @@ void showmem() {
   }
 }
 
-// called repeatedly from core 0 when *simulating* on the PC
-// the granularity is set to a tdmround, which means one word (index w) is 
-// delivered (instantly) from all cores to to all cores individually
-void simcontrol(int w)
+// a write to a protected tx page
+static void txfault(int sig, siginfo_t *info, void *context) {
+  (void)sig;
+  (void)context;
+  uintptr_t start = (uintptr_t)alltxmem;
+  uintptr_t addr = (uintptr_t)info->si_addr;
+  if (addr >= start && addr < start + TXPAGES * SIMPAGE) {
+    int page = (addr - start) / SIMPAGE;
+    txhot[page] = true;
+    mprotect((void *)(start + page * SIMPAGE), SIMPAGE, PROT_READ | PROT_WRITE);
+    return;
+  }
+  // a real segmentation fault: crash on return
+  sigaction(SIGSEGV, &segvdefault, NULL);
+}
+
+// start the tracking of the hot tx pages
+static void txtrackinginit() {
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_sigaction = txfault;
+  action.sa_flags = SA_SIGINFO | SA_NODEFER;
+  sigemptyset(&action.sa_mask);
+#ifndef SIMALLWORDS
+  txtracking = TXPAGES > 0 && sysconf(_SC_PAGESIZE) == SIMPAGE &&
+    sigaction(SIGSEGV, &action, &segvdefault) == 0 &&
+    mprotect(alltxmem, TXPAGES * SIMPAGE, PROT_READ) == 0;
+#endif
+  for (int p = 0; p < TXPAGES; p++)
+    txhot[p] = !txtracking;
+  txsparse = txtracking;
+  txrounds = 0;
+  // the partial page is always copied
+  txhot[TXPAGES] = true;
+}
+
+// count a delivery to words w .. w+n-1 of an rx slot that changes them, and
+// copy the words to the monitor segment
+static void monitordeliver(int rxcore, int rxslot, int w, const int *words, int n) {
+  MonitorSlot *slot = &MONITORSLOTS(monitor)[rxcore * TDMSLOTS + rxslot];
+  if (kernelcompare(&allrxmem[rxcore][rxslot][w], (const unsigned int *)words, n) >= 0 &&
+      (slot->updates == 0 || slot->lastround != HYPERPERIOD_REGISTER)) {
+    slot->updates++;
+    slot->lastround = HYPERPERIOD_REGISTER;
+  }
+  memcpy(&MONITORRX(monitor)[(rxcore * TDMSLOTS + rxslot) * WORDS + w], words, n * sizeof(int));
+}
+
+// copy the whole rx memory to the monitor segment
+static void monitorsync() {
+  unsigned int seq = monitor->seq;
+  __atomic_store_n(&monitor->seq, seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  memcpy(MONITORRX(monitor), allrxmem, sizeof(allrxmem));
+  monitor->round = HYPERPERIOD_REGISTER;
+  __atomic_store_n(&monitor->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+// create the monitor segment
+static bool monitoropen(const char *name) {
+  size_t size = MONITORSIZE(CORES, TDMSLOTS, WORDS);
+  int fd = shm_open(name, O_CREAT | O_RDWR | O_TRUNC, 0600);
+  if (fd < 0 || ftruncate(fd, size) != 0) {
+    perror(name);
+    return false;
+  }
+  void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) {
+    perror(name);
+    return false;
+  }
+  monitor = p;
+  monitor->cores = CORES;
+  monitor->tdmslots = TDMSLOTS;
+  monitor->words = WORDS;
+  monitor->usecase = -1;
+  monitor->running = 1;
+  for (int rxcore = 0; rxcore < CORES; rxcore++) {
+    for (int rxslot = 0; rxslot < TDMSLOTS; rxslot++) {
+      MonitorSlot *slot = &MONITORSLOTS(monitor)[rxcore * TDMSLOTS + rxslot];
+      slot->txcore = gettxcorefromrxcoreslot(rxcore, rxslot);
+      slot->txslot = gettxslotfromtxcorerxcoreslot(slot->txcore, rxcore, rxslot);
+    }
+  }
+  monitorsync();
+  // a monitor reads the segment once the magic is there
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  memcpy(monitor->magic, MONITORMAGIC, sizeof(MONITORMAGIC));
+  return true;
+}
+
+// tell the monitor that the simulation is done and remove the segment
+static void monitorclose(const char *name) {
+  __atomic_store_n(&monitor->running, 0, __ATOMIC_RELEASE);
+  munmap(monitor, MONITORSIZE(CORES, TDMSLOTS, WORDS));
+  shm_unlink(name);
+  monitor = NULL;
+}
+
+// copy the tx words first .. last-1 (in alltxmem order) to their rx slots
+static void simdeliver(int first, int last) {
+  int *tx = &alltxmem[0][0][0];
+  while (first < last) {
+    int txcore = first / (TDMSLOTS * WORDS);
+    int txslot = (first / WORDS) % TDMSLOTS;
+    int w = first % WORDS;
+    int n = (WORDS - w < last - first) ? WORDS - w : last - first;
+    if (monitor != NULL)
+      monitordeliver(routerxcore[txcore][txslot], routerxslot[txcore][txslot], w, tx + first, n);
+    memcpy(&allrxmem[routerxcore[txcore][txslot]][routerxslot[txcore][txslot]][w],
+           tx + first, n * sizeof(int));
+    first += n;
+  }
+}
+
+// called from noccontrol when *simulating* on the PC after each round
+// the words of the hot tx pages are delivered (instantly) from all cores to
+// all cores, which is one memory block of the TDM schedule
+void simcontrol()
 {
-  //sync_printf(0, "entering simcontrol()...(simulating on the PC)\n");
-  for (int txcoreid = 0; txcoreid < CORES; txcoreid++) {
-    for (int txslot = 0; txslot < TDMSLOTS; txslot++) {
-      int rxcoreid = getrxcorefromtxcoreslot(txcoreid, txslot);
-      for (int rxslot = 0; rxslot < TDMSLOTS; rxslot++) {
-        int txcoreid_for_rxcoreidrxslot = gettxcorefromrxcoreslot(rxcoreid, rxslot);
-        if (txcoreid == txcoreid_for_rxcoreidrxslot) {
-          core[rxcoreid].rx[rxslot][w] = core[txcoreid].tx[txslot][w];
-          break;
-        }
+  // the monitor segment is inconsistent until the round is delivered
+  unsigned int seq = 0;
+  if (monitor != NULL) {
+    seq = monitor->seq;
+    __atomic_store_n(&monitor->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+  }
+
+#ifdef SIMROUTER
+  // the flits of the round, cycle by cycle through the routers
+  routerround(HYPERPERIOD_REGISTER * gethyperperiodcycles(), &alltxmem[0][0][0], &allrxmem[0][0][0]);
+  if (monitor != NULL)
+    memcpy(MONITORRX(monitor), allrxmem, sizeof(allrxmem));
+#else
+  bool cool = txsparse && ++txrounds % SIMCOOLROUNDS == 0;
+  int hot = 0;
+  for (int p = 0; p <= TXPAGES; p++) {
+    if (!txhot[p])
+      continue;
+    int last = (p + 1) * TXPAGEWORDS;
+    simdeliver(p * TXPAGEWORDS, last < TXWORDS ? last : TXWORDS);
+    hot++;
+  }
+  if (cool && 2 * (hot - 1) > TXPAGES) {
+    // dense: all pages stay hot
+    for (int p = 0; p < TXPAGES; p++)
+      txhot[p] = true;
+    txsparse = false;
+  } else if (cool) {
+    for (int p = 0; p < TXPAGES; p++) {
+      if (txhot[p]) {
+        txhot[p] = false;
+        mprotect((char *)alltxmem + p * SIMPAGE, SIMPAGE, PROT_READ);
       }
     }
   }
+#endif
+
+  if (monitor != NULL) {
+    monitor->round = HYPERPERIOD_REGISTER;
+    __atomic_store_n(&monitor->seq, seq + 2, __ATOMIC_RELEASE);
+  }
 }
 
 // Clear alltxmem and allrxmem
@@ -75,6 +305,8 @@ void nocmem() {
   }
 
   // clear mem
+  if (txsparse)
+    mprotect(alltxmem, TXPAGES * SIMPAGE, PROT_READ | PROT_WRITE);
   for (int i = 0; i < CORES; i++) {
     for (int j = 0; j < TDMSLOTS; j++) {
       for (int m = 0; m < WORDS; m++) {
@@ -83,25 +315,35 @@ void nocmem() {
       }
     }
   }
+  // tx and rx are equal: all pages are cold
+  if (txtracking) {
+    for (int p = 0; p < TXPAGES; p++)
+      txhot[p] = false;
+    mprotect(alltxmem, TXPAGES * SIMPAGE, PROT_READ);
+    txsparse = true;
+  }
+  if (monitor != NULL)
+    monitorsync();
+#ifdef SIMROUTER
+  routerreset();
+#endif
 }
 
 // simulator memory initialization
-// function pointer to one of the test cases
-void nocinit(void (*corefuncptr)(void *))
+void nocinit()
 {
   sync_printf(0, "in nocinit()...\n");
   txrxmapsinit();
   showmappings();
 
-  // set the state struct to zero
-  memset(states, 0, sizeof(states));
-  for (int c = 0; c < CORES; c++) {
-    states[c].runcore = true;
+  for (int txcore = 0; txcore < CORES; txcore++) {
+    for (int txslot = 0; txslot < TDMSLOTS; txslot++) {
+      int rxcore = getrxcorefromtxcoreslot(txcore, txslot);
+      routerxcore[txcore][txslot] = rxcore;
+      routerxslot[txcore][txslot] = getrxslotfromrxcoretxcoreslot(rxcore, txcore, txslot);
+    }
   }
 
-  // not using 0
-  //  threadHandles = calloc(CORES, sizeof(pthread_t));
-
   // do the memory mapping for running the simulator on the PC
   nocmem();
 
@@ -114,35 +356,422 @@ void nocinit(void (*corefuncptr)(void *))
     coreid[c] = c;
   }
 
-  // start the cores
+  // route like the NoC would have done
+  txtrackinginit();
+  for (int w = 0; w < TXWORDS; w += WORDS)
+    simdeliver(w, w + WORDS);
+}
+
+#ifdef SIMSNAPSHOT
+// Snapshots: all simulator state (_SIMLOCAL and _SHARED) is in the onewaysim
+// section, and the _UNCACHED data of the use-cases in the onewayuncached
+// section after it, which have no pointers out of them other than into the
+// code and the constant data of the binary (built with -no-pie, so these stay
+// put). A snapshot is a header page and the two sections. A restore maps the file over the
+// section (copy on write), which takes the same time for any size of the
+// state, and the run continues from the round of the snapshot. The tx page
+// protection of the sparse delivery is set again from txhot.
+
+// start and end of the onewaysim section and start of .bss, which should
+// follow the onewayuncached section directly (provided by the linker)
+extern char __start_onewaysim[];
+extern char __stop_onewaysim[];
+extern char __bss_start[];
+
+// page align .bss, so the last page of the section holds no other data
+static char bssalign[1] __attribute__((used, aligned(SIMPAGE)));
+
+// a snapshot (-s) of the run is saved at the end of this round
+static const char *snapshotpath;
+static unsigned int snapshotround;
+
+typedef struct SimSnapshot {
+  char magic[8];
+  char build[32];
+  uintptr_t start;
+  size_t size;
+  int cores;
+  int tdmslots;
+  int words;
+  unsigned int round;
+} SimSnapshot;
+
+#define SNAPSHOTMAGIC "OWSNAP1"
+
+static void snapshotheader(SimSnapshot *header) {
+  memset(header, 0, sizeof(*header));
+  strcpy(header->magic, SNAPSHOTMAGIC);
+  snprintf(header->build, sizeof(header->build), "%s %s", __DATE__, __TIME__);
+  header->start = (uintptr_t)__start_onewaysim;
+  header->size = (uintptr_t)__stop_onewayuncached - (uintptr_t)__start_onewaysim;
+  header->cores = CORES;
+  header->tdmslots = TDMSLOTS;
+  header->words = WORDS;
+  header->round = HYPERPERIOD_REGISTER;
+}
+
+static bool snapshotsection() {
+  if (((uintptr_t)__start_onewaysim & (SIMPAGE - 1)) != 0 ||
+      (uintptr_t)__stop_onewaysim > (uintptr_t)__start_onewayuncached ||
+      (uintptr_t)__stop_onewayuncached != (uintptr_t)__bss_start || sysconf(_SC_PAGESIZE) != SIMPAGE) {
+    printf("onewaysim section shares pages with other data\n");
+    return false;
+  }
+  return true;
+}
+
+// save the simulator state
+static bool snapshotsave(const char *path) {
+  static char page[SIMPAGE];
+  snapshotheader((SimSnapshot *)page);
+  size_t size = ((SimSnapshot *)page)->size;
+  int fd = open(path, O_CREAT | O_WRONLY | O_TRUNC, 0644);
+  bool ok = snapshotsection() && fd >= 0 && write(fd, page, SIMPAGE) == SIMPAGE &&
+    write(fd, __start_onewaysim, size) == (ssize_t)size;
+  if (fd >= 0)
+    close(fd);
+  if (!ok)
+    printf("snapshot: cannot save %s\n", path);
+  else
+    printf("snapshot: round %d saved to %s\n", HYPERPERIOD_REGISTER, path);
+  return ok;
+}
+
+// map a snapshot over the simulator state
+static bool snapshotrestore(const char *path) {
+  SimSnapshot header, own;
+  snapshotheader(&own);
+  int fd = open(path, O_RDONLY);
+  if (fd < 0 || read(fd, &header, sizeof(header)) != sizeof(header) ||
+      memcmp(&header, &own, offsetof(SimSnapshot, round)) != 0 || !snapshotsection()) {
+    printf("snapshot: %s is not a snapshot of this simulator\n", path);
+    if (fd >= 0)
+      close(fd);
+    return false;
+  }
+  size_t size = (own.size + SIMPAGE - 1) & ~(size_t)(SIMPAGE - 1);
+  void *p = mmap(__start_onewaysim, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, SIMPAGE);
+  close(fd);
+  if (p == MAP_FAILED) {
+    perror(path);
+    return false;
+  }
+  if (txtracking) {
+    for (int p = 0; p < TXPAGES; p++)
+      if (!txhot[p])
+        mprotect((char *)alltxmem + p * SIMPAGE, SIMPAGE, PROT_READ);
+  }
+  if (monitor != NULL)
+    monitorsync();
+  printf("snapshot: round %d restored from %s\n", HYPERPERIOD_REGISTER, path);
+  return true;
+}
+#endif
+
+// one use-case run on the simulated NoC
+// use-cases that run at once each get their own common state, done flags,
+// and window of words in each tx/rx slot
+typedef struct SimRun {
+  const UseCase *usecase;
+  int wordoffset;
+  State states[CORES];
+  bool coredone[CORES];
+  bool runcores;
+  CoreWait waits[CORES];
+  // calls of a core with a wait hint that made progress (-w)
+  int wronghints;
+  // no core could make progress, now or later
+  bool deadlocked;
+} SimRun;
+
+static _SIMLOCAL SimRun simruns[NUSECASES];
+static _SIMLOCAL int nsimruns;
+
+// switch the globals that the use-case code uses to a run
+static void simrunin(SimRun *run) {
+  memcpy(states, run->states, sizeof(states));
+  corewaits = run->waits;
   for (int c = 0; c < CORES; c++) {
-    //the typecast 'void * (*)(void *)' is because pthread expects a function that returns a void*
-    //pthread_create(&threadHandles[c], NULL, (void *(*)(void *)) corefuncptr,
-    //               &coreid[c]);
-    //corefuncptr(&coreid[c]);
+    coreflags[c].done = run->coredone[c];
+    for (int j = 0; j < TDMSLOTS; j++) {
+      core[c].tx[j] = alltxmem[c][j] + run->wordoffset;
+      core[c].rx[j] = allrxmem[c][j] + run->wordoffset;
+    }
   }
+  runcores = run->runcores;
+}
 
-  // route like the NoC would have done
-  for (int w = 0; w < WORDS; w++)
-    simcontrol(w);
+static void simrunout(SimRun *run) {
+  memcpy(run->states, states, sizeof(states));
+  for (int c = 0; c < CORES; c++)
+    run->coredone[c] = coreflags[c].done;
+  run->runcores = runcores;
+}
+
+// set up the runs for use-cases that run at once on the NoC
+bool simrunsinit(const UseCase **selected, int n) {
+  statearenareset();
+  int wordoffset = 0;
+  nsimruns = 0;
+  for (int i = 0; i < n; i++) {
+    SimRun *run = &simruns[nsimruns++];
+    run->usecase = selected[i];
+    run->wordoffset = wordoffset;
+    run->wronghints = 0;
+    run->deadlocked = false;
+    wordoffset += selected[i]->slotwords;
+    if (wordoffset > WORDS) {
+      sweepprintf("use-cases do not fit into %d words per slot\n", WORDS);
+      return false;
+    }
+    if (!usecasestatesinit(selected[i]))
+      return false;
+    for (int c = 0; c < CORES; c++) {
+      coreflags[c].done = false;
+      corewaits = run->waits;
+      waitclear(c);
+    }
+    runcores = true;
+    simrunout(run);
+  }
+  return true;
+}
+
+// print what a core of a deadlocked run waits for
+static void simwaitprint(int c) {
+  CoreWait *wait = &corewaits[c];
+  sync_printf(0, "  core %d in state %d waits for:\n", c, states[c].state);
+  for (int i = 0; i < wait->nrx; i++) {
+    for (int j = 0; j < TDMSLOTS; j++) {
+      int w = wait->rxaddr[i] - core[c].rx[j];
+      if (w >= 0 && w < WORDS)
+        sync_printf(0, "    rx slot %d word %d to change from 0x%08x\n", j, w, wait->rxvalue[i]);
+    }
+  }
+  for (int i = 0; i < wait->nstate; i++)
+    sync_printf(0, "    core %d to leave state %d\n", wait->statecore[i], wait->statevalue[i]);
+  if (wait->nrx == 0 && wait->nstate == 0)
+    sync_printf(0, "    nothing (done or stuck)\n");
+}
+
+// a run where no core can make progress, now or later, fails
+static void simrundeadlock(SimRun *run) {
+  sync_printf(0, "core 0:: deadlock in round %d: use case not ok\n", HYPERPERIOD_REGISTER);
+  run->deadlocked = true;
+  for (int c = 0; c < CORES; c++)
+    simwaitprint(c);
+  states[0].runcore = false;
+  runcores = false;
 }
 
-void noccontrol(void (*corefuncptr)(void *))
+// earliest time a waiting core of the run waits for, false when none
+static bool simrununtil(unsigned int *until) {
+  bool timed = false;
+  for (int c = 0; c < CORES; c++) {
+    CoreWait *wait = &corewaits[c];
+    if (wait->timed && (!timed || (int)(wait->until - *until) < 0)) {
+      *until = wait->until;
+      timed = true;
+    }
+  }
+  return timed;
+}
+
+// trace the tx writes, the deliveries, and the states of the round
+// the shared data that core c (or the simulator, as core CORES) wrote
+static void simtraceshared(int c) {
+  memcpy(simshared, SIMSHARED, SIMSHAREDSIZE);
+  tracewriteshared(HYPERPERIOD_REGISTER, c, simshared);
+}
+
+static void simtraceround() {
+  int corestates[CORES];
+  for (int c = 0; c < CORES; c++)
+    corestates[c] = simruns[0].states[c].state;
+  simtraceshared(CORES);
+  tracewriteround(HYPERPERIOD_REGISTER, &alltxmem[0][0][0], &allrxmem[0][0][0], corestates);
+}
+
+// call a core whose wait hint says that it cannot make progress (-w), returns
+// true when it made progress anyway (a new state, tx words, or done)
+static bool simhintcheck(SimRun *run, int c) {
+  int state = states[c].state;
+  bool done = states[c].coredone;
+  memcpy(hinttx, alltxmem[c], sizeof(hinttx));
+  waitclear(c);
+  run->usecase->corefunc(&coreid[c]);
+  if (tracing)
+    simtraceshared(c);
+  if (states[c].state == state && states[c].coredone == done &&
+      memcmp(hinttx, alltxmem[c], sizeof(hinttx)) == 0)
+    return false;
+  sync_printf(0, "core %d: wrong wait hint in round %d (state %d to %d)\n",
+              c, HYPERPERIOD_REGISTER, state, states[c].state);
+  run->wronghints++;
+  return true;
+}
+
+// Event driven: each round, only the cores that can make progress are called
+// (see waitready()). When no core of any run can, the rounds up to the
+// earliest time that a core waits for are skipped. A run where no core can
+// make progress and none waits for a time is deadlocked and stopped.
+void noccontrol()
 {
   //sync_printf(0, "in noccontrol: simulation control when just running on host PC\n");
 
-  while (states[0].runcore){
-    for (int c = 0; c < CORES; c++){
-      corefuncptr(&c);
+  bool running = true;
+  while (running){
+    running = false;
+    bool progress = false;
+    bool timed = false;
+    unsigned int until = 0;
+    for (int r = 0; r < nsimruns; r++) {
+      if (!simruns[r].states[0].runcore)
+        continue;
+      simrunin(&simruns[r]);
+      bool ready = false;
+      for (int c = 0; c < CORES; c++){
+        if (!waitready(c)) {
+          if (hintcheck && simhintcheck(&simruns[r], c))
+            ready = true;
+          continue;
+        }
+        waitclear(c);
+        simruns[r].usecase->corefunc(&coreid[c]);
+        if (tracing)
+          simtraceshared(c);
+        ready = true;
+      }
+      unsigned int rununtil = 0;
+      if (!ready && simrununtil(&rununtil)) {
+        if (!timed || (int)(rununtil - until) < 0)
+          until = rununtil;
+        timed = true;
+      } else if (!ready) {
+        simrundeadlock(&simruns[r]);
+      }
+      simrunout(&simruns[r]);
+      progress = progress || ready;
+      running = true;
     }
 
     // route like the NoC
-    for (int w = 0; w < WORDS; w++)
-      simcontrol(w);
+    simcontrol();
+
+    if (tracing)
+      simtraceround();
 
+    // one memory block has been delivered
+    TDMROUND_REGISTER += WORDS;
+    HYPERPERIOD_REGISTER++;
+
+#ifdef SIMSNAPSHOT
+    if (snapshotpath != NULL && HYPERPERIOD_REGISTER >= snapshotround) {
+      if (!snapshotsave(snapshotpath))
+        exit(0);
+      snapshotpath = NULL;
+    }
+#endif
+
+    // skip the rounds where nothing can happen
+    if (!progress && timed) {
+      int skip = ((int)(until - getnoccycles()) + gethyperperiodcycles() - 1) / gethyperperiodcycles();
+      if (skip > 0) {
+        TDMROUND_REGISTER += skip * WORDS;
+        HYPERPERIOD_REGISTER += skip;
+      }
+    }
+  }
+}
+
+// the tx and rx memories as recorded in the trace that is replayed
+static _SIMLOCAL int replaytx[CORES][TDMSLOTS][WORDS];
+static _SIMLOCAL int replayrx[CORES][TDMSLOTS][WORDS];
+
+// the tx memories of the replayed cores against the trace
+static void replaycompare(const bool *replayed, unsigned int round, int *txround, int *txword) {
+  for (int c = 0; c < CORES; c++) {
+    if (!replayed[c] || txround[c] >= 0)
+      continue;
+    int w = kernelcompare(alltxmem[c][0], (unsigned int *)replaytx[c][0], TDMSLOTS * WORDS);
+    if (w >= 0) {
+      txround[c] = round;
+      txword[c] = w;
+    }
   }
 }
 
+// Replay of a trace: only the replayed cores run, and the rx memories are
+// written from the trace at the end of the rounds where the NoC delivered,
+// instead of by simcontrol(). The other cores take their states and the
+// shared data they wrote from the trace in their turn in the order of the
+// cores, so that the replayed cores see them as in the recorded round. After
+// each traced round and at the end, the tx memory of each replayed core is
+// compared with the trace; txround is the first round where it differs (or
+// -1).
+static void nocreplay(const bool *replayed, int *txround, int *txword)
+{
+  int corestates[CORES];
+  unsigned int next;
+  bool more = tracereadround(&next);
+  for (int c = 0; c < CORES; c++)
+    txround[c] = -1;
+
+  simrunin(&simruns[0]);
+  while (runcores) {
+    bool traced = more && HYPERPERIOD_REGISTER == next;
+    if (traced) {
+      for (int c = 0; c < CORES; c++)
+        corestates[c] = states[c].state;
+      tracereadapply(&replaytx[0][0][0], &replayrx[0][0][0], corestates);
+    }
+
+    bool ready = false;
+    for (int c = 0; c < CORES; c++){
+      if (!replayed[c] && traced) {
+        memcpy(simshared, SIMSHARED, SIMSHAREDSIZE);
+        tracereadshared(c, simshared);
+        memcpy(SIMSHARED, simshared, SIMSHAREDSIZE);
+        states[c].state = corestates[c];
+      }
+      if (!replayed[c] || !waitready(c))
+        continue;
+      waitclear(c);
+      simruns[0].usecase->corefunc(&coreid[c]);
+      ready = true;
+    }
+
+    if (traced) {
+      memcpy(allrxmem, replayrx, sizeof(allrxmem));
+      replaycompare(replayed, next, txround, txword);
+      more = tracereadround(&next);
+    } else if (!more && HYPERPERIOD_REGISTER >= next) {
+      break;
+    }
+
+    TDMROUND_REGISTER += WORDS;
+    HYPERPERIOD_REGISTER++;
+
+    // skip to the next traced round or the earliest time a core waits for
+    if (!ready) {
+      unsigned int until = 0;
+      int skip = more ? (int)(next - HYPERPERIOD_REGISTER) : -1;
+      if (simrununtil(&until)) {
+        int rounds = ((int)(until - getnoccycles()) + gethyperperiodcycles() - 1) / gethyperperiodcycles();
+        skip = (skip < 0 || rounds < skip) ? rounds : skip;
+      } else if (!more) {
+        break;
+      }
+      if (skip > 0) {
+        TDMROUND_REGISTER += skip * WORDS;
+        HYPERPERIOD_REGISTER += skip;
+      }
+    }
+  }
+  replaycompare(replayed, HYPERPERIOD_REGISTER, txround, txword);
+  simrunout(&simruns[0]);
+}
+
 void nocdone()
 {
   sync_printf(0, "in nocdone: cores to join ...\n");
@@ -161,58 +790,290 @@ void precoreloopwork(int loopcnt) {
 //Simulator main
 ///////////////////////////////////////////////////////////////////////////////
 
-// we are core 0
-int main(int argc, char *argv[])
+// print the sync prints and the result of the runs
+// the result of a run (switched in), which fails on a wrong hint or deadlock
+static const char *simrunresult(const SimRun *run) {
+  return (run->wronghints > 0 || run->deadlocked) ? "fail" : allfinishedok();
+}
+
+void simrunsdone()
 {
-  printf("*******************************************\n");
-  printf("****onewaymem: simulate use-case %d on PC****\n", USECASE);
-  printf("*******************************************\n");
+  nocdone();
+  sweepprintf("Done...\n");
 
-  // thread function pointer which is the use case
-  void (*corefuncptr)(void *);
-
-#if USECASE==0
-  printf("USECASE = 0\n");
-  corefuncptr = &corethreadtestwork;
-#elif USECASE==1
-  printf("USECASE == 1\n");
-  corefuncptr = &corethreadtbswork;
-#elif USECASE==2
-  printf("USECASE == 2\n");
-  corefuncptr = &corethreadhswork;
-#elif USECASE==3
-  printf("USECASE == 3\n");
-  corefuncptr = &corethreadeswork;
-#elif USECASE==4
-  printf("USECASE == 4\n");
-  corefuncptr = &corethreadsdbwork;
-#else
-  printf("Unimplemented USECASE value. Exit\n");
-  exit(0);
+  for (int i = 0; i < CORES; ++i) {
+    sweepprintf("Sync print from core %d:\n", i);
+    sync_print_core(i);
+  }
+  sync_printreset();
+#ifdef SIMROUTER
+  routerreport();
 #endif
 
-  runcores = true;
+  sweepprintf("***************************************************************\n");
+  for (int r = 0; r < nsimruns; r++) {
+    simrunin(&simruns[r]);
+    sweepprintf("Use-case %d result [pass/fail]: %s\n", simruns[r].usecase->id,
+                simrunresult(&simruns[r]));
+  }
+  sweepprintf("(Remember: Cycles on the PC simulator are *not* real HW cycles)\n");
+  sweepprintf("***************************************************************\n");
+}
 
-  // start the slave threads
-  nocinit(corefuncptr);
+#ifdef RUNINSWEEP
+// the log of the sweep thread
+static _SIMLOCAL char *sweeplog;
+static _SIMLOCAL size_t sweeplogsize;
+static _SIMLOCAL size_t sweeploglength;
 
-  noccontrol(corefuncptr);
+int sweepprintf(const char *format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(NULL, 0, format, args);
+  va_end(args);
+  if (n < 0)
+    return n;
+  if (sweeploglength + n + 1 > sweeplogsize) {
+    size_t size = 2 * (sweeploglength + n + 1);
+    char *log = realloc(sweeplog, size);
+    if (log == NULL)
+      return -1;
+    sweeplog = log;
+    sweeplogsize = size;
+  }
+  va_start(args, format);
+  vsnprintf(sweeplog + sweeploglength, n + 1, format, args);
+  va_end(args);
+  sweeploglength += n;
+  return n;
+}
 
-  // "start" core 0
-  //corefuncptr(&coreid[0]);
+// run one use-case on the simulated NoC of the calling thread for the sweep
+// driver, returns the log (to be freed by the caller), the result, and the
+// number of simulated rounds
+char *sweeprun(int usecaseid, bool *pass, int *rounds)
+{
+  const UseCase *usecase = getusecase(usecaseid);
+  sweeplog = NULL;
+  sweeplogsize = 0;
+  sweeploglength = 0;
+  *pass = false;
+  *rounds = 0;
+  sweepprintf("USECASE == %d: %s\n", usecaseid, usecase == NULL ? "unimplemented" : usecase->name);
+  if (usecase != NULL) {
+    runcores = true;
+    nocinit();
+    if (simrunsinit(&usecase, 1)) {
+      noccontrol();
+      simrunsdone();
+      simrunin(&simruns[0]);
+      *pass = strcmp(simrunresult(&simruns[0]), "pass") == 0;
+      *rounds = HYPERPERIOD_REGISTER;
+    }
+  }
+  return sweeplog;
+}
+#else
+static bool simsharedalloc() {
+  simshared = calloc(simsharedwords() + 1, sizeof(int));
+  return simshared != NULL;
+}
 
-  nocdone();
+// replay a trace on the given cores
+static void simreplay(const char *path, bool *replayed)
+{
+  TraceHeader header;
+  if (!tracereadopen(path, &header))
+    exit(0);
+  const UseCase *usecase = getusecase(header.usecase);
+  if (header.cores != CORES || header.tdmslots != TDMSLOTS || header.words != WORDS ||
+      header.shared != simsharedwords() || usecase == NULL || !simsharedalloc()) {
+    printf("trace %s is use-case %d with %d cores, %d slots, %d words, %d shared words: "
+           "not this simulator\n", path, header.usecase, header.cores, header.tdmslots,
+           header.words, header.shared);
+    exit(0);
+  }
+  printf("*******************************************\n");
+  printf("****onewaymem: replay use-case %d on PC****\n", usecase->id);
+  printf("*******************************************\n");
+  printf("USECASE == %d: %s\n", usecase->id, usecase->name);
+  nocmem();
+  if (!simrunsinit(&usecase, 1))
+    exit(0);
+  noctimestamps = true;
+  int txround[CORES];
+  int txword[CORES];
+  nocreplay(replayed, txround, txword);
+  tracereadclose();
 
   printf("Done...\n");
-
-  for (int i = 0; i < CORES; ++i) {
-    printf("Sync print from core %d:\n", i);
-    sync_print_core(i);
+  bool pass = true;
+  simrunin(&simruns[0]);
+  for (int c = 0; c < CORES; c++) {
+    if (!replayed[c])
+      continue;
+    printf("Sync print from core %d:\n", c);
+    sync_print_core(c);
+    if (txround[c] < 0)
+      printf("replay: core %d tx as in the trace\n", c);
+    else
+      printf("replay: core %d tx differs from the trace in round %d slot %d word %d\n",
+             c, txround[c], txword[c] / WORDS, txword[c] % WORDS);
+    pass = pass && coreflags[c].done && txround[c] < 0;
   }
-
+  sync_printreset();
   printf("***************************************************************\n");
-  printf("Use-case %d result [pass/fail]: %s\n", USECASE, allfinishedok());
+  printf("Use-case %d replay result [pass/fail]: %s\n", usecase->id, pass ? "pass" : "fail");
   printf("(Remember: Cycles on the PC simulator are *not* real HW cycles)\n");
   printf("***************************************************************\n");
+}
+
+// we are core 0
+// usage: a.out [-m <name>] [-w] [-c] all | <use-case id> ...
+//        a.out -t <trace> <use-case id>
+//        a.out -r <trace> <core> ...
+//        a.out -s <snapshot> <round> [-c] all | <use-case id> ...
+//        a.out -l <snapshot>
+//        a.out -b
+//   the selected use-cases run one after the other, or with -c at once on one NoC
+//   -t records the NoC traffic of the use-case into a trace (see onewaytrace.h)
+//   -r replays a trace: only the given cores run, with the rx memories from the trace
+//   -s saves the simulator state at the end of the round (an error when the run
+//     ends before it), -l continues from it
+//   -w also calls the cores that wait and fails a use-case with a wrong wait
+//     hint (a core that makes progress although none of its events happened)
+//   -b prints the static latency bounds of all core pairs (see onewaylatency.h)
+//   -m <name> places the rx memory and slot counters in a shared memory segment
+//     for onewaymem-monitor.c (see onewaymonitor.h)
+int main(int argc, char *argv[])
+{
+  const UseCase *selected[NUSECASES];
+  int nselected = 0;
+  bool atonce = false;
+  const char *tracepath = NULL;
+  bool replay = false;
+  bool replayed[CORES] = {false};
+  const char *restorepath = NULL;
+  const char *monitorname = NULL;
+  bool bounds = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-c") == 0) {
+      atonce = true;
+    } else if (strcmp(argv[i], "-w") == 0) {
+      hintcheck = true;
+    } else if (strcmp(argv[i], "-b") == 0) {
+      bounds = true;
+    } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+      monitorname = argv[++i];
+    } else if (strcmp(argv[i], "-s") == 0 && i + 2 < argc) {
+      snapshotpath = argv[++i];
+      snapshotround = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+      restorepath = argv[++i];
+    } else if ((strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "-r") == 0) && i + 1 < argc) {
+      replay = strcmp(argv[i], "-r") == 0;
+      tracepath = argv[++i];
+    } else if (replay) {
+      int c = atoi(argv[i]);
+      if (c < 0 || c >= CORES) {
+        printf("No core %s. Exit\n", argv[i]);
+        exit(0);
+      }
+      replayed[c] = true;
+      nselected++;
+    } else if (strcmp(argv[i], "all") == 0) {
+      for (int u = 0; u < NUSECASES && nselected < NUSECASES; u++)
+        selected[nselected++] = usecases[u];
+    } else {
+      const UseCase *usecase = getusecase(atoi(argv[i]));
+      if (usecase == NULL || nselected == NUSECASES) {
+        printf("Unimplemented use-case %s. Exit\n", argv[i]);
+        exit(0);
+      }
+      selected[nselected++] = usecase;
+    }
+  }
+  if ((nselected == 0 && restorepath == NULL && !bounds) ||
+      (tracepath != NULL && !replay && (atonce || nselected != 1))) {
+    printf("usage: %s [-m <name>] [-w] [-c] all | <use-case id> ...\n", argv[0]);
+    printf("       %s -t <trace> <use-case id>\n", argv[0]);
+    printf("       %s -r <trace> <core> ...\n", argv[0]);
+    printf("       %s -s <snapshot> <round> [-c] all | <use-case id> ...\n", argv[0]);
+    printf("       %s -l <snapshot>\n", argv[0]);
+    printf("       %s -b\n", argv[0]);
+    for (int u = 0; u < NUSECASES; u++)
+      printf("  %d: %s\n", usecases[u]->id, usecases[u]->name);
+    exit(0);
+  }
+
+  runcores = true;
+
+  nocinit();
+
+  if (bounds) {
+    showlatencies(DOUBLEBUFFERS);
+    exit(0);
+  }
+
+  if (monitorname != NULL && !monitoropen(monitorname))
+    exit(0);
+
+  if (restorepath != NULL) {
+    if (!snapshotrestore(restorepath))
+      exit(0);
+    if (monitor != NULL)
+      monitor->usecase = nsimruns == 1 ? simruns[0].usecase->id : -1;
+    noccontrol();
+    simrunsdone();
+  } else if (replay) {
+    simreplay(tracepath, replayed);
+  } else if (atonce) {
+    printf("*******************************************\n");
+    printf("****onewaymem: simulate %d use-cases at once on PC****\n", nselected);
+    printf("*******************************************\n");
+    if (!simrunsinit(selected, nselected))
+      exit(0);
+    if (monitor != NULL)
+      monitor->usecase = nselected == 1 ? selected[0]->id : -1;
+    noccontrol();
+    simrunsdone();
+  } else {
+    for (int i = 0; i < nselected; i++) {
+      printf("*******************************************\n");
+      printf("****onewaymem: simulate use-case %d on PC****\n", selected[i]->id);
+      printf("*******************************************\n");
+      printf("USECASE == %d: %s\n", selected[i]->id, selected[i]->name);
+      nocmem();
+      if (!simrunsinit(&selected[i], 1))
+        exit(0);
+      if (monitor != NULL)
+        monitor->usecase = selected[i]->id;
+      if (tracepath != NULL) {
+        TraceHeader header = {CORES, TDMSLOTS, WORDS, selected[i]->id, simsharedwords()};
+        tracing = simsharedalloc() && tracewriteopen(tracepath, &header);
+        if (!tracing)
+          exit(0);
+        noctimestamps = true;
+        // the shared data before the first round
+        simtraceshared(CORES);
+      }
+      noccontrol();
+      if (tracing) {
+        tracewriteclose(HYPERPERIOD_REGISTER);
+        tracing = false;
+        noctimestamps = false;
+      }
+      simrunsdone();
+    }
+  }
+  if (monitor != NULL)
+    monitorclose(monitorname);
+  if (snapshotpath != NULL) {
+    printf("snapshot: the run ended before round %u, %s not saved\n", snapshotround, snapshotpath);
+    return 1;
+  }
   return 0;
 }
+#endif
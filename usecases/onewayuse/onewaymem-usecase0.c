@@ -8,6 +8,7 @@
 */
 
 #include "onewaysim.h"
+#include "onewaykernels.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 //CORE TEST USECASE 0: Sanity check of the NoC itself
@@ -70,11 +71,131 @@
 //   rx tdmslot mask:    0x0000_0F00
 //   rx word index mask: 0x0000_00FF  
 
+//
+// The fields limit the encoding to 16 cores and 256 words. With VERIFYHASH
+// (the default for larger grids or slots) each word is instead a keyed hash
+// of (tx core, tx slot, word, rx core, rx slot) with the key VERIFYSEED. In
+// both modes the rx side computes the expected words of a slot in chunks of
+// VERIFYCHUNK words and compares them with kernelcompare(). Only a chunk that
+// differs is scanned again to report the exact mismatches.
+
+#if !defined(VERIFYHASH) && (CORES > 16 || TDMSLOTS > 16 || WORDS > 256)
+#define VERIFYHASH
+#endif
+#ifndef VERIFYSEED
+#define VERIFYSEED 0x5eed1234
+#endif
+#define VERIFYCHUNK 64
+// mismatches reported by each core
+#define VERIFYREPORTS 8
+
+// local state of each core
+typedef struct verifystate_t {
+  // noc cycle of the tx words
+  unsigned int txtime;
+  bool reported;
+} verifystate_t;
+
+#ifdef VERIFYHASH
+// murmur3 finalizer
+static unsigned int verifymix(unsigned int h) {
+  h ^= h >> 16;
+  h *= 0x85ebca6b;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35;
+  h ^= h >> 16;
+  return h;
+}
+
+// the key of one tx slot to rx slot pair
+static unsigned int verifykey(int txcore, int txslot, int rxcore, int rxslot) {
+  unsigned int h = VERIFYSEED;
+  h = verifymix(h ^ txcore);
+  h = verifymix(h ^ (txslot + 0x100));
+  h = verifymix(h ^ (rxcore + 0x10000));
+  h = verifymix(h ^ (rxslot + 0x1000000));
+  return h;
+}
+#endif
+
+// the expected words w0 .. w0+n-1 of a tx slot to rx slot pair
+static void verifywords(int txcore, int txslot, int rxcore, int rxslot,
+                        int w0, int n, unsigned int *words) {
+#ifdef VERIFYHASH
+  unsigned int key = verifykey(txcore, txslot, rxcore, rxslot);
+  for (int i = 0; i < n; i++)
+    words[i] = verifymix(key + (w0 + i) * 0x9e3779b9);
+#else
+  for (int i = 0; i < n; i++)
+    words[i] = 0x10000000 * txcore +
+               0x01000000 * txslot +
+               0x00010000 * (w0 + i) +
+               0x00001000 * rxcore +
+               0x00000100 * rxslot +
+               0x00000001 * (w0 + i);
+#endif
+}
+
+// the words go through the channel of each rx core, so with a weighted
+// schedule the rx side also checks that the slots of a pair stay in order
+static void verifytx(int cpuid) {
+  unsigned int words[VERIFYCHUNK];
+  Channel ch;
+  for (int rxcore = 0; rxcore < CORES; rxcore++) {
+    if (rxcore == cpuid)
+      continue;
+    channelinit(&ch, cpuid, rxcore);
+    for (int k = 0; k < ch.slots; k++) {
+      for (int w0 = 0; w0 < WORDS; w0 += VERIFYCHUNK) {
+        int n = (WORDS - w0 < VERIFYCHUNK) ? WORDS - w0 : VERIFYCHUNK;
+        verifywords(cpuid, ch.txslot[k], rxcore, ch.rxslot[k], w0, n, words);
+        // on Patmos the NoC HW will route the words to the rx core rx tdm slot
+        for (int i = 0; i < n; i++)
+          CHANNELTX(&ch, k * WORDS + w0 + i) = words[i];
+      }
+    }
+  }
+}
+
+// returns true when all rx words are ok, reports the mismatches when report
+static bool verifyrx(int cpuid, bool report) {
+  unsigned int words[VERIFYCHUNK];
+  int mismatches = 0;
+  for (int rxslot = 0; rxslot < TDMSLOTS; rxslot++) {
+    int txcore = gettxcorefromrxcoreslot(cpuid, rxslot);
+    int txslot = gettxslotfromtxcorerxcoreslot(txcore, cpuid, rxslot);
+    for (int w0 = 0; w0 < WORDS; w0 += VERIFYCHUNK) {
+      int n = (WORDS - w0 < VERIFYCHUNK) ? WORDS - w0 : VERIFYCHUNK;
+      verifywords(txcore, txslot, cpuid, rxslot, w0, n, words);
+      volatile _SPM int *rx = &core[cpuid].rx[rxslot][w0];
+      int first = kernelcompare(rx, words, n);
+      if (first < 0)
+        continue;
+      // nothing to do before the first wrong word changes
+      if (mismatches == 0)
+        waitrx(cpuid, rxslot, w0 + first);
+      for (int i = first; i < n; i++) {
+        unsigned int got = rx[i];
+        if (got == words[i])
+          continue;
+        if (report && mismatches < VERIFYREPORTS)
+          sync_printf(cpuid, "mismatch: rx core %d rx slot %d word %d: 0x%08x, expected 0x%08x from tx core %d tx slot %d\n",
+                      cpuid, rxslot, w0 + i, got, words[i], txcore, txslot);
+        mismatches++;
+      }
+    }
+  }
+  if (report && mismatches > 0)
+    sync_printf(cpuid, "core %d: %d of %d rx words wrong\n", cpuid, mismatches, TDMSLOTS * WORDS);
+  return mismatches == 0;
+}
+
 void corethreadtestwork(void *cpuidptr) {
   int cpuid = getcpuidfromptr(cpuidptr);
-  printf("in corethreadtestwork(%d)...\n", cpuid);
+  sweepprintf("in corethreadtestwork(%d)...\n", cpuid);
   State *state;
   statework(&state, cpuid);
+  verifystate_t *vs = state->local;
 
 #ifdef RUNONPATMOS
   while(runcores)
@@ -84,37 +205,8 @@ void corethreadtestwork(void *cpuidptr) {
     switch (state->state) {
       case 0: { // state 0: encode and tx words
         sync_printf(cpuid, "state 0, core %d\n", cpuid);
-        for (int w = 0; w < WORDS; w++) {
-          for (int txslot = 0; txslot < TDMSLOTS; txslot++) {
-            int tx_cpuid = cpuid;
-            int tx_tdmslot = txslot;
-            int tx_word_index = w;
-            int rx_cpuid = getrxcorefromtxcoreslot(tx_cpuid, tx_tdmslot);
-            int rx_tdmslot = -1;
-            for (int rxslot = 0; rxslot < TDMSLOTS; rxslot++) {
-              int txcore = gettxcorefromrxcoreslot(rx_cpuid, rxslot);
-              if (txcore == tx_cpuid) {
-                rx_tdmslot = rxslot;
-                break;
-              }
-            }
-            int rx_word_index = w;
-            
-            // encode
-            unsigned int txword = 0x10000000 * tx_cpuid + 
-            0x01000000 * tx_tdmslot + 
-            0x00010000 * tx_word_index + 
-            0x00001000 * rx_cpuid + 
-            0x00000100 * rx_tdmslot +
-            0x00000001 * rx_word_index;
-
-            // set tx word in the tdm slot
-            // on Patmos the NoC HW will route it to its rx core rx tdm slot
-            // on the PC the simcontrol function will copy it from the tx slot to the 
-            //  rx core rx tdm slot
-            core[tx_cpuid].tx[tx_tdmslot][tx_word_index] = txword;
-          }
-        }
+        vs->txtime = getnoccycles();
+        verifytx(cpuid);
         if (true) {
           state->state++;
         }
@@ -124,50 +216,21 @@ void corethreadtestwork(void *cpuidptr) {
       case 1: { // state 1: rx, decode, and verify all words 
         sync_printf(cpuid, "state 1, core %d\n", cpuid);
         // check all rx words
-        bool rxwords_ok = true;
-        for (int w = 0; w < WORDS; w++) {
-          for (int rxslot = 0; rxslot < TDMSLOTS; rxslot++) {
-            unsigned int rx_cpuid = cpuid;
-            unsigned int rx_tdmslot = rxslot;
-            unsigned int rx_word_index = w;
-            unsigned int tx_cpuid = gettxcorefromrxcoreslot(rx_cpuid, rx_tdmslot);
-            unsigned int tx_tdmslot = -1;
-            for (unsigned int txslot = 0; txslot < TDMSLOTS; txslot++) {
-              int rxcore = getrxcorefromtxcoreslot(tx_cpuid, txslot);
-              if (rxcore == rx_cpuid) {
-                tx_tdmslot = txslot;
-                break;
-              }
-            }
-            unsigned int tx_word_index = w;
-            
-            unsigned int rxword = core[rx_cpuid].rx[rx_tdmslot][rx_word_index];
-            
-            // decode 
-            unsigned int decoded_tx_cpuid = (rxword & 0xF0000000)>>28;
-            unsigned int decoded_tx_tdmslot = (rxword & 0x0F000000)>>24;
-            unsigned int decoded_tx_word_index = (rxword & 0x00FF0000)>>16;
-            unsigned int decoded_rx_cpuid = (rxword & 0x0000F000)>>12;
-            unsigned int decoded_rx_tdmslot = (rxword & 0x00000F00)>>8;
-            unsigned int decoded_rx_word_index = rxword & 0x000000FF;
-
-            // , check this rx word
-            bool rxword_ok = true;
-            rxword_ok = rxword_ok && (decoded_tx_cpuid == tx_cpuid);
-            rxword_ok = rxword_ok && (decoded_tx_tdmslot == tx_tdmslot);
-            rxword_ok = rxword_ok && (decoded_tx_word_index == tx_word_index);
-            rxword_ok = rxword_ok && (decoded_rx_cpuid == rx_cpuid);
-            rxword_ok = rxword_ok && (decoded_rx_tdmslot == rx_tdmslot);
-            rxword_ok = rxword_ok && (decoded_rx_word_index == rx_word_index);
-
-            // , and remember result for all rxwords so far
-            rxwords_ok = rxwords_ok && rxword_ok;
-          }
-        }
+        // report the mismatches once when the words should have arrived
+        unsigned int verifystart = getcycles();
+        int reporttime = vs->txtime + 2 * getlatencybound(cpuid, getrxcorefromtxcoreslot(cpuid, 0));
+        bool report = !vs->reported && (int)(getnoccycles() - reporttime) > 0;
+        bool rxwords_ok = verifyrx(cpuid, report);
+        vs->reported = vs->reported || report;
+        if (rxwords_ok)
+          sync_printf(cpuid, "core %d: %d rx words ok in %d cycles\n",
+                      cpuid, TDMSLOTS * WORDS, getcycles() - verifystart);
         // final state if rxwords are ok
         // otherwise stay in state until the NoC has delivered all the words
         if (rxwords_ok) {
           state->state++;
+        } else if (!vs->reported) {
+          waitnoccycles(cpuid, reporttime + 1);
         }
 
         break;
@@ -187,3 +250,5 @@ void corethreadtestwork(void *cpuidptr) {
     state->loopcount++;
   } // while
 }
+
+const UseCase usecase0 = {0, "noc verification", corethreadtestwork, sizeof(verifystate_t), WORDS};
@@ -82,3 +82,5 @@ void corethreadtbswork(void *cpuidptr) {
   	state->loopcount++;
   } // while
 }
+
+const UseCase usecase1 = {1, "time-based synchronization", corethreadtbswork, 0, 1};
@@ -0,0 +1,213 @@
+/*
+  Software layer for One-Way Shared Memory
+  Use-case 10: Delta codec for slowly changing state
+
+  Copyright: CBS, DTU
+  Authors: Rasmus Ulslev Pedersen, Martin Schoeberl
+  License: Simplified BSD
+*/
+
+#include <string.h>
+#include "onewaysim.h"
+#include "onewaycodec.h"
+#include "onewaylatency.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//BENCHMARK: State published over a delta codec
+///////////////////////////////////////////////////////////////////////////////
+
+// local state of each core
+typedef struct cdstate_t {
+  // noc cycle when the slots have the cleared words of all cores
+  unsigned int starttime;
+  // generators of the published state and of its replica on the rx side
+  unsigned int txlcg;
+  unsigned int rxlcg;
+  int updates;
+  int rxerrors;
+} cdstate_t;
+
+// Each core publishes a state of CODECSTATE words to the next core of its
+// cluster over the CODECWORDS words at the start of their slot, with the
+// codec of onewaycodec.h. In every loop where the codec can write the next
+// frame, word 0 of the state counts the update and CODECCHANGES words change,
+// mostly in the first eighth of the state. The rx core replays the updates of the tx core on a replica and
+// compares each state it receives with the replica of the same update. When
+// all cores have CODECUPDATES states, each core reports the frames of its tx
+// channel, the words written, and the ratio of the state words received per
+// 100 words written. The report lines start with "codec," and 'make codec'
+// runs it over the size of the state.
+
+// the codec ends and the states are too large for the local state
+static _SIMLOCAL CodecTx cdtx[CORES];
+static _SIMLOCAL CodecRx cdrx[CORES];
+static _SIMLOCAL int cdtxstate[CORES][CODECSTATE];
+static _SIMLOCAL int cdrxstate[CORES][CODECSTATE];
+static _SIMLOCAL int cdreplica[CORES][CODECSTATE];
+
+// a core has cleared its slots and a core has all states
+static volatile _UNCACHED bool cdcleared[CORES];
+static volatile _UNCACHED bool cddone[CORES];
+
+// the next core of the cluster, and the core before it
+static int cdrxcore(int cpuid) {
+  int base = cpuid - cpuid % CLUSTERCORES;
+  return base + (cpuid - base + 1) % CLUSTERCORES;
+}
+
+static int cdtxcore(int cpuid) {
+  int base = cpuid - cpuid % CLUSTERCORES;
+  return base + (cpuid - base + CLUSTERCORES - 1) % CLUSTERCORES;
+}
+
+// the next update of a state
+static void cdupdate(int *state, unsigned int *lcg) {
+  int hot = (CODECSTATE / 8 > 1) ? CODECSTATE / 8 - 1 : 1;
+  state[0]++;
+  for(int k = 0; k < CODECCHANGES; k++) {
+    *lcg = *lcg * 1103515245 + 12345;
+    unsigned int r = *lcg >> 8;
+    int span = (r % 8 == 0) ? CODECSTATE - 1 : hot;
+    state[1 + (r / 8) % span] = *lcg;
+  }
+}
+
+// compare a state with the replica of its update
+static void cdrxcheck(int cpuid, cdstate_t *cd) {
+  int *state = cdrxstate[cpuid];
+  int *replica = cdreplica[cpuid];
+  if (state[0] < replica[0]) {
+    cd->rxerrors++;
+    return;
+  }
+  while (replica[0] < state[0])
+    cdupdate(replica, &cd->rxlcg);
+  if (memcmp(state, replica, sizeof(cdreplica[cpuid])) != 0)
+    cd->rxerrors++;
+  cd->updates++;
+}
+
+void corethreadcodecwork(void *cpuidptr) {
+  int cpuid = *((int*)cpuidptr);
+  State *state;
+  statework(&state, cpuid);
+  cdstate_t *cd = state->local;
+
+  if (state->loopcount == 0)
+    sync_printf(cpuid, "in corethreadcodecwork(%d)...\n", cpuid);
+
+#ifdef RUNONPATMOS
+  while(runcores)
+#endif
+  {
+    switch (state->state) {
+      // init: clear the regions and the states
+      case 0: {
+        codectxinit(&cdtx[cpuid], cpuid, cdrxcore(cpuid), 0);
+        codecrxinit(&cdrx[cpuid], cpuid, cdtxcore(cpuid), 0);
+        memset(cdtxstate[cpuid], 0, sizeof(cdtxstate[cpuid]));
+        memset(cdreplica[cpuid], 0, sizeof(cdreplica[cpuid]));
+        cd->starttime = 0;
+        cd->txlcg = cpuid + 1;
+        cd->rxlcg = cdtxcore(cpuid) + 1;
+        cd->updates = 0;
+        cd->rxerrors = 0;
+        cddone[cpuid] = false;
+        cdcleared[cpuid] = true;
+        if (cpuid == 0)
+          sync_printf(cpuid, "codec,cores,core,rxcore,state,words,frames,deltas,chunks,keyframes,written,ratio,updates,errors,ok\n");
+
+        // next state
+        if (true) {
+          state->state++;
+        }
+        break;
+      }
+
+      // wait until the cleared words of all cores have arrived, so that no
+      // words of an earlier use-case look like a frame
+      case 1: {
+        int notcleared = -1;
+        for(int c = 0; c < CORES && notcleared < 0; c++)
+          if (!cdcleared[c])
+            notcleared = c;
+        if (notcleared >= 0) {
+          waitstate(cpuid, notcleared);
+          break;
+        }
+        if (cd->starttime == 0)
+          cd->starttime = getnoccycles() + getmaxlatency();
+
+        // next state
+        if ((int)(getnoccycles() - cd->starttime) >= 0) {
+          state->state++;
+        } else {
+          waitnoccycles(cpuid, cd->starttime);
+        }
+        break;
+      }
+
+      // update and publish the state, and receive the state of the core
+      // before until all cores have their states
+      case 2: {
+        if (codecready(&cdtx[cpuid])) {
+          cdupdate(cdtxstate[cpuid], &cd->txlcg);
+          codecsend(&cdtx[cpuid], cdtxstate[cpuid]);
+        }
+        if (cd->updates < CODECUPDATES && codecreceive(&cdrx[cpuid], cdrxstate[cpuid]))
+          cdrxcheck(cpuid, cd);
+        if (cd->updates == CODECUPDATES)
+          cddone[cpuid] = true;
+
+        bool alldone = true;
+        for(int c = 0; c < CORES; c++)
+          alldone = alldone && cddone[c];
+
+        // next state
+        if (alldone) {
+          state->state++;
+        }
+        break;
+      }
+
+      // report the tx channel of this core
+      case 3: {
+        CodecStats stats = cdtx[cpuid].stats;
+        bool ok = (cd->rxerrors == 0);
+        sync_printf(cpuid, "codec,%d,%d,%d,%d,%d,%d,%d,%d,%d,%u,%u,%d,%d,%d\n",
+          CLUSTERCORES, cpuid, cdrxcore(cpuid), CODECSTATE, CODECWORDS, stats.frames,
+          stats.deltas, stats.chunks, stats.keyframes, stats.words, getcodecratio(&cdtx[cpuid]),
+          cd->updates, cd->rxerrors, ok);
+
+        // next state only if the states were ok
+        if (ok) {
+          state->state++;
+        } else {
+          sync_printf(cpuid, "error: %d states differ from their replica\n", cd->rxerrors);
+          state->state = -1;
+        }
+        break;
+      }
+
+      // wrong state: stuck until the use-case is stopped
+      case -1: {
+        waitidle(cpuid);
+        break;
+      }
+
+      default: {
+        // default state: final exit by shared signal 'runcores = false'
+        defaultstatework(&state, cpuid);
+        break;
+      }
+    } // switch
+
+    if (cpuid == 0){
+      timeoutcheckcore0(&state);
+    }
+
+    state->loopcount++;
+  } // while
+}
+
+const UseCase usecase10 = {10, "delta codec", corethreadcodecwork, sizeof(cdstate_t), CODECWORDS};
@@ -0,0 +1,222 @@
+/*
+  Software layer for One-Way Shared Memory
+  Use-case 11: Dataflow pipeline
+
+  Copyright: CBS, DTU
+  Authors: Rasmus Ulslev Pedersen, Martin Schoeberl
+  License: Simplified BSD
+*/
+
+#include "onewaysim.h"
+#include "onewaydataflow.h"
+#include "onewaylatency.h"
+
+#if DATAFLOWITEMWORDS > DATAFLOWITEMMAX
+#error "the items of the source do not fit into the buffers of a slot"
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+//BENCHMARK: Throughput and latency of a pipeline of stages on a chain of cores
+///////////////////////////////////////////////////////////////////////////////
+
+// local state of each core
+typedef struct dfstate_t {
+  Dataflow df;
+  DataflowNode node;
+  // noc cycle when the slots have the cleared words of all cores
+  unsigned int starttime;
+} dfstate_t;
+
+// The pipeline source -> filter -> transform -> aggregate runs on the cores
+// 0, DATAFLOWSTRIDE, 2 * DATAFLOWSTRIDE, and 3 * DATAFLOWSTRIDE. The source
+// makes DATAFLOWITEMS items of DATAFLOWITEMWORDS words, the filter drops the
+// items whose first word is a multiple of 4, the transform folds the words
+// in pairs, and the aggregate sums them up. Each core runs its stage in
+// every loop until the end of the stream has passed it. The last stage
+// compares its sums with the pipeline run on its own. Each core of the
+// pipeline reports its items, the cpu cycles in its stage, and the loops it
+// waited for an item or for a free buffer, and the last stage the latency
+// from the source and the throughput in items per 100000 NoC cycles. The
+// report lines start with "dataflow," and 'make dataflow' runs it over the
+// grid size and DOUBLEBUFFERS.
+
+// a core has cleared its slots and a core is through
+static volatile _UNCACHED bool dfcleared[CORES];
+static volatile _UNCACHED bool dfdone[CORES];
+
+static int dfsource(int seq, int *item) {
+  for(int k = 0; k < DATAFLOWITEMWORDS; k++)
+    item[k] = (int)(((unsigned int)seq * 2654435761u + k * 40503u) >> 8);
+  return DATAFLOWITEMWORDS;
+}
+
+static int dffilter(int *item, int n, int *acc) {
+  acc[0]++;
+  return (item[0] % 4 == 0) ? 0 : n;
+}
+
+static int dftransform(int *item, int n, int *acc) {
+  for(int k = 0; k < n / 2; k++)
+    item[k] = item[2 * k] + 3 * item[2 * k + 1];
+  acc[0]++;
+  return n / 2;
+}
+
+static int dfaggregate(int *item, int n, int *acc) {
+  for(int k = 0; k < n; k++)
+    acc[0] += item[k];
+  acc[1] ^= item[0];
+  acc[2]++;
+  return n;
+}
+
+// the pipeline, false when it does not fit on the cores
+static bool dfbuild(Dataflow *df) {
+  dataflowinit(df, "source", dfsource, DATAFLOWITEMS, 0);
+  return dataflowadd(df, "filter", dffilter, DATAFLOWSTRIDE) >= 0 &&
+         dataflowadd(df, "transform", dftransform, 2 * DATAFLOWSTRIDE) >= 0 &&
+         dataflowadd(df, "aggregate", dfaggregate, 3 * DATAFLOWSTRIDE) >= 0;
+}
+
+// the sums of the last stage when the stages run on one core
+static bool dfcheck(const Dataflow *df, const int *acc) {
+  int expected[DATAFLOWACC] = {0};
+  int filter[DATAFLOWACC] = {0};
+  int item[DATAFLOWITEMMAX];
+  for(int seq = 0; seq < df->items; seq++) {
+    int n = df->source(seq, item);
+    for(int s = 1; s < df->stages && n > 0; s++)
+      n = df->fn[s](item, n, s == df->stages - 1 ? expected : filter);
+  }
+  for(int k = 0; k < DATAFLOWACC; k++)
+    if (acc[k] != expected[k])
+      return false;
+  return true;
+}
+
+void corethreaddataflowwork(void *cpuidptr) {
+  int cpuid = *((int*)cpuidptr);
+  State *state;
+  statework(&state, cpuid);
+  dfstate_t *dfs = state->local;
+
+  if (state->loopcount == 0)
+    sync_printf(cpuid, "in corethreaddataflowwork(%d)...\n", cpuid);
+
+#ifdef RUNONPATMOS
+  while(runcores)
+#endif
+  {
+    switch (state->state) {
+      // init: every core builds the same pipeline
+      case 0: {
+        if (!dfbuild(&dfs->df)) {
+          sync_printf(cpuid, "error: the pipeline does not fit on %d cores\n", CLUSTERCORES);
+          state->state = -1;
+          break;
+        }
+        dataflownodeinit(&dfs->node, &dfs->df, cpuid);
+        dfs->starttime = 0;
+        dfdone[cpuid] = dfs->node.done;
+        dfcleared[cpuid] = true;
+        if (cpuid == 0)
+          sync_printf(cpuid, "dataflow,cores,buffers,stage,name,core,itemsin,itemsout,busy,inwaits,outwaits,latmin,latmean,latmax,throughput,ok\n");
+
+        // next state
+        if (true) {
+          state->state++;
+        }
+        break;
+      }
+
+      // wait until the cleared words of all cores have arrived, so that no
+      // words of an earlier use-case look like an item or a credit
+      case 1: {
+        int notcleared = -1;
+        for(int c = 0; c < CORES && notcleared < 0; c++)
+          if (!dfcleared[c])
+            notcleared = c;
+        if (notcleared >= 0) {
+          waitstate(cpuid, notcleared);
+          break;
+        }
+        if (dfs->starttime == 0)
+          dfs->starttime = getnoccycles() + getmaxlatency();
+
+        // next state
+        if ((int)(getnoccycles() - dfs->starttime) >= 0) {
+          state->state++;
+        } else {
+          waitnoccycles(cpuid, dfs->starttime);
+        }
+        break;
+      }
+
+      // run the stage until the end of the stream has passed all stages
+      case 2: {
+        if (!dfdone[cpuid] && dataflowstep(&dfs->node, &dfs->df))
+          dfdone[cpuid] = true;
+
+        bool alldone = true;
+        for(int c = 0; c < CORES; c++)
+          alldone = alldone && dfdone[c];
+
+        // next state
+        if (alldone) {
+          state->state++;
+        } else if (!dfdone[cpuid]) {
+          dataflowwait(&dfs->node);
+        }
+        break;
+      }
+
+      // report the stage of this core
+      case 3: {
+        DataflowNode *node = &dfs->node;
+        bool ok = true;
+        if (node->stage >= 0) {
+          bool last = (node->stage == dfs->df.stages - 1);
+          unsigned int cycles = node->last - node->first;
+          unsigned int tput = (!last || cycles == 0) ? 0 :
+            (unsigned int)((unsigned long long)(node->itemsout - 1) * 100000 / cycles);
+          unsigned int latmean = (!last || node->itemsout == 0) ? 0 :
+            (unsigned int)(node->latsum / node->itemsout);
+          ok = !last || dfcheck(&dfs->df, node->acc);
+          sync_printf(cpuid, "dataflow,%d,%d,%d,%s,%d,%d,%d,%u,%d,%d,%u,%u,%u,%u,%d\n",
+            CLUSTERCORES, DOUBLEBUFFERS, node->stage, dfs->df.name[node->stage], cpuid,
+            node->itemsin, node->itemsout, node->busy, node->inwaits, node->outwaits,
+            node->latmin, latmean, node->latmax, tput, ok);
+        }
+
+        // next state only if the sums were ok
+        if (ok) {
+          state->state++;
+        } else {
+          sync_printf(cpuid, "error: the sums of the pipeline are wrong\n");
+          state->state = -1;
+        }
+        break;
+      }
+
+      // no pipeline or wrong sums: stuck until the use-case is stopped
+      case -1: {
+        waitidle(cpuid);
+        break;
+      }
+
+      default: {
+        // default state: final exit by shared signal 'runcores = false'
+        defaultstatework(&state, cpuid);
+        break;
+      }
+    } // switch
+
+    if (cpuid == 0){
+      timeoutcheckcore0(&state);
+    }
+
+    state->loopcount++;
+  } // while
+}
+
+const UseCase usecase11 = {11, "dataflow pipeline", corethreaddataflowwork, sizeof(dfstate_t), WORDS};
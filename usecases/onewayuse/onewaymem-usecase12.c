@@ -0,0 +1,213 @@
+/*
+  Software layer for One-Way Shared Memory
+  Use-case 12: Scatter/gather of a matrix-vector product
+
+  Copyright: CBS, DTU
+  Authors: Rasmus Ulslev Pedersen, Martin Schoeberl
+  License: Simplified BSD
+*/
+
+#include "onewaysim.h"
+#include "onewayscatter.h"
+#include "onewaylatency.h"
+
+#if SCATTERCOLS > SCATTERITEMMAX
+#error "a row of the matrix does not fit into the buffers of a slot"
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+//BENCHMARK: Speedup of a matrix-vector product over the cores of a cluster
+///////////////////////////////////////////////////////////////////////////////
+
+// local state of each core
+typedef struct scstate_t {
+  Scatter sc;
+  ScatterJob job;
+  // noc cycle when the slots have the cleared words of all cores, and when
+  // the master started and has all results
+  unsigned int starttime;
+  unsigned int scatterstart;
+  unsigned int scatterend;
+} scstate_t;
+
+// Core SCATTERMASTER computes y = M x for a matrix M of SCATTERROWS x
+// SCATTERCOLS words with the workers of onewayscatter.h: a tile is as many
+// rows as fit into a buffer, and the kernel of a worker takes
+// SCATTERMACCYCLES per multiply-add. The vector x is known to all cores.
+// When the master has all rows of y, it compares them with its own product.
+// Each core reports the tiles it computed or gathered, and the master the
+// NoC cycles from the first tile to the last result and the speedup against
+// the master computing all rows itself (the modeled cycles of all
+// multiply-adds), times 100. The report lines start with "scatter," and 'make
+// scatter' runs it over the grid size and DOUBLEBUFFERS.
+
+// the matrix and the product of the master
+static _SIMLOCAL int scmatrix[SCATTERROWS * SCATTERCOLS];
+static _SIMLOCAL int scproduct[SCATTERROWS];
+
+// a core has cleared its slots and a core is done
+static volatile _UNCACHED bool sccleared[CORES];
+static volatile _UNCACHED bool scdone[CORES];
+
+static int scvector(int c) {
+  return c + 1;
+}
+
+// the rows of y for the n / SCATTERCOLS rows of M in a tile
+static int scmatvec(const int *in, int n, int *out) {
+  int rows = n / SCATTERCOLS;
+  for(int r = 0; r < rows; r++) {
+    int sum = 0;
+    for(int c = 0; c < SCATTERCOLS; c++)
+      sum += in[r * SCATTERCOLS + c] * scvector(c);
+    out[r] = sum;
+  }
+  return rows;
+}
+
+// the product of the master itself
+static bool sccheck() {
+  int row[1];
+  for(int r = 0; r < SCATTERROWS; r++) {
+    scmatvec(&scmatrix[r * SCATTERCOLS], SCATTERCOLS, row);
+    if (row[0] != scproduct[r])
+      return false;
+  }
+  return true;
+}
+
+void corethreadscatterwork(void *cpuidptr) {
+  int cpuid = *((int*)cpuidptr);
+  State *state;
+  statework(&state, cpuid);
+  scstate_t *scs = state->local;
+
+  if (state->loopcount == 0)
+    sync_printf(cpuid, "in corethreadscatterwork(%d)...\n", cpuid);
+
+#ifdef RUNONPATMOS
+  while(runcores)
+#endif
+  {
+    switch (state->state) {
+      // init: the master makes the matrix
+      case 0: {
+        scatterinit(&scs->sc, cpuid, SCATTERMASTER);
+        scs->job.in = scmatrix;
+        scs->job.out = scproduct;
+        scs->job.inwords = SCATTERROWS * SCATTERCOLS;
+        scs->job.tilewords = getscattertilewords(SCATTERCOLS);
+        scs->job.outwords = scs->job.tilewords / SCATTERCOLS;
+        scs->job.kernel = scmatvec;
+        scs->job.cycles = SCATTERMACCYCLES;
+        if (cpuid == SCATTERMASTER) {
+          for(int i = 0; i < SCATTERROWS * SCATTERCOLS; i++)
+            scmatrix[i] = (i * 31 + i / SCATTERCOLS * 17) % 64 - 32;
+          for(int r = 0; r < SCATTERROWS; r++)
+            scproduct[r] = 0;
+          sync_printf(cpuid, "scatter,cores,buffers,core,tiles,tilewords,cycles,serial,speedup,ok\n");
+        }
+        scs->starttime = 0;
+        scdone[cpuid] = scs->sc.done;
+        sccleared[cpuid] = true;
+
+        // next state
+        if (true) {
+          state->state++;
+        }
+        break;
+      }
+
+      // wait until the cleared words of all cores have arrived, so that no
+      // words of an earlier use-case look like a tile or a credit
+      case 1: {
+        int notcleared = -1;
+        for(int c = 0; c < CORES && notcleared < 0; c++)
+          if (!sccleared[c])
+            notcleared = c;
+        if (notcleared >= 0) {
+          waitstate(cpuid, notcleared);
+          break;
+        }
+        if (scs->starttime == 0)
+          scs->starttime = getnoccycles() + getmaxlatency();
+
+        // next state
+        if ((int)(getnoccycles() - scs->starttime) >= 0) {
+          scs->scatterstart = getnoccycles();
+          state->state++;
+        } else {
+          waitnoccycles(cpuid, scs->starttime);
+        }
+        break;
+      }
+
+      // scatter, compute, and gather until all cores are done
+      case 2: {
+        if (!scdone[cpuid] && scatterstep(&scs->sc, &scs->job)) {
+          scs->scatterend = getnoccycles();
+          scdone[cpuid] = true;
+        }
+
+        bool alldone = true;
+        for(int c = 0; c < CORES; c++)
+          alldone = alldone && scdone[c];
+
+        // next state
+        if (alldone) {
+          state->state++;
+        } else if (!scdone[cpuid]) {
+          scatterwait(&scs->sc);
+        }
+        break;
+      }
+
+      // report this core
+      case 3: {
+        bool ok = true;
+        unsigned int cycles = 0;
+        unsigned int serial = 0;
+        unsigned int speedup = 0;
+        if (cpuid == SCATTERMASTER) {
+          ok = sccheck();
+          cycles = scs->scatterend - scs->scatterstart;
+          serial = SCATTERROWS * SCATTERCOLS * SCATTERMACCYCLES;
+          speedup = (cycles == 0) ? 0 : (unsigned int)(100ULL * serial / cycles);
+        }
+        if (cpuid / CLUSTERCORES == SCATTERMASTER / CLUSTERCORES)
+          sync_printf(cpuid, "scatter,%d,%d,%d,%d,%d,%u,%u,%u,%d\n",
+            CLUSTERCORES, DOUBLEBUFFERS, cpuid, scs->sc.tiles, scs->job.tilewords,
+            cycles, serial, speedup, ok);
+
+        // next state only if the product was ok
+        if (ok) {
+          state->state++;
+        } else {
+          sync_printf(cpuid, "error: the gathered product is wrong\n");
+          state->state = -1;
+        }
+        break;
+      }
+
+      // wrong product: stuck until the use-case is stopped
+      case -1: {
+        waitidle(cpuid);
+        break;
+      }
+
+      default: {
+        // default state: final exit by shared signal 'runcores = false'
+        defaultstatework(&state, cpuid);
+        break;
+      }
+    } // switch
+
+    if (cpuid == 0){
+      timeoutcheckcore0(&state);
+    }
+
+    state->loopcount++;
+  } // while
+}
+
+const UseCase usecase12 = {12, "scatter gather", corethreadscatterwork, sizeof(scstate_t), WORDS};
@@ -0,0 +1,252 @@
+/*
+  Software layer for One-Way Shared Memory
+  Use-case 13: Typed channels in C++
+
+  Copyright: CBS, DTU
+  Authors: Rasmus Ulslev Pedersen, Martin Schoeberl
+  License: Simplified BSD
+*/
+
+#include "onewaysim.h"
+#include "onewaychannel.hpp"
+#include "onewaylatency.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//BENCHMARK: A ring channel and a sampled state between two cores
+///////////////////////////////////////////////////////////////////////////////
+
+// Core CHANNELTX sends CHANNELITEMS items to core CHANNELRX over a ring
+// channel of CHANNELDEPTH buffers and publishes a sample of its state over a
+// typed channel after the ring in the same slot whenever the channel takes
+// the next one (see onewaychannel.hpp). The rx core checks that the items arrive in order and
+// that each sample is whole and newer than the one before. Core 0 also
+// compares the slots of the compile-time schedule with the run-time maps of
+// all core pairs. Both cores report their items, samples, and errors. The
+// report lines start with "channels," and 'make channels' builds and runs it.
+
+constexpr int CHANNELTX = 0;
+constexpr int CHANNELRX = 1;
+
+struct Item {
+  int seq;
+  int words[5];
+};
+
+struct Sample {
+  unsigned int loop;
+  int value[3];
+};
+
+using ItemRing = oneway::RingChannel<Item, CHANNELDEPTH, CHANNELTX, CHANNELRX>;
+using SampleChannel = oneway::TypedChannel<Sample, CHANNELTX, CHANNELRX, ItemRing::end>;
+
+// local state of each core
+struct chstate_t {
+  // noc cycle when the slots have the cleared words of all cores
+  unsigned int starttime;
+  ItemRing::Tx ringtx;
+  ItemRing::Rx ringrx;
+  SampleChannel::Tx sampletx;
+  SampleChannel::Rx samplerx;
+  int items;
+  int samples;
+  unsigned int lastloop;
+  int errors;
+};
+
+// a core has cleared its slots and a core is done
+static volatile _UNCACHED bool chcleared[CORES];
+static volatile _UNCACHED bool chdone[CORES];
+
+static Item chitem(int seq) {
+  Item item;
+  item.seq = seq;
+  for (int k = 0; k < 5; k++)
+    item.words[k] = seq * 7 + k;
+  return item;
+}
+
+static Sample chsample(unsigned int loop) {
+  Sample sample;
+  sample.loop = loop;
+  for (int k = 0; k < 3; k++)
+    sample.value[k] = (int)loop * (k + 1) + k;
+  return sample;
+}
+
+// the core pairs where the compile-time schedule differs from the maps
+static int chschedulecheck() {
+  int errors = 0;
+  for (int tx = 0; tx < CORES; tx++) {
+    for (int rx = 0; rx < CORES; rx++) {
+      if (tx == rx)
+        continue;
+      int txslot = gettxslotfromtxcorerxcoreslot(tx, rx, -1);
+      int rxslot = (txslot < 0) ? -1 : getrxslotfromrxcoretxcoreslot(rx, tx, txslot);
+      if (oneway::schedule::txslot(tx, rx) != txslot || oneway::schedule::rxslot(rx, tx) != rxslot)
+        errors++;
+    }
+  }
+  return errors;
+}
+
+// send the items that fit and the sample, returns true when all items are out
+static bool chtxwork(chstate_t *ch, unsigned int loop) {
+  while (ch->items < CHANNELITEMS && ch->ringtx.send(chitem(ch->items + 1)))
+    ch->items++;
+  if (ch->sampletx.send(chsample(loop)))
+    ch->samples++;
+  return ch->items == CHANNELITEMS;
+}
+
+// take the items and the sample that have arrived, returns true when all
+// items are in
+static bool chrxwork(chstate_t *ch) {
+  Item item;
+  while (ch->items < CHANNELITEMS && ch->ringrx.receive(item)) {
+    Item expected = chitem(++ch->items);
+    if (memcmp(&item, &expected, sizeof(Item)) != 0)
+      ch->errors++;
+  }
+  Sample sample;
+  if (ch->samplerx.receive(sample)) {
+    Sample expected = chsample(sample.loop);
+    if (memcmp(&sample, &expected, sizeof(Sample)) != 0 ||
+        (ch->samples > 0 && sample.loop <= ch->lastloop))
+      ch->errors++;
+    ch->lastloop = sample.loop;
+    ch->samples++;
+  }
+  return ch->items == CHANNELITEMS;
+}
+
+void corethreadchannelswork(void *cpuidptr) {
+  int cpuid = *((int*)cpuidptr);
+  State *state;
+  statework(&state, cpuid);
+  chstate_t *ch = static_cast<chstate_t *>(state->local);
+
+  if (state->loopcount == 0)
+    sync_printf(cpuid, "in corethreadchannelswork(%d)...\n", cpuid);
+
+#ifdef RUNONPATMOS
+  while(runcores)
+#endif
+  {
+    switch (state->state) {
+      // init: clear the channel ends, and core 0 checks the schedule
+      case 0: {
+        ch->starttime = 0;
+        ch->items = 0;
+        ch->samples = 0;
+        ch->lastloop = 0;
+        ch->errors = 0;
+        if (cpuid == CHANNELTX) {
+          ch->ringtx.init();
+          ch->sampletx.init();
+        } else if (cpuid == CHANNELRX) {
+          ch->ringrx.init();
+          ch->samplerx.init();
+        }
+        if (cpuid == 0) {
+          ch->errors += chschedulecheck();
+          sync_printf(cpuid, "channels,cores,core,items,samples,errors,ok\n");
+        }
+        chdone[cpuid] = (cpuid != CHANNELTX && cpuid != CHANNELRX);
+        chcleared[cpuid] = true;
+
+        // next state
+        if (true) {
+          state->state++;
+        }
+        break;
+      }
+
+      // wait until the cleared words of all cores have arrived, so that no
+      // words of an earlier use-case look like an item or a credit
+      case 1: {
+        int notcleared = -1;
+        for (int c = 0; c < CORES && notcleared < 0; c++)
+          if (!chcleared[c])
+            notcleared = c;
+        if (notcleared >= 0) {
+          waitstate(cpuid, notcleared);
+          break;
+        }
+        if (ch->starttime == 0)
+          ch->starttime = getnoccycles() + getmaxlatency();
+
+        // next state
+        if ((int)(getnoccycles() - ch->starttime) >= 0) {
+          state->state++;
+        } else {
+          waitnoccycles(cpuid, ch->starttime);
+        }
+        break;
+      }
+
+      // send and receive until all items are through
+      case 2: {
+        if (!chdone[cpuid]) {
+          if (cpuid == CHANNELTX && chtxwork(ch, state->loopcount))
+            chdone[cpuid] = true;
+          else if (cpuid == CHANNELRX && chrxwork(ch))
+            chdone[cpuid] = true;
+        }
+
+        bool alldone = true;
+        for (int c = 0; c < CORES; c++)
+          alldone = alldone && chdone[c];
+
+        // next state
+        if (alldone) {
+          state->state++;
+        } else if (cpuid == CHANNELTX && !chdone[cpuid]) {
+          ch->ringtx.wait();
+          ch->sampletx.wait();
+        } else if (cpuid == CHANNELRX && !chdone[cpuid]) {
+          ch->ringrx.wait();
+          ch->samplerx.wait();
+        }
+        break;
+      }
+
+      // report the channel ends of this core
+      case 3: {
+        bool ok = (ch->errors == 0);
+        if (cpuid == CHANNELTX || cpuid == CHANNELRX || cpuid == 0)
+          sync_printf(cpuid, "channels,%d,%d,%d,%d,%d,%d\n",
+            CLUSTERCORES, cpuid, ch->items, ch->samples, ch->errors, ok);
+
+        // next state only if the channels were ok
+        if (ok) {
+          state->state++;
+        } else {
+          sync_printf(cpuid, "error: %d wrong items, samples, or slots\n", ch->errors);
+          state->state = -1;
+        }
+        break;
+      }
+
+      // wrong channel: stuck until the use-case is stopped
+      case -1: {
+        waitidle(cpuid);
+        break;
+      }
+
+      default: {
+        // default state: final exit by shared signal 'runcores = false'
+        defaultstatework(&state, cpuid);
+        break;
+      }
+    } // switch
+
+    if (cpuid == 0){
+      timeoutcheckcore0(&state);
+    }
+
+    state->loopcount++;
+  } // while
+}
+
+const UseCase usecase13 = {13, "typed channels", corethreadchannelswork, sizeof(chstate_t), WORDS};
@@ -0,0 +1,246 @@
+/*
+  Software layer for One-Way Shared Memory
+  Use-case 14: Wait hints
+
+  Copyright: CBS, DTU
+  Authors: Rasmus Ulslev Pedersen, Martin Schoeberl
+  License: Simplified BSD
+*/
+
+#include "onewaysim.h"
+#include "onewaylatency.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//BENCHMARK: Each kind of wait hint against the event it waits for
+///////////////////////////////////////////////////////////////////////////////
+
+// local state of each core
+typedef struct hintstate_t {
+  // noc cycle when the slots have the cleared words of all cores
+  unsigned int starttime;
+  // the next event, and the noc cycle of the next event of the driver or
+  // of the next time event of the waiter
+  int event;
+  unsigned int next;
+  // the state of the driver the waiter has seen
+  int driverstate;
+  int late;
+} hintstate_t;
+
+// Core 0 (the driver) makes HINTEVENTS events for the core at the end of its
+// tx slot 0 (the waiter), one every four latency bounds. Event k is a word
+// in the slot (k + 1 in word 0), a time (the waiter waits four bounds after
+// the event before), or a state change of the driver, in turn, and the
+// waiter waits for each with waitrx(), waitnoccycles(), or waitstate(). When
+// it sees an event, it acks it in word 0 of its slot to the driver, and the
+// driver waits for the last ack. On the event-driven simulator, the waiter
+// checks that it is called in the round the event becomes visible: a later
+// call (late) means that its hint did not cover the event, and 'make hints'
+// runs it with -w, which also calls the cores that wait and fails a hint
+// under which a core makes progress. The report lines start with "hints,".
+
+#define HINTDRIVER 0
+#define HINTRX 0
+#define HINTTIME 1
+#define HINTSTATE 2
+
+// a core has cleared its slots, and the noc cycle of each event
+static volatile _UNCACHED bool hintcleared[CORES];
+static volatile _UNCACHED unsigned int hintsent[HINTEVENTS];
+
+static int hintwaiter() {
+  return getrxcorefromtxcoreslot(HINTDRIVER, 0);
+}
+
+static unsigned int hintgap() {
+  return 4 * getlatencybound(HINTDRIVER, hintwaiter());
+}
+
+// make the next event when its time has come, returns true after the last
+// ack
+static bool hintdriverwork(int cpuid, State *state, hintstate_t *hs) {
+  if (hs->event == HINTEVENTS) {
+    int waiter = hintwaiter();
+    int ackslot = getrxslotfromrxcoretxcoreslot(cpuid, waiter,
+                    gettxslotfromtxcorerxcoreslot(waiter, cpuid, -1));
+    if (core[cpuid].rx[ackslot][0] == HINTEVENTS)
+      return true;
+    waitrx(cpuid, ackslot, 0);
+    return false;
+  }
+  unsigned int now = getnoccycles();
+  if ((int)(now - hs->next) < 0) {
+    waitnoccycles(cpuid, hs->next);
+    return false;
+  }
+  hintsent[hs->event] = now;
+  if (hs->event % 3 == HINTRX)
+    core[cpuid].tx[0][0] = hs->event + 1;
+  else if (hs->event % 3 == HINTSTATE)
+    state->state = (state->state == 2) ? 3 : 2;
+  hs->event++;
+  hs->next = now + hintgap();
+  return false;
+}
+
+// take the next event when it has happened, returns true after the last
+static bool hintwaiterwork(int cpuid, hintstate_t *hs) {
+  if (hs->event == HINTEVENTS)
+    return true;
+  int rxslot = getrxslotfromrxcoretxcoreslot(cpuid, HINTDRIVER, 0);
+  unsigned int now = getnoccycles();
+  // the earliest noc cycle the waiter can see the event
+  unsigned int visible = 0;
+  switch (hs->event % 3) {
+    case HINTRX:
+      if (core[cpuid].rx[rxslot][0] != hs->event + 1) {
+        waitrx(cpuid, rxslot, 0);
+        return false;
+      }
+      visible = hintsent[hs->event] + gethyperperiodcycles();
+      break;
+    case HINTTIME:
+      if ((int)(now - hs->next) < 0) {
+        waitnoccycles(cpuid, hs->next);
+        return false;
+      }
+      visible = hs->next;
+      break;
+    case HINTSTATE:
+      if (states[HINTDRIVER].state == hs->driverstate) {
+        waitstate(cpuid, HINTDRIVER);
+        return false;
+      }
+      hs->driverstate = states[HINTDRIVER].state;
+      visible = hintsent[hs->event];
+      break;
+  }
+#if !defined(RUNONPATMOS) && !defined(RUNONPOSIX) && !defined(RUNONVERILATOR)
+  // the simulator delivers the words and moves the time once a round
+  if ((int)(now - visible) >= gethyperperiodcycles())
+    hs->late++;
+#else
+  (void)visible;
+#endif
+  int ackslot = gettxslotfromtxcorerxcoreslot(cpuid, HINTDRIVER, -1);
+  hs->event++;
+  core[cpuid].tx[ackslot][0] = hs->event;
+  hs->next = now + hintgap();
+  return false;
+}
+
+void corethreadhintswork(void *cpuidptr) {
+  int cpuid = *((int*)cpuidptr);
+  State *state;
+  statework(&state, cpuid);
+  hintstate_t *hs = state->local;
+  bool driver = (cpuid == HINTDRIVER);
+  bool waiter = (cpuid == hintwaiter());
+
+  if (state->loopcount == 0)
+    sync_printf(cpuid, "in corethreadhintswork(%d)...\n", cpuid);
+
+#ifdef RUNONPATMOS
+  while(runcores)
+#endif
+  {
+    switch (state->state) {
+      // init: clear word 0 of all tx slots
+      case 0: {
+        hs->starttime = 0;
+        hs->event = 0;
+        hs->next = 0;
+        hs->driverstate = 2;
+        hs->late = 0;
+        for(int i = 0; i < TDMSLOTS; i++)
+          core[cpuid].tx[i][0] = 0;
+        if (driver)
+          sync_printf(cpuid, "hints,cores,core,events,late,ok\n");
+        hintcleared[cpuid] = true;
+
+        // next state
+        if (true) {
+          state->state++;
+        }
+        break;
+      }
+
+      // wait until the cleared words of all cores have arrived
+      case 1: {
+        int notcleared = -1;
+        for(int c = 0; c < CORES && notcleared < 0; c++)
+          if (!hintcleared[c])
+            notcleared = c;
+        if (notcleared >= 0) {
+          waitstate(cpuid, notcleared);
+          break;
+        }
+        if (hs->starttime == 0)
+          hs->starttime = getnoccycles() + getmaxlatency();
+
+        // next state
+        if ((int)(getnoccycles() - hs->starttime) >= 0) {
+          hs->next = getnoccycles() + hintgap();
+          state->state++;
+        } else {
+          waitnoccycles(cpuid, hs->starttime);
+        }
+        break;
+      }
+
+      // make and take the events (the driver changes between 2 and 3 in
+      // its state events)
+      case 2:
+      case 3: {
+        bool done = true;
+        if (driver)
+          done = hintdriverwork(cpuid, state, hs);
+        else if (waiter)
+          done = hintwaiterwork(cpuid, hs);
+
+        // next state
+        if (done) {
+          state->state = 4;
+        }
+        break;
+      }
+
+      // report the driver and the waiter
+      case 4: {
+        bool ok = (hs->late == 0);
+        if (driver || waiter)
+          sync_printf(cpuid, "hints,%d,%d,%d,%d,%d\n",
+            CORES, cpuid, hs->event, hs->late, ok);
+
+        // next state only if the hints were ok
+        if (ok) {
+          state->state++;
+        } else {
+          sync_printf(cpuid, "error: %d events seen late\n", hs->late);
+          state->state = -1;
+        }
+        break;
+      }
+
+      // late event: stuck until the use-case is stopped
+      case -1: {
+        waitidle(cpuid);
+        break;
+      }
+
+      default: {
+        // default state: final exit by shared signal 'runcores = false'
+        defaultstatework(&state, cpuid);
+        break;
+      }
+    } // switch
+
+    if (cpuid == 0){
+      timeoutcheckcore0(&state);
+    }
+
+    state->loopcount++;
+  } // while
+}
+
+const UseCase usecase14 = {14, "wait hints", corethreadhintswork, sizeof(hintstate_t), 1};
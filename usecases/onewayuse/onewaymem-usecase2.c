@@ -13,6 +13,23 @@
 //COMMUNICATION PATTERN: Handshaking Protocol
 ///////////////////////////////////////////////////////////////////////////////
 
+// local state of each core
+typedef struct hsstate_t {
+  unsigned int step;
+  unsigned int txcnt;
+  unsigned int hyperperiod;
+  unsigned int starttime;
+  unsigned int endtime;
+  unsigned int blockno;
+  // set up the use case so all cores will send a handshake message to the other cores
+  // and receive the appropriate acknowledgement
+  handshakemsg_t hmsg_out[TDMSLOTS];
+  handshakemsg_t hmsg_in[TDMSLOTS];
+  handshakeack_t hmsg_ack_out[TDMSLOTS];
+  handshakeack_t hmsg_ack_in[TDMSLOTS];
+  unsigned int prevhyperperiod[TDMSLOTS];
+} hsstate_t;
+
 void triggerhandshakework(int cpuid) {
   sync_printf(cpuid, "handshaketriggger in core %d...\n", cpuid);
 }
@@ -24,6 +41,7 @@ void corethreadhswork(void *cpuidptr) {
   int cpuid = *((int*)cpuidptr);
   State *state;
   statework(&state, cpuid);
+  hsstate_t *hs = state->local;
 
   if (state->loopcount == 0) 
     sync_printf(cpuid, "in corethreadhsp(%d): printon=%d\n", cpuid, printon);
@@ -37,38 +55,38 @@ void corethreadhswork(void *cpuidptr) {
       case 0: {
         // state work
         sync_printf(cpuid, "core %d tx state 0\n", cpuid);
-        state->starttime = getcycles();
-        state->blockno = 0xCAFE1234;
-        state->txcnt = 1;
+        hs->starttime = getcycles();
+        hs->blockno = 0xCAFE1234;
+        hs->txcnt = 1;
         // prepare the handshaked messages
         for(int i=0; i < TDMSLOTS; i++){ 
           // txstamp in first word
-          state->hmsg_out[i].txstamp =  cpuid*0x10000000 + i*0x1000000 + 0*10000 + state->txcnt;
-          state->hmsg_out[i].fromcore = cpuid;          
-          state->hmsg_out[i].tocore   = gettxcorefromrxcoreslot(cpuid, i);
+          hs->hmsg_out[i].txstamp =  cpuid*0x10000000 + i*0x1000000 + 0*10000 + hs->txcnt;
+          hs->hmsg_out[i].fromcore = cpuid;          
+          hs->hmsg_out[i].tocore   = getrxcorefromtxcoreslot(cpuid, i);
           // fixed words and 4 data words
-          state->hmsg_out[i].length   = HANDSHAKEMSGSIZE; 
+          hs->hmsg_out[i].length   = HANDSHAKEMSGSIZE; 
           // some test data
-          state->hmsg_out[i].data0    = getcycles();
-          state->hmsg_out[i].data1    = getcycles() + 1;
-          state->hmsg_out[i].data2    = getcycles() + 2;
+          hs->hmsg_out[i].data0    = getcycles();
+          hs->hmsg_out[i].data1    = getcycles() + 1;
+          hs->hmsg_out[i].data2    = getcycles() + 2;
           // block identifier
-          state->hmsg_out[i].blockno  = state->blockno;
+          hs->hmsg_out[i].blockno  = hs->blockno;
         } 
 
           // tx the messages
         for(int i=0; i<TDMSLOTS; i++) { 
-          core[cpuid].tx[i][0] = state->hmsg_out[i].txstamp;
-          core[cpuid].tx[i][1] = state->hmsg_out[i].fromcore;          
-          core[cpuid].tx[i][2] = state->hmsg_out[i].tocore;
+          core[cpuid].tx[i][0] = hs->hmsg_out[i].txstamp;
+          core[cpuid].tx[i][1] = hs->hmsg_out[i].fromcore;          
+          core[cpuid].tx[i][2] = hs->hmsg_out[i].tocore;
           // fixed words ad 4 data words
-          core[cpuid].tx[i][3] = state->hmsg_out[i].length; 
+          core[cpuid].tx[i][3] = hs->hmsg_out[i].length; 
           // some test data
-          core[cpuid].tx[i][4] = state->hmsg_out[i].data0;
-          core[cpuid].tx[i][5] = state->hmsg_out[i].data1;
-          core[cpuid].tx[i][6] = state->hmsg_out[i].data2;
+          core[cpuid].tx[i][4] = hs->hmsg_out[i].data0;
+          core[cpuid].tx[i][5] = hs->hmsg_out[i].data1;
+          core[cpuid].tx[i][6] = hs->hmsg_out[i].data2;
           // block identifier
-          core[cpuid].tx[i][7] = state->hmsg_out[i].blockno;
+          core[cpuid].tx[i][7] = hs->hmsg_out[i].blockno;
         }
 
         // next state
@@ -85,19 +103,21 @@ void corethreadhswork(void *cpuidptr) {
 
         bool allrxok = true;
         for(int i=0; i<TDMSLOTS; i++) { 
-          state->hmsg_in[i].txstamp  = core[cpuid].rx[i][0];
-          state->hmsg_in[i].fromcore = core[cpuid].rx[i][1];          
-          state->hmsg_in[i].tocore   = core[cpuid].rx[i][2];
+          hs->hmsg_in[i].txstamp  = core[cpuid].rx[i][0];
+          hs->hmsg_in[i].fromcore = core[cpuid].rx[i][1];          
+          hs->hmsg_in[i].tocore   = core[cpuid].rx[i][2];
             // fixed words a3d 4 data words
-          state->hmsg_in[i].length   = core[cpuid].rx[i][3]; 
+          hs->hmsg_in[i].length   = core[cpuid].rx[i][3]; 
             // some test data
-          state->hmsg_in[i].data0    = core[cpuid].rx[i][4];
-          state->hmsg_in[i].data1    = core[cpuid].rx[i][5];
-          state->hmsg_in[i].data2    = core[cpuid].rx[i][6];
+          hs->hmsg_in[i].data0    = core[cpuid].rx[i][4];
+          hs->hmsg_in[i].data1    = core[cpuid].rx[i][5];
+          hs->hmsg_in[i].data2    = core[cpuid].rx[i][6];
             // block identifier
-          state->hmsg_in[i].blockno  = core[cpuid].rx[i][7];
+          hs->hmsg_in[i].blockno  = core[cpuid].rx[i][7];
 
-          bool rxok = (state->blockno == state->hmsg_in[i].blockno);
+          bool rxok = (hs->blockno == hs->hmsg_in[i].blockno);
+          if (!rxok)
+            waitrx(cpuid, i, 7);
           allrxok = allrxok && rxok;
 
           if(printon) sync_printf(cpuid, "hmsg_in[%d](%d) 0x%08x 0x%08x 0x%08x 0x%08x\n",
@@ -123,29 +143,32 @@ void corethreadhswork(void *cpuidptr) {
         // prepare the acks (if the msg was ok)
         bool allmsgok = true;
         for(int i=0; i < TDMSLOTS; i++){ 
-          bool msgok = (state->hmsg_in[i].tocore == cpuid) && (state->hmsg_in[i].length == HANDSHAKEMSGSIZE);
+          bool msgok = (hs->hmsg_in[i].tocore == cpuid) && (hs->hmsg_in[i].length == HANDSHAKEMSGSIZE);
           allmsgok = allmsgok && msgok;
           if (msgok) {
             // txstamp in first word
-            state->hmsg_ack_out[i].txstamp  = cpuid*0x10000000 + i*0x1000000 + 0*10000 + state->txcnt;
-            state->hmsg_ack_out[i].fromcore = cpuid;          
-            state->hmsg_ack_out[i].tocore   = getrxcorefromtxcoreslot(cpuid, i);
+            hs->hmsg_ack_out[i].txstamp  = cpuid*0x10000000 + i*0x1000000 + 0*10000 + hs->txcnt;
+            hs->hmsg_ack_out[i].fromcore = cpuid;          
+            hs->hmsg_ack_out[i].tocore   = getrxcorefromtxcoreslot(cpuid, i);
             // block identifier (to be acknowledged)
-            state->hmsg_ack_out[i].blockno  = state->hmsg_in[i].blockno;
+            hs->hmsg_ack_out[i].blockno  = hs->hmsg_in[i].blockno;
 
-            core[cpuid].tx[i][0] = state->hmsg_ack_out[i].txstamp;
-            core[cpuid].tx[i][1] = state->hmsg_ack_out[i].fromcore;          
-            core[cpuid].tx[i][2] = state->hmsg_ack_out[i].tocore;
-            core[cpuid].tx[i][3] = state->hmsg_ack_out[i].blockno;
+            core[cpuid].tx[i][0] = hs->hmsg_ack_out[i].txstamp;
+            core[cpuid].tx[i][1] = hs->hmsg_ack_out[i].fromcore;          
+            core[cpuid].tx[i][2] = hs->hmsg_ack_out[i].tocore;
+            core[cpuid].tx[i][3] = hs->hmsg_ack_out[i].blockno;
 
             if(printon) sync_printf(cpuid, "hmsg_ack[%d] ack (blockno 0x%08x) sent to core %d\n",
-              i, state->hmsg_ack_out[i].blockno, state->hmsg_ack_out[i].tocore);
+              i, hs->hmsg_ack_out[i].blockno, hs->hmsg_ack_out[i].tocore);
           }
         }       
         
         //next state if incoming was ok and acks are tx'ed
         if (allmsgok) {
           state->state++;
+        } else {
+          // the messages are not read again
+          waitidle(cpuid);
         }
         break;
       }
@@ -154,38 +177,38 @@ void corethreadhswork(void *cpuidptr) {
         // state work
         if (printon) sync_printf(cpuid, "core %d ack rx state 3\n", cpuid);    
         for(int i=0; i<TDMSLOTS; i++) { 
-          state->hmsg_ack_in[i].txstamp =  core[cpuid].rx[i][0];
-          state->hmsg_ack_in[i].fromcore = core[cpuid].rx[i][1];          
-          state->hmsg_ack_in[i].tocore =   core[cpuid].rx[i][2];
+          hs->hmsg_ack_in[i].txstamp =  core[cpuid].rx[i][0];
+          hs->hmsg_ack_in[i].fromcore = core[cpuid].rx[i][1];          
+          hs->hmsg_ack_in[i].tocore =   core[cpuid].rx[i][2];
           // block identifier that is acknowledged
-          state->hmsg_ack_in[i].blockno =  core[cpuid].rx[i][3];
+          hs->hmsg_ack_in[i].blockno =  core[cpuid].rx[i][3];
         }
-        state->endtime = getcycles();
+        hs->endtime = getcycles();
         // end of real-time measurement
 
         sync_printf(cpuid, "core %d (done) ack rx state 3\n", cpuid);  
         for(int i=0; i<TDMSLOTS; i++) { 
           sync_printf(cpuid, "hmsg_ack_in[%d](%d) 0x%08x 0x%08x 0x%08x 0x%08x\n",
             i, getrxcorefromtxcoreslot(cpuid,i),
-            state->hmsg_ack_in[i].txstamp, state->hmsg_ack_in[i].fromcore, 
-            state->hmsg_ack_in[i].tocore, state->hmsg_ack_in[i].blockno);
+            hs->hmsg_ack_in[i].txstamp, hs->hmsg_ack_in[i].fromcore, 
+            hs->hmsg_ack_in[i].tocore, hs->hmsg_ack_in[i].blockno);
         }     
         sync_printf(cpuid, "endtime %d - starttime %d = %d cycles\n",
-          state->endtime, state->starttime, state->endtime - state->starttime); 
+          hs->endtime, hs->starttime, hs->endtime - hs->starttime); 
 
         //check use case 1 on HW
         bool allackok = true;
         for(int i=0; i<TDMSLOTS; i++) { 
-          bool ackok = (state->hmsg_out[i].blockno == state->hmsg_ack_in[i].blockno) && 
-            (state->hmsg_ack_in[i].fromcore == gettxcorefromrxcoreslot(cpuid, i)) &&
-            (state->hmsg_ack_in[i].tocore == cpuid);
+          bool ackok = (hs->hmsg_out[i].blockno == hs->hmsg_ack_in[i].blockno) && 
+            (hs->hmsg_ack_in[i].fromcore == gettxcorefromrxcoreslot(cpuid, i)) &&
+            (hs->hmsg_ack_in[i].tocore == cpuid);
 
           allackok = allackok && ackok;
             
           if(ackok)
-            sync_printf(cpuid, "use case ok (ack from tx core %d ok)!\n", state->hmsg_ack_in[i].fromcore);
+            sync_printf(cpuid, "use case ok (ack from tx core %d ok)!\n", hs->hmsg_ack_in[i].fromcore);
           else
-            sync_printf(cpuid, "error: use case not ok (from %d)!\n", state->hmsg_ack_in[i].fromcore);
+            sync_printf(cpuid, "error: use case not ok (from %d)!\n", hs->hmsg_ack_in[i].fromcore);
         }
 
         // next state    
@@ -210,3 +233,5 @@ void corethreadhswork(void *cpuidptr) {
     state->loopcount++;
   }// while
 }
+
+const UseCase usecase2 = {2, "handshaking", corethreadhswork, sizeof(hsstate_t), HANDSHAKEMSGSIZE};
@@ -13,16 +13,24 @@
 //COMMUNICATION PATTERN: Exchange of state
 ///////////////////////////////////////////////////////////////////////////////
 
+// local state of each core
+typedef struct esstate_t {
+  int txcnt;
+  es_msg_t esmsg_out;
+  es_msg_t esmsg_in[TDMSLOTS];
+} esstate_t;
+
 void corethreadeswork(void *cpuidptr) {
   int printon = 0;
   const int cpuid = *((int*)cpuidptr);
   State *state;
   statework(&state, cpuid);
+  esstate_t *es = state->local;
 
   if (state->loopcount == 0) 
     sync_printf(cpuid, "in corethreadeswork(%d)...printon=%d\n", cpuid, printon);
 
-  state->txcnt = 1;
+  es->txcnt = 1;
   unsigned int SENSORID0 = 0x11223344;
  
   // CORE WORK SECTION //  
@@ -37,7 +45,7 @@ void corethreadeswork(void *cpuidptr) {
         // state work
         if(cpuid == 1){
           sync_printf(cpuid, "core %d to tx sensor state exchange\n", cpuid);
-          sync_printf(cpuid, "sizeof(es_msg_t) = %d\n", sizeof(state->esmsg_out));
+          sync_printf(cpuid, "sizeof(es_msg_t) = %d\n", sizeof(es->esmsg_out));
         }
         else
           sync_printf(cpuid, "core %d no work in state 0\n", cpuid);
@@ -48,15 +56,15 @@ void corethreadeswork(void *cpuidptr) {
         // Prepare the sensor reading that is transmitted from core 1 to all the other cores
         if (cpuid == 1) {
           for(int i=0; i<TDMSLOTS; i++) { 
-            state->txcnt++; 
+            es->txcnt++; 
             // create reading message
-            state->esmsg_out.txstamp   = cpuid*0x10000000 + i*0x1000000 + 0*10000 + state->txcnt;
-            state->esmsg_out.sensorid  = SENSORID0;
-            state->esmsg_out.sensorval = sensestart;//getcycles(); // the artificial "temperature" proxy
+            es->esmsg_out.txstamp   = cpuid*0x10000000 + i*0x1000000 + 0*10000 + es->txcnt;
+            es->esmsg_out.sensorid  = SENSORID0;
+            es->esmsg_out.sensorval = sensestart;//getcycles(); // the artificial "temperature" proxy
             // send reading
-            core[cpuid].tx[i][0] = state->esmsg_out.txstamp;
-            core[cpuid].tx[i][1] = state->esmsg_out.sensorid;          
-            core[cpuid].tx[i][2] = state->esmsg_out.sensorval;
+            core[cpuid].tx[i][0] = es->esmsg_out.txstamp;
+            core[cpuid].tx[i][1] = es->esmsg_out.sensorid;          
+            core[cpuid].tx[i][2] = es->esmsg_out.sensorval;
           }
         }
           
@@ -79,20 +87,22 @@ void corethreadeswork(void *cpuidptr) {
               core1slot = i;
           }
 
-          state->esmsg_in[cpuid].txstamp   = core[cpuid].rx[core1slot][0];
-          state->esmsg_in[cpuid].sensorid  = core[cpuid].rx[core1slot][1];          
-          state->esmsg_in[cpuid].sensorval = core[cpuid].rx[core1slot][2];
+          es->esmsg_in[cpuid].txstamp   = core[cpuid].rx[core1slot][0];
+          es->esmsg_in[cpuid].sensorid  = core[cpuid].rx[core1slot][1];          
+          es->esmsg_in[cpuid].sensorval = core[cpuid].rx[core1slot][2];
           unsigned int endtime = getcycles();
-          unsigned int starttime = state->esmsg_in[cpuid].sensorval;
+          unsigned int starttime = es->esmsg_in[cpuid].sensorval;
 
           // only let core 0 move to final state if it has received the sensor reading
-          if (state->esmsg_in[cpuid].sensorid == SENSORID0) {
+          if (es->esmsg_in[cpuid].sensorid == SENSORID0) {
             sync_printf(cpuid, "esmsg_in[%d](%d) 0x%08x 0x%08x 0x%08x\n",
-              core1slot, 0, state->esmsg_in[cpuid].txstamp, state->esmsg_in[cpuid].sensorid, 
-              state->esmsg_in[cpuid].sensorval);
+              core1slot, 0, es->esmsg_in[cpuid].txstamp, es->esmsg_in[cpuid].sensorid, 
+              es->esmsg_in[cpuid].sensorval);
             sync_printf(cpuid, "core 1 sensor state to core %d ok, timediff = %d cycles\n", cpuid, 
                         endtime - starttime);
             state->state++;
+          } else {
+            waitrx(cpuid, core1slot, 1);
           }
         } else {
           // let the other cores move on
@@ -116,3 +126,5 @@ void corethreadeswork(void *cpuidptr) {
     state->loopcount++;
   } // while
 }
+
+const UseCase usecase3 = {3, "state exchange", corethreadeswork, sizeof(esstate_t), 3};
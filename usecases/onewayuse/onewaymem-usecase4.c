@@ -8,10 +8,23 @@
 */
 
 #include "onewaysim.h"
+#include "onewaykernels.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 //COMMUNICATION PATTERN: Streaming Double Buffer (sdb)
 ///////////////////////////////////////////////////////////////////////////////
+
+// local state of each core
+typedef struct sdbstate_t {
+  int txcnt;
+  int roundstate;
+  unsigned int starttime;
+  unsigned int endtime;
+  // double buffers on tx
+  buffer_t buf_out[TDMSLOTS][DOUBLEBUFFERS];
+  // double buffers on rx
+  buffer_t buf_in[TDMSLOTS][DOUBLEBUFFERS];
+} sdbstate_t;
 // there is a number of buffers overlaid on the tx and rx memory for each core
 // the size of each of these double buffers is DBUFSIZE 
 
@@ -19,6 +32,7 @@ void corethreadsdbwork(void *cpuidptr) {
   int cpuid = *((int*)cpuidptr);
   State *state;
   statework(&state, cpuid);
+  sdbstate_t *sdb = state->local;
 
   if (state->loopcount == 0) 
     sync_printf(cpuid, "in corethreaddbwork(%d)...\n", cpuid);
@@ -43,17 +57,17 @@ void corethreadsdbwork(void *cpuidptr) {
 
   for(int i=0; i<TDMSLOTS; i++){
     for(int j=0; j < DOUBLEBUFFERS; j++){
-      state->buf_out[i][j].data = (volatile _IODEV int *) (core[cpuid].tx[i] + (j*DBUFSIZE));  
+      sdb->buf_out[i][j].data = (volatile _IODEV int *) (core[cpuid].tx[i] + (j*DBUFSIZE));  
       //sync_printf(cpuid, "&buf_out[tdm=%d][dbuf=%d].data[1] address = %p\n", 
-      //  i, j, &state->buf_out[i][j].data[1]);     
+      //  i, j, &sdb->buf_out[i][j].data[1]);     
     }    
   }
 
   for(int i=0; i<TDMSLOTS; i++){
     for(int j=0; j < DOUBLEBUFFERS; j++){
-      state->buf_in[i][j].data = (volatile _IODEV int *) (core[cpuid].rx[i] + (j*DBUFSIZE));   
+      sdb->buf_in[i][j].data = (volatile _IODEV int *) (core[cpuid].rx[i] + (j*DBUFSIZE));   
       //sync_printf(cpuid, "buf_in[%d][%d].data address  = %p\n", 
-      //  i, j, state->buf_in[i][j].data);   
+      //  i, j, sdb->buf_in[i][j].data);   
     }
   }
 
@@ -68,20 +82,20 @@ void corethreadsdbwork(void *cpuidptr) {
       case 0: {
         // UNCOMMENT THIS WHEN NOT DOING MEASUREMENTS
         //sync_printf(cpuid, "core %d to tx it's buffer in state 0\n", cpuid);
-        state->starttime = getcycles();
+        sdb->starttime = getcycles();
         if (cpuid == 1) {
           // first round of tx for the first buffer
           for(int i=0; i<TDMSLOTS; i++) {
             //buf_out[i][0].data[0] = cpuid*0x10000000 + i*0x1000000 + 0*10000 + txcnt; 
             for(int j=0; j < DBUFSIZE; j++){
-              state->buf_out[i][0].data[j] = 2*cpuid*0x10000000 + i*0x1000000 + j*10000 + state->txcnt;
+              sdb->buf_out[i][0].data[j] = 2*cpuid*0x10000000 + i*0x1000000 + j*10000 + sdb->txcnt;
             }
             //sync_printf(cpuid, 
             //  "buf_out[%d](%d->).data[0]=0x%08x : .data[1]=0x%08x ... .data[%d]=0x%08x\n",
             //  i, getrxcorefromtxcoreslot(cpuid, i), buf_out[i][0].data[0], 
             //  buf_out[i][0].data[1], DBUFSIZE-1, buf_out[i][0].data[DBUFSIZE-1]);
           }
-          state->txcnt++;  
+          sdb->txcnt++;  
         }
 
         // next state
@@ -97,14 +111,14 @@ void corethreadsdbwork(void *cpuidptr) {
           for(int i=0; i<TDMSLOTS; i++) {
             //buf_out[i][1].data[0] = cpuid*0x10000000 + i*0x1000000 + 0*10000 + txcnt; 
             for(int j=0; j < DBUFSIZE; j++){
-              state->buf_out[i][1].data[j] = cpuid*0x10000000 + i*0x1000000 + j*10000 + state->txcnt;
+              sdb->buf_out[i][1].data[j] = cpuid*0x10000000 + i*0x1000000 + j*10000 + sdb->txcnt;
             }
             //sync_printf(cpuid, 
             //  "buf_out[%d](%d->).data[0]=0x%08x : .data[1]=0x%08x ... .data[%d]=0x%08x\n",
             //  i, getrxcorefromtxcoreslot(cpuid, i), buf_out[i][1].data[0], 
             //  buf_out[i][1].data[1], DBUFSIZE-1, buf_out[i][1].data[DBUFSIZE-1]);
           }
-          state->txcnt++;  
+          sdb->txcnt++;  
         }
 
         // next state
@@ -133,22 +147,23 @@ void corethreadsdbwork(void *cpuidptr) {
           const int rxslot = 2; // just pick one
           const int txcoreid = gettxcorefromrxcoreslot(cpuid, rxslot);
           // start by monitoring the last word of the first buffer
-          aword = state->buf_in[rxslot][0].data[DBUFSIZE-1];
+          aword = sdb->buf_in[rxslot][0].data[DBUFSIZE-1];
           for(int i=0; i < num; i++) {
             for(int j=0; j < DOUBLEBUFFERS; j++){
               // while(aword == buf_in[rxslot][j].data[DBUFSIZE-1]);
-              aword = state->buf_in[rxslot][j].data[DBUFSIZE-1];
+              aword = sdb->buf_in[rxslot][j].data[DBUFSIZE-1];
               cyclestamp[j][i] = getcycles();
               // core 1 is in TDM slot 2
-              lastword[j][i] = state->buf_in[rxslot][j].data[DBUFSIZE-1];
+              lastword[j][i] = sdb->buf_in[rxslot][j].data[DBUFSIZE-1];
               // some actual work use the active buffer (summing it as an example)
-              for(int k=0; k < DBUFSIZE; k++)
-                tmpsum += state->buf_in[rxslot][j].data[k];
+              KernelSummary summary;
+              kernelsummary(sdb->buf_in[rxslot][j].data, DBUFSIZE, &summary);
+              tmpsum += summary.sum;
             }
           }
           // capture the real end-time. The last 'cyclestamp' is taken before the 
           //   buffer is used and would report a too small number
-          state->endtime = getcycles();
+          sdb->endtime = getcycles();
           // done with real-time stuff. The rest is for "fun". 
           for(int i=0; i < num; i++){
             for(int j=0; j < DOUBLEBUFFERS; j++){
@@ -162,20 +177,22 @@ void corethreadsdbwork(void *cpuidptr) {
           sync_printf(cpuid, "core 0 in double buffer 0 rx state 2\n", cpuid);
           for(int i=0; i<TDMSLOTS; i++) {
             sync_printf(cpuid, 
-              "buf_in[%d](->%d).data[0]=0x%08x : .data[1]=0x%08x ... .data[%d]=0x%08x\n",
-              i, gettxcorefromrxcoreslot(cpuid, i), state->buf_in[i][0].data[0], 
-              state->buf_in[i][0].data[1], DBUFSIZE-1, state->buf_in[i][0].data[DBUFSIZE-1]);
+              "buf_in[%d](->%d).data[0]=0x%08x : .data[1]=0x%08x ... .data[%d]=0x%08x checksum=0x%08x\n",
+              i, gettxcorefromrxcoreslot(cpuid, i), sdb->buf_in[i][0].data[0], 
+              sdb->buf_in[i][0].data[1], DBUFSIZE-1, sdb->buf_in[i][0].data[DBUFSIZE-1],
+              kernelchecksum(sdb->buf_in[i][0].data, DBUFSIZE));
           }
 
           sync_printf(cpuid, "core 0 in double buffer 1 rx state 2\n", cpuid);
           for(int i=0; i<TDMSLOTS; i++) {
             sync_printf(cpuid, 
-              "buf_in[%d](->%d).data[0]=0x%08x : .data[1]=0x%08x ... .data[%d]=0x%08x\n",
-              i, gettxcorefromrxcoreslot(cpuid, i), state->buf_in[i][1].data[0], 
-              state->buf_in[i][1].data[1], DBUFSIZE-1, state->buf_in[i][1].data[DBUFSIZE-1]);
+              "buf_in[%d](->%d).data[0]=0x%08x : .data[1]=0x%08x ... .data[%d]=0x%08x checksum=0x%08x\n",
+              i, gettxcorefromrxcoreslot(cpuid, i), sdb->buf_in[i][1].data[0], 
+              sdb->buf_in[i][1].data[1], DBUFSIZE-1, sdb->buf_in[i][1].data[DBUFSIZE-1],
+              kernelchecksum(sdb->buf_in[i][1].data, DBUFSIZE));
           }
 
-          int totalcycles = state->endtime - state->starttime;
+          int totalcycles = sdb->endtime - sdb->starttime;
           sync_printf(cpuid, "use-case cycles = %d\n", totalcycles);
           
         } else {
@@ -205,3 +222,5 @@ void corethreadsdbwork(void *cpuidptr) {
     state->loopcount++;
   } // while
 }
+
+const UseCase usecase4 = {4, "double buffer", corethreadsdbwork, sizeof(sdbstate_t), WORDS};
@@ -0,0 +1,176 @@
+/*
+  Software layer for One-Way Shared Memory
+  Use-case 5: All-pairs latency benchmark
+
+  Copyright: CBS, DTU
+  Authors: Rasmus Ulslev Pedersen, Martin Schoeberl
+  License: Simplified BSD
+*/
+
+#include "onewaysim.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//BENCHMARK: All-pairs write-to-visible latency
+///////////////////////////////////////////////////////////////////////////////
+
+// local state of each core
+typedef struct latstate_t {
+  unsigned int seed;
+  // noc cycle for the next tx stamp
+  unsigned int nexttx;
+  // last seen stamp and latency samples for each rx slot
+  unsigned int rxprev[TDMSLOTS];
+  int rxcnt[TDMSLOTS];
+  unsigned int rxlat[TDMSLOTS][LATSAMPLES];
+} latstate_t;
+
+// Each core writes a NoC cycle stamp into word LATWORD of all its tx slots.
+// Each rx core polls the same word in all its rx slots and takes a sample
+// (now - stamp) every time the stamp changes. A stamp is held for a random
+// time between one and two latency bounds, so the write hits the NI read of
+// the word at a random phase and the samples cover the best and worst cases.
+// When all cores have LATSAMPLES samples for every rx slot, each core
+// reports min/median/p99/max per (tx core, rx core) pair against the bound
+// from getlatencybound(). The report lines start with "latency," and are
+// collected as CSV/JSON by 'make latency' and 'make latencyonpatmos'.
+
+// rx side of a core is done: the senders keep stamping until all are done
+static volatile _UNCACHED bool latrxdone[CORES];
+
+static int cmplat(const void *a, const void *b) {
+  unsigned int x = *(const unsigned int *)a;
+  unsigned int y = *(const unsigned int *)b;
+  return (x > y) - (x < y);
+}
+
+// stamp all tx slots when the hold time is over
+static void lattxwork(int cpuid, latstate_t *lat) {
+  unsigned int now = getnoccycles();
+  if ((int)(now - lat->nexttx) >= 0) {
+    for(int i = 0; i < TDMSLOTS; i++)
+      core[cpuid].tx[i][LATWORD] = now;
+    unsigned int bound = getlatencybound(cpuid, getrxcorefromtxcoreslot(cpuid, 0));
+    lat->seed = lat->seed * 1103515245 + 12345;
+    lat->nexttx = now + bound + (lat->seed >> 8) % bound;
+  }
+}
+
+// sample all rx slots with a new stamp, returns true when all slots are full
+static bool latrxwork(int cpuid, latstate_t *lat) {
+  unsigned int now = getnoccycles();
+  bool allsampled = true;
+  for(int i = 0; i < TDMSLOTS; i++) {
+    unsigned int stamp = core[cpuid].rx[i][LATWORD];
+    if (stamp != lat->rxprev[i]) {
+      // the very first stamp is compared against the cleared memory
+      if (lat->rxprev[i] != 0 && lat->rxcnt[i] < LATSAMPLES)
+        lat->rxlat[i][lat->rxcnt[i]++] = now - stamp;
+      lat->rxprev[i] = stamp;
+    }
+    allsampled = allsampled && (lat->rxcnt[i] == LATSAMPLES);
+  }
+  return allsampled;
+}
+
+void corethreadlatwork(void *cpuidptr) {
+  int cpuid = *((int*)cpuidptr);
+  State *state;
+  statework(&state, cpuid);
+  latstate_t *lat = state->local;
+
+  if (state->loopcount == 0)
+    sync_printf(cpuid, "in corethreadlatwork(%d)...\n", cpuid);
+
+#ifdef RUNONPATMOS
+  while(runcores)
+#endif
+  {
+    switch (state->state) {
+      // init
+      case 0: {
+        lat->seed = 0x1234 + cpuid;
+        lat->nexttx = getnoccycles();
+        latrxdone[cpuid] = false;
+        for(int i = 0; i < TDMSLOTS; i++) {
+          lat->rxprev[i] = core[cpuid].rx[i][LATWORD];
+          lat->rxcnt[i] = 0;
+        }
+        if (cpuid == 0)
+          sync_printf(cpuid, "latency,txcore,rxcore,samples,min,median,p99,max,bound,ok\n");
+
+        // next state
+        if (true) {
+          state->state++;
+        }
+        break;
+      }
+
+      // tx stamps and rx samples until all cores have their samples
+      case 1: {
+        lattxwork(cpuid, lat);
+        if (latrxwork(cpuid, lat))
+          latrxdone[cpuid] = true;
+
+        bool alldonerx = true;
+        for(int c = 0; c < CORES; c++)
+          alldonerx = alldonerx && latrxdone[c];
+
+        // next state
+        if (alldonerx) {
+          state->state++;
+        } else if (!latrxdone[cpuid]) {
+          // the next stamp or sample (then poll for the other cores)
+          waitnoccycles(cpuid, lat->nexttx);
+          for(int i = 0; i < TDMSLOTS; i++)
+            waitrx(cpuid, i, LATWORD);
+        }
+        break;
+      }
+
+      // report the latency statistics for each pair with this core as rx core
+      case 2: {
+        bool allok = true;
+        for(int i = 0; i < TDMSLOTS; i++) {
+          unsigned int *samples = lat->rxlat[i];
+          qsort(samples, LATSAMPLES, sizeof(samples[0]), cmplat);
+          int txcore = gettxcorefromrxcoreslot(cpuid, i);
+          unsigned int bound = getlatencybound(txcore, cpuid);
+          bool ok = samples[LATSAMPLES - 1] <= bound;
+          allok = allok && ok;
+          sync_printf(cpuid, "latency,%d,%d,%d,%u,%u,%u,%u,%u,%d\n",
+            txcore, cpuid, LATSAMPLES, samples[0], samples[LATSAMPLES / 2],
+            samples[(LATSAMPLES * 99) / 100], samples[LATSAMPLES - 1], bound, ok);
+        }
+
+        // next state only if all pairs are within their bound
+        if (allok) {
+          state->state++;
+        } else {
+          sync_printf(cpuid, "error: latency bound exceeded on core %d\n", cpuid);
+          state->state = -1;
+        }
+        break;
+      }
+
+      // bound exceeded: stuck until the use-case is stopped
+      case -1: {
+        waitidle(cpuid);
+        break;
+      }
+
+      default: {
+        // default state: final exit by shared signal 'runcores = false'
+        defaultstatework(&state, cpuid);
+        break;
+      }
+    } // switch
+
+    if (cpuid == 0){
+      timeoutcheckcore0(&state);
+    }
+
+    state->loopcount++;
+  } // while
+}
+
+const UseCase usecase5 = {5, "all-pairs latency", corethreadlatwork, sizeof(latstate_t), LATWORD + 1};
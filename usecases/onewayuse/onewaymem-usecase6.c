@@ -0,0 +1,269 @@
+/*
+  Software layer for One-Way Shared Memory
+  Use-case 6: Streaming throughput benchmark
+
+  Copyright: CBS, DTU
+  Authors: Rasmus Ulslev Pedersen, Martin Schoeberl
+  License: Simplified BSD
+*/
+
+#include "onewaysim.h"
+#include "onewaykernels.h"
+#include "onewaylatency.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//BENCHMARK: Streaming throughput between all core pairs
+///////////////////////////////////////////////////////////////////////////////
+
+// local state of each core
+typedef struct strstate_t {
+  // noc cycles for the transfers and cpu cycles for the receiver load
+  unsigned int starttime;
+  unsigned int cpustart;
+  unsigned int cpubusy;
+  unsigned int cputotal;
+  // last sequence number sent and received on each slot
+  unsigned int txseq[TDMSLOTS];
+  unsigned int rxseq[TDMSLOTS];
+  // noc cycle when the last buffer arrived on each rx slot
+  unsigned int rxend[TDMSLOTS];
+  // noc cycle when the next buffer on each rx slot is whole (see bufsettled)
+  unsigned int rxsettle[TDMSLOTS];
+  int rxerrors;
+} strstate_t;
+
+// Like use-case 4, but every core streams STREAMBUFFERS buffers to every
+// other core. The tx slot holds DOUBLEBUFFERS buffers of STREAMBUFSIZE words
+// after the credit word (see STREAMACKWORD in onewaysim.h). The producer
+// writes the payload and the tail sequence number first and the head sequence
+// number last. The NI sends word w of a slot in period w of each hyperperiod,
+// so a write can go out over two hyperperiods, and head == tail == expected
+// sequence number can show around old payload words. The consumer takes the
+// buffer one hyperperiod after it first sees head == tail, when all its words
+// have arrived (see bufsettled in onewaylatency.h). It sums the payload (the
+// receiver work), checks it, and returns the sequence number as credit in its
+// tx slot back to the producer.
+// The producer only reuses a buffer when its credit has come back.
+//
+// The report lines start with "throughput," followed by kind, tx core, rx
+// core, and value:
+//   pair:      payload words per 1000 NoC cycles from tx core to rx core
+//   util:      receiver cpu utilization of the rx core in per mille
+//   bisection: payload words per 1000 NoC cycles crossing the grid bisection
+//   total:     payload words per 1000 NoC cycles summed over all pairs
+// 'make sweep' runs this use-case over NOCNODES, WORDS, and DOUBLEBUFFERS.
+
+// results shared with core 0 for the aggregate numbers
+static volatile _UNCACHED bool strdone[CORES];
+static volatile _UNCACHED unsigned int strtput[CORES][TDMSLOTS];
+
+// payload word k of buffer with sequence number seq
+#define STREAMWORD(seq, k) (((seq) << 16) + (k))
+
+// first word of the buffer for sequence number seq
+static int strbufbase(unsigned int seq) {
+  return 1 + ((seq - 1) % DOUBLEBUFFERS) * STREAMBUFSIZE;
+}
+
+// write the next buffers on each tx slot into the free buffers
+// returns true when all buffers are sent
+static bool strtxwork(int cpuid, strstate_t *str) {
+  bool alldone = true;
+  for(int i = 0; i < TDMSLOTS; i++) {
+    int rxcore = getrxcorefromtxcoreslot(cpuid, i);
+    int ackslot = getrxslotfromrxcoretxcoreslot(cpuid, rxcore, i);
+    unsigned int ack = core[cpuid].rx[ackslot][STREAMACKWORD];
+    unsigned int seq;
+    while ((seq = str->txseq[i] + 1) <= STREAMBUFFERS && seq - ack <= DOUBLEBUFFERS) {
+      volatile _SPM int *buf = core[cpuid].tx[i] + strbufbase(seq);
+      buf[STREAMBUFSIZE - 1] = seq;
+      for(int k = 0; k < STREAMPAYLOAD; k++)
+        buf[1 + k] = STREAMWORD(seq, k);
+      buf[0] = seq;
+      str->txseq[i] = seq;
+    }
+    alldone = alldone && (str->txseq[i] == STREAMBUFFERS);
+  }
+  return alldone;
+}
+
+// consume the buffers that have arrived in order on each rx slot
+// returns true when all buffers are received
+static bool strrxwork(int cpuid, strstate_t *str) {
+  bool alldone = true;
+  for(int i = 0; i < TDMSLOTS; i++) {
+    unsigned int seq;
+    while ((seq = str->rxseq[i] + 1) <= STREAMBUFFERS) {
+      volatile _SPM int *buf = core[cpuid].rx[i] + strbufbase(seq);
+      if ((unsigned int)buf[0] != seq || (unsigned int)buf[STREAMBUFSIZE - 1] != seq)
+        break;
+      if (!bufsettled(&str->rxsettle[i]))
+        break;
+      str->rxsettle[i] = 0;
+      unsigned int busystart = getcycles();
+      KernelSummary summary;
+      kernelsummary(buf + 1, STREAMPAYLOAD, &summary);
+      unsigned int sum = summary.sum;
+      unsigned int expected = STREAMPAYLOAD * STREAMWORD(seq, 0) +
+                              STREAMPAYLOAD * (STREAMPAYLOAD - 1) / 2;
+      if (sum != expected)
+        str->rxerrors++;
+      str->rxseq[i] = seq;
+      // credit back to the producer
+      int txcore = gettxcorefromrxcoreslot(cpuid, i);
+      int ackslot = gettxslotfromtxcorerxcoreslot(cpuid, txcore, i);
+      core[cpuid].tx[ackslot][STREAMACKWORD] = seq;
+      str->rxend[i] = getnoccycles();
+      str->cpubusy += getcycles() - busystart;
+    }
+    alldone = alldone && (str->rxseq[i] == STREAMBUFFERS);
+  }
+  return alldone;
+}
+
+// the credits and the next buffers that the streams wait for
+static void strwait(int cpuid, strstate_t *str) {
+  for(int i = 0; i < TDMSLOTS; i++) {
+    if (str->txseq[i] < STREAMBUFFERS) {
+      int rxcore = getrxcorefromtxcoreslot(cpuid, i);
+      waitrx(cpuid, getrxslotfromrxcoretxcoreslot(cpuid, rxcore, i), STREAMACKWORD);
+    }
+    if (str->rxseq[i] < STREAMBUFFERS) {
+      // the head is written last, and a buffer that showed up settles
+      waitrx(cpuid, i, strbufbase(str->rxseq[i] + 1));
+      if (str->rxsettle[i] != 0)
+        waitnoccycles(cpuid, str->rxsettle[i]);
+    }
+  }
+}
+
+// the grid is split into a left and a right half of the columns
+static bool strleftcore(int cpuid) {
+  return (cpuid % GRIDCOLS) < GRIDCOLS / 2;
+}
+
+void corethreadstrwork(void *cpuidptr) {
+  int cpuid = *((int*)cpuidptr);
+  State *state;
+  statework(&state, cpuid);
+  strstate_t *str = state->local;
+
+  if (state->loopcount == 0)
+    sync_printf(cpuid, "in corethreadstrwork(%d)...\n", cpuid);
+
+#ifdef RUNONPATMOS
+  while(runcores)
+#endif
+  {
+    switch (state->state) {
+      // init
+      case 0: {
+        strdone[cpuid] = false;
+        for(int i = 0; i < TDMSLOTS; i++) {
+          str->txseq[i] = 0;
+          str->rxseq[i] = 0;
+          str->rxsettle[i] = 0;
+          core[cpuid].tx[i][STREAMACKWORD] = 0;
+        }
+        str->starttime = getnoccycles();
+        str->cpustart = getcycles();
+
+        // next state
+        if (true) {
+          state->state++;
+        }
+        break;
+      }
+
+      // stream until all buffers are sent and received
+      case 1: {
+        bool txdone = strtxwork(cpuid, str);
+        bool rxdone = strrxwork(cpuid, str);
+
+        // next state
+        if (txdone && rxdone) {
+          str->cputotal = getcycles() - str->cpustart;
+          state->state++;
+        } else {
+          strwait(cpuid, str);
+        }
+        break;
+      }
+
+      // report this core as rx core
+      case 2: {
+        for(int i = 0; i < TDMSLOTS; i++) {
+          unsigned int cycles = str->rxend[i] - str->starttime;
+          strtput[cpuid][i] = (cycles == 0) ? 0 :
+            (unsigned int)((1000ULL * STREAMBUFFERS * STREAMPAYLOAD) / cycles);
+          sync_printf(cpuid, "throughput,pair,%d,%d,%u\n",
+            gettxcorefromrxcoreslot(cpuid, i), cpuid, strtput[cpuid][i]);
+        }
+        unsigned int util = (str->cputotal == 0) ? 0 :
+          (unsigned int)((1000ULL * str->cpubusy) / str->cputotal);
+        sync_printf(cpuid, "throughput,util,-1,%d,%u\n", cpuid, util);
+        strdone[cpuid] = true;
+
+        // next state only if the payload was ok
+        if (str->rxerrors == 0) {
+          state->state++;
+        } else {
+          sync_printf(cpuid, "error: %d buffers with wrong payload\n", str->rxerrors);
+          state->state = -1;
+        }
+        break;
+      }
+
+      // payload error: stuck until the use-case is stopped
+      case -1: {
+        waitidle(cpuid);
+        break;
+      }
+
+      // core 0 reports the aggregate throughput when all cores are done
+      case 3: {
+        if (cpuid != 0) {
+          state->state++;
+          break;
+        }
+        bool allstrdone = true;
+        for(int c = 0; c < CORES; c++)
+          allstrdone = allstrdone && strdone[c];
+        if (!allstrdone) {
+          for(int c = 0; c < CORES; c++)
+            if (!strdone[c])
+              waitstate(cpuid, c);
+        } else {
+          unsigned int bisection = 0;
+          unsigned int total = 0;
+          for(int c = 0; c < CORES; c++) {
+            for(int i = 0; i < TDMSLOTS; i++) {
+              int txcore = gettxcorefromrxcoreslot(c, i);
+              total += strtput[c][i];
+              if (strleftcore(txcore) != strleftcore(c))
+                bisection += strtput[c][i];
+            }
+          }
+          sync_printf(cpuid, "throughput,bisection,-1,-1,%u\n", bisection);
+          sync_printf(cpuid, "throughput,total,-1,-1,%u\n", total);
+          state->state++;
+        }
+        break;
+      }
+
+      default: {
+        // default state: final exit by shared signal 'runcores = false'
+        defaultstatework(&state, cpuid);
+        break;
+      }
+    } // switch
+
+    if (cpuid == 0){
+      timeoutcheckcore0(&state);
+    }
+
+    state->loopcount++;
+  } // while
+}
+
+const UseCase usecase6 = {6, "streaming throughput", corethreadstrwork, sizeof(strstate_t), WORDS};
@@ -0,0 +1,218 @@
+/*
+  Software layer for One-Way Shared Memory
+  Use-case 7: Routes between clusters through gateway cores
+
+  Copyright: CBS, DTU
+  Authors: Rasmus Ulslev Pedersen, Martin Schoeberl
+  License: Simplified BSD
+*/
+
+#include "onewaysim.h"
+#include "onewaycluster.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//BENCHMARK: End-to-end latency and throughput of cluster routes
+///////////////////////////////////////////////////////////////////////////////
+
+// routes of each core: to the next core of its cluster and to the core half
+// the cores away (in another cluster when there are several)
+#define CLROUTES 2
+
+// local state of each core
+typedef struct clstate_t {
+  int txroute[CLROUTES];
+  int rxroute[CLROUTES];
+  // last seen stamp, latency samples, and the noc cycles of the first and
+  // last sample for each rx route
+  unsigned int rxprev[CLROUTES];
+  int rxcnt[CLROUTES];
+  unsigned int rxmin[CLROUTES];
+  unsigned int rxmax[CLROUTES];
+  unsigned int rxfirst[CLROUTES];
+  unsigned int rxlast[CLROUTES];
+} clstate_t;
+
+// Core 0 adds the routes of all cores to the routing table of onewaycluster.h
+// and the other cores wait for it. Then each core writes a message of
+// CLUSTERWORDS copies of the NoC cycle stamp on its routes in every loop,
+// forwards the routes it is a gateway for, and takes a latency sample (now -
+// stamp) when a complete new message arrives on one of its rx routes. When
+// all cores have CLUSTERSAMPLES samples for their rx routes, each core
+// reports its rx routes against the bound from getclusterlatency(), with a
+// gateway loop of one round, and the throughput as the message words per
+// 100000 NoC cycles. The report lines start with "clusterroute," and 'make
+// clusters' compares a flat grid against the same cores in clusters.
+
+static volatile _UNCACHED bool clready;
+// rx side of a core is done: the senders keep stamping until all are done
+static volatile _UNCACHED bool clrxdone[CORES];
+
+// the destinations of the routes of a core
+static int cldst(int cpuid, int r) {
+  if (r == 0)
+    return getcluster(cpuid) * CLUSTERCORES + (cpuid + 1) % CLUSTERCORES;
+  return (cpuid + CORES / 2) % CORES;
+}
+
+// add the routes of all cores, returns false when one does not fit
+static bool clroutesinit() {
+  clusterroutesreset();
+  for(int c = 0; c < CORES; c++)
+    for(int r = 0; r < CLROUTES; r++)
+      if (clusterrouteadd(c, cldst(c, r), CLUSTERWORDS) < 0)
+        return false;
+  return true;
+}
+
+// sample the rx routes with a new complete message, returns true when all
+// routes are sampled
+static bool clrxwork(clstate_t *cl) {
+  unsigned int now = getnoccycles();
+  unsigned int msg[CLUSTERWORDS];
+  bool allsampled = true;
+  for(int r = 0; r < CLROUTES; r++) {
+    clusterread(cl->rxroute[r], msg);
+    bool complete = true;
+    for(int i = 1; i < CLUSTERWORDS; i++)
+      complete = complete && (msg[i] == msg[0]);
+    if (complete && msg[0] != cl->rxprev[r] && cl->rxcnt[r] < CLUSTERSAMPLES) {
+      // the very first stamp is compared against the cleared memory
+      if (cl->rxprev[r] != 0) {
+        unsigned int lat = now - msg[0];
+        cl->rxmin[r] = (cl->rxcnt[r] == 0 || lat < cl->rxmin[r]) ? lat : cl->rxmin[r];
+        cl->rxmax[r] = (lat > cl->rxmax[r]) ? lat : cl->rxmax[r];
+        if (cl->rxcnt[r] == 0)
+          cl->rxfirst[r] = now;
+        cl->rxlast[r] = now;
+        cl->rxcnt[r]++;
+      }
+      cl->rxprev[r] = msg[0];
+    }
+    allsampled = allsampled && (cl->rxcnt[r] == CLUSTERSAMPLES);
+  }
+  return allsampled;
+}
+
+void corethreadclusterwork(void *cpuidptr) {
+  int cpuid = *((int*)cpuidptr);
+  State *state;
+  statework(&state, cpuid);
+  clstate_t *cl = state->local;
+
+  if (state->loopcount == 0)
+    sync_printf(cpuid, "in corethreadclusterwork(%d)...\n", cpuid);
+
+#ifdef RUNONPATMOS
+  while(runcores)
+#endif
+  {
+    switch (state->state) {
+      // init: core 0 adds the routes
+      case 0: {
+        if (cpuid == 0) {
+          clready = false;
+          if (!clroutesinit()) {
+            sync_printf(cpuid, "error: the cluster routes do not fit\n");
+            state->state = -1;
+            break;
+          }
+          sync_printf(cpuid, "clusterroute,clusters,clustercores,src,dst,gateways,words,samples,min,max,bound,throughput,ok\n");
+          clready = true;
+        } else if (!clready) {
+          waitstate(cpuid, 0);
+          break;
+        }
+        clrxdone[cpuid] = false;
+        int ntx = 0;
+        int nrx = 0;
+        for(int id = 0; id < getclusterroutes(); id++) {
+          ClusterRoute route = getclusterroute(id);
+          if (route.src == cpuid && ntx < CLROUTES)
+            cl->txroute[ntx++] = id;
+          if (route.dst == cpuid && nrx < CLROUTES)
+            cl->rxroute[nrx++] = id;
+        }
+        for(int r = 0; r < CLROUTES; r++) {
+          cl->rxprev[r] = 0;
+          cl->rxcnt[r] = 0;
+          cl->rxmax[r] = 0;
+        }
+
+        // next state
+        if (true) {
+          state->state++;
+        }
+        break;
+      }
+
+      // stamp, forward, and sample until all cores have their samples
+      case 1: {
+        unsigned int msg[CLUSTERWORDS];
+        unsigned int now = getnoccycles();
+        for(int i = 0; i < CLUSTERWORDS; i++)
+          msg[i] = now;
+        for(int r = 0; r < CLROUTES; r++)
+          clusterwrite(cl->txroute[r], msg);
+        clusterforward(cpuid);
+        if (clrxwork(cl))
+          clrxdone[cpuid] = true;
+
+        bool alldonerx = true;
+        for(int c = 0; c < CORES; c++)
+          alldonerx = alldonerx && clrxdone[c];
+
+        // next state
+        if (alldonerx) {
+          state->state++;
+        }
+        break;
+      }
+
+      // report the rx routes of this core
+      case 2: {
+        bool allok = true;
+        for(int r = 0; r < CLROUTES; r++) {
+          ClusterRoute route = getclusterroute(cl->rxroute[r]);
+          unsigned int bound = getclusterlatency(cl->rxroute[r], gethyperperiodcycles());
+          unsigned int cycles = cl->rxlast[r] - cl->rxfirst[r];
+          unsigned int tput = cycles == 0 ? 0 :
+            (unsigned int)((unsigned long long)(CLUSTERSAMPLES - 1) * CLUSTERWORDS * 100000 / cycles);
+          bool ok = cl->rxmax[r] <= bound;
+          allok = allok && ok;
+          sync_printf(cpuid, "clusterroute,%d,%d,%d,%d,%d,%d,%d,%u,%u,%u,%u,%d\n",
+            CLUSTERS, CLUSTERCORES, route.src, route.dst, route.gatewayout < 0 ? 0 : 2,
+            CLUSTERWORDS, CLUSTERSAMPLES, cl->rxmin[r], cl->rxmax[r], bound, tput, ok);
+        }
+
+        // next state only if all routes are within their bound
+        if (allok) {
+          state->state++;
+        } else {
+          sync_printf(cpuid, "error: cluster route bound exceeded on core %d\n", cpuid);
+          state->state = -1;
+        }
+        break;
+      }
+
+      // routes do not fit or bound exceeded: stuck until the use-case is stopped
+      case -1: {
+        waitidle(cpuid);
+        break;
+      }
+
+      default: {
+        // default state: final exit by shared signal 'runcores = false'
+        defaultstatework(&state, cpuid);
+        break;
+      }
+    } // switch
+
+    if (cpuid == 0){
+      timeoutcheckcore0(&state);
+    }
+
+    state->loopcount++;
+  } // while
+}
+
+const UseCase usecase7 = {7, "cluster routes", corethreadclusterwork, sizeof(clstate_t), WORDS};
@@ -0,0 +1,166 @@
+/*
+  Software layer for One-Way Shared Memory
+  Use-case 8: Multicast over a relay tree
+
+  Copyright: CBS, DTU
+  Authors: Rasmus Ulslev Pedersen, Martin Schoeberl
+  License: Simplified BSD
+*/
+
+#include "onewaysim.h"
+#include "onewaymulticast.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//BENCHMARK: Multicast relay tree against direct fan-out
+///////////////////////////////////////////////////////////////////////////////
+
+// local state of each core
+typedef struct mcstate_t {
+  MulticastTree tree;
+  // words this core writes into tx slots per message
+  int txwords;
+  // last seen stamp and latency samples
+  unsigned int rxprev;
+  int rxcnt;
+  unsigned int rxmin;
+  unsigned int rxmax;
+} mcstate_t;
+
+// Like the sensor message of use-case 3, core MULTICASTROOT sends a message
+// of MULTICASTWORDS words to all other cores of its cluster, here over the
+// tree of MULTICASTPOLICY and MULTICASTFANOUT (see onewaymulticast.h). The
+// root writes a new message with the NoC cycle stamp in all words in every
+// loop, the relays forward it in every loop, and each core takes a latency
+// sample (now - stamp) when a complete new message arrives. When all cores
+// have MULTICASTSAMPLES samples, each core reports its parent, depth, the
+// words it writes per message, and the latencies against the bound from
+// getmulticastlatency() with a relay loop of one round. The report lines
+// start with "multicast," and 'make multicast' compares the policies.
+
+// a core is done: the root and the relays keep going until all are done
+static volatile _UNCACHED bool mcdone[CORES];
+
+// sample a complete new message, returns true when the core has all samples
+static bool mcrxwork(int cpuid, mcstate_t *mc) {
+  unsigned int now = getnoccycles();
+  unsigned int msg[MULTICASTWORDS];
+  multicastread(&mc->tree, cpuid, msg, 0, MULTICASTWORDS);
+  bool complete = true;
+  for(int i = 1; i < MULTICASTWORDS; i++)
+    complete = complete && (msg[i] == msg[0]);
+  if (complete && msg[0] != mc->rxprev && mc->rxcnt < MULTICASTSAMPLES) {
+    // the very first stamp is compared against the cleared memory
+    if (mc->rxprev != 0) {
+      unsigned int lat = now - msg[0];
+      mc->rxmin = (mc->rxcnt == 0 || lat < mc->rxmin) ? lat : mc->rxmin;
+      mc->rxmax = (lat > mc->rxmax) ? lat : mc->rxmax;
+      mc->rxcnt++;
+    }
+    mc->rxprev = msg[0];
+  }
+  return mc->rxcnt == MULTICASTSAMPLES;
+}
+
+void corethreadmulticastwork(void *cpuidptr) {
+  int cpuid = *((int*)cpuidptr);
+  State *state;
+  statework(&state, cpuid);
+  mcstate_t *mc = state->local;
+
+  if (state->loopcount == 0)
+    sync_printf(cpuid, "in corethreadmulticastwork(%d)...\n", cpuid);
+
+#ifdef RUNONPATMOS
+  while(runcores)
+#endif
+  {
+    switch (state->state) {
+      // init: every core builds the same tree
+      case 0: {
+        multicastinit(&mc->tree, MULTICASTROOT, MULTICASTPOLICY, MULTICASTFANOUT);
+        mc->txwords = getmulticastchildren(&mc->tree, cpuid) * MULTICASTWORDS;
+        mc->rxprev = 0;
+        mc->rxcnt = 0;
+        mc->rxmax = 0;
+        // the root and the cores of other clusters have nothing to receive
+        mcdone[cpuid] = (cpuid == MULTICASTROOT || mc->tree.position[cpuid] < 0);
+        if (cpuid == 0)
+          sync_printf(cpuid, "multicast,policy,fanout,cores,core,parent,depth,txwords,min,max,bound,ok\n");
+
+        // next state
+        if (true) {
+          state->state++;
+        }
+        break;
+      }
+
+      // send, forward, and sample until all cores have their samples
+      case 1: {
+        if (cpuid == MULTICASTROOT) {
+          unsigned int msg[MULTICASTWORDS];
+          unsigned int now = getnoccycles();
+          for(int i = 0; i < MULTICASTWORDS; i++)
+            msg[i] = now;
+          multicastsend(&mc->tree, msg, 0, MULTICASTWORDS);
+        } else if (mc->tree.position[cpuid] >= 0) {
+          multicastforward(&mc->tree, cpuid, 0, MULTICASTWORDS);
+          if (mcrxwork(cpuid, mc))
+            mcdone[cpuid] = true;
+        }
+
+        bool alldone = true;
+        for(int c = 0; c < CORES; c++)
+          alldone = alldone && mcdone[c];
+
+        // next state
+        if (alldone) {
+          state->state++;
+        }
+        break;
+      }
+
+      // report this core
+      case 2: {
+        bool ok = true;
+        if (mc->tree.position[cpuid] >= 0) {
+          unsigned int bound = getmulticastlatency(&mc->tree, cpuid, 0, MULTICASTWORDS,
+                                                   gethyperperiodcycles());
+          ok = mc->rxmax <= bound;
+          sync_printf(cpuid, "multicast,%d,%d,%d,%d,%d,%d,%d,%u,%u,%u,%d\n",
+            MULTICASTPOLICY, mc->tree.fanout, CLUSTERCORES, cpuid,
+            getmulticastparent(&mc->tree, cpuid), getmulticastdepth(&mc->tree, cpuid),
+            mc->txwords, mc->rxmin, mc->rxmax, bound, ok);
+        }
+
+        // next state only if the core is within its bound
+        if (ok) {
+          state->state++;
+        } else {
+          sync_printf(cpuid, "error: multicast bound exceeded on core %d\n", cpuid);
+          state->state = -1;
+        }
+        break;
+      }
+
+      // bound exceeded: stuck until the use-case is stopped
+      case -1: {
+        waitidle(cpuid);
+        break;
+      }
+
+      default: {
+        // default state: final exit by shared signal 'runcores = false'
+        defaultstatework(&state, cpuid);
+        break;
+      }
+    } // switch
+
+    if (cpuid == 0){
+      timeoutcheckcore0(&state);
+    }
+
+    state->loopcount++;
+  } // while
+}
+
+const UseCase usecase8 = {8, "multicast relay tree", corethreadmulticastwork, sizeof(mcstate_t), MULTICASTWORDS};
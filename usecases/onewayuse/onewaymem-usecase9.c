@@ -0,0 +1,209 @@
+/*
+  Software layer for One-Way Shared Memory
+  Use-case 9: Aggregator inbox
+
+  Copyright: CBS, DTU
+  Authors: Rasmus Ulslev Pedersen, Martin Schoeberl
+  License: Simplified BSD
+*/
+
+#include "onewaysim.h"
+#include "onewayinbox.h"
+#include "onewaylatency.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//BENCHMARK: Aggregator inbox against per-slot polling
+///////////////////////////////////////////////////////////////////////////////
+
+// local state of each core
+typedef struct ibstate_t {
+  Inbox inbox;
+  // noc cycle when the slots have the cleared words of all cores
+  unsigned int starttime;
+  // noc cycle of the next message of a producer
+  unsigned int nexttime;
+  // loops and cpu cycles of the aggregator in its fetches
+  int loops;
+  unsigned int cpu;
+  int rxerrors;
+} ibstate_t;
+
+// The first core of each cluster is an aggregator, and all other cores of
+// the cluster are producers that send it INBOXMESSAGES messages of
+// INBOXPAYLOAD words each over the inbox of onewayinbox.h. Producer i of the
+// cluster sends at most one message every i rounds, so only some of the rx
+// slots of the aggregator have a new message in a loop. The aggregator
+// fetches all messages that have arrived in each loop, from the inbox
+// (INBOXPOLL 0) or by checking its rx slots one by one (INBOXPOLL 1), and
+// checks their payload. When it has all messages, it reports the loops, the
+// passes over all head words (scans), the slot checks, and the cpu cycles of
+// its fetches. The report lines start with "inbox," and 'make inbox' compares
+// the two over the grid size.
+
+// a core has cleared its slots
+static volatile _UNCACHED bool ibcleared[CORES];
+
+// payload word k of message seq from txcore
+#define INBOXWORD(txcore, seq, k) (((txcore) << 20) + ((seq) << 8) + (k))
+
+static int ibaggregator(int cpuid) {
+  return cpuid - cpuid % CLUSTERCORES;
+}
+
+// check the payload of a message
+static void ibcheck(int cpuid, ibstate_t *ib, int rxslot, const unsigned int *payload) {
+  int txcore = gettxcorefromrxcoreslot(cpuid, rxslot);
+  unsigned int seq = ib->inbox.rxseq[rxslot];
+  for(int k = 0; k < INBOXPAYLOAD; k++)
+    if (payload[k] != INBOXWORD(txcore, seq, k))
+      ib->rxerrors++;
+}
+
+// fetch all messages that have arrived and check them
+static void ibrxwork(int cpuid, ibstate_t *ib) {
+  unsigned int payload[INBOXPAYLOAD];
+  unsigned int cpustart = getcycles();
+#if INBOXPOLL
+  ib->inbox.scans++;
+  for(int i = 0; i < TDMSLOTS; i++)
+    if (inboxtake(&ib->inbox, i, payload))
+      ibcheck(cpuid, ib, i, payload);
+#else
+  int rxslot;
+  while ((rxslot = inboxnext(&ib->inbox, payload)) >= 0)
+    ibcheck(cpuid, ib, rxslot, payload);
+#endif
+  ib->cpu += getcycles() - cpustart;
+  ib->loops++;
+}
+
+void corethreadinboxwork(void *cpuidptr) {
+  int cpuid = *((int*)cpuidptr);
+  State *state;
+  statework(&state, cpuid);
+  ibstate_t *ib = state->local;
+  bool aggregator = (cpuid == ibaggregator(cpuid));
+
+  if (state->loopcount == 0)
+    sync_printf(cpuid, "in corethreadinboxwork(%d)...\n", cpuid);
+
+#ifdef RUNONPATMOS
+  while(runcores)
+#endif
+  {
+    switch (state->state) {
+      // init: clear the slots
+      case 0: {
+        inboxinit(&ib->inbox, cpuid);
+        ib->starttime = 0;
+        ib->nexttime = 0;
+        ib->loops = 0;
+        ib->cpu = 0;
+        ib->rxerrors = 0;
+        ibcleared[cpuid] = true;
+        if (cpuid == 0)
+          sync_printf(cpuid, "inbox,poll,cores,core,peers,messages,loops,scans,checks,cpu,errors,ok\n");
+
+        // next state
+        if (true) {
+          state->state++;
+        }
+        break;
+      }
+
+      // wait until the cleared words of all cores have arrived, so that no
+      // words of an earlier use-case look like a message
+      case 1: {
+        int notcleared = -1;
+        for(int c = 0; c < CORES && notcleared < 0; c++)
+          if (!ibcleared[c])
+            notcleared = c;
+        if (notcleared >= 0) {
+          waitstate(cpuid, notcleared);
+          break;
+        }
+        if (ib->starttime == 0)
+          ib->starttime = getnoccycles() + getmaxlatency();
+
+        // next state
+        if ((int)(getnoccycles() - ib->starttime) >= 0) {
+          state->state++;
+        } else {
+          waitnoccycles(cpuid, ib->starttime);
+        }
+        break;
+      }
+
+      // send or fetch until all messages are through
+      case 2: {
+        bool done;
+        if (aggregator) {
+          ibrxwork(cpuid, ib);
+          done = ib->inbox.messages == (CLUSTERCORES - 1) * INBOXMESSAGES;
+          if (!done)
+            inboxwaitrx(&ib->inbox);
+        } else {
+          int rxcore = ibaggregator(cpuid);
+          int txslot = gettxslotfromtxcorerxcoreslot(cpuid, rxcore, -1);
+          unsigned int seq = ib->inbox.txseq[txslot] + 1;
+          unsigned int payload[INBOXPAYLOAD];
+          for(int k = 0; k < INBOXPAYLOAD; k++)
+            payload[k] = INBOXWORD(cpuid, seq, k);
+          unsigned int now = getnoccycles();
+          if (seq <= INBOXMESSAGES && now >= ib->nexttime &&
+              inboxsend(&ib->inbox, rxcore, payload))
+            ib->nexttime = now + (cpuid - rxcore) * gethyperperiodcycles();
+          done = ib->inbox.txseq[txslot] == INBOXMESSAGES;
+          if (!done && now < ib->nexttime)
+            waitnoccycles(cpuid, ib->nexttime);
+          else if (!done)
+            inboxwaittx(&ib->inbox, rxcore);
+        }
+
+        // next state
+        if (done) {
+          state->state++;
+        }
+        break;
+      }
+
+      // report the aggregator
+      case 3: {
+        bool ok = (ib->rxerrors == 0);
+        if (aggregator)
+          sync_printf(cpuid, "inbox,%d,%d,%d,%d,%d,%d,%d,%d,%u,%d,%d\n",
+            INBOXPOLL, CLUSTERCORES, cpuid, CLUSTERCORES - 1, ib->inbox.messages, ib->loops,
+            ib->inbox.scans, ib->inbox.checks, ib->cpu, ib->rxerrors, ok);
+
+        // next state only if the payload was ok
+        if (ok) {
+          state->state++;
+        } else {
+          sync_printf(cpuid, "error: %d inbox words with wrong payload\n", ib->rxerrors);
+          state->state = -1;
+        }
+        break;
+      }
+
+      // wrong payload: stuck until the use-case is stopped
+      case -1: {
+        waitidle(cpuid);
+        break;
+      }
+
+      default: {
+        // default state: final exit by shared signal 'runcores = false'
+        defaultstatework(&state, cpuid);
+        break;
+      }
+    } // switch
+
+    if (cpuid == 0){
+      timeoutcheckcore0(&state);
+    }
+
+    state->loopcount++;
+  } // while
+}
+
+const UseCase usecase9 = {9, "aggregator inbox", corethreadinboxwork, sizeof(ibstate_t), INBOXWORDS};
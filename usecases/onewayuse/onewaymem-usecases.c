@@ -8,16 +8,73 @@
 */
 
 #include "onewaysim.h"
+#include "onewaylatency.h"
 
 #ifdef RUNONPATMOS
 //#define ONEWAY_BASE ((volatile _IODEV int *) 0xE8000000)
 //volatile _SPM int *alltxmem = ONEWAY_BASE;
 //volatile _SPM int *allrxmem = ONEWAY_BASE;
-#else
-int alltxmem[CORES][TDMSLOTS][WORDS];
-int allrxmem[CORES][TDMSLOTS][WORDS];
 #endif
 
+// shared flags, registers, and per core state (declared in onewaysim.h)
+volatile _UNCACHED bool runcores;
+volatile _UNCACHED CoreFlags coreflags[CORES];
+_SHARED PATMOS_REGISTER TDMROUND_REGISTER;
+_SHARED PATMOS_REGISTER HYPERPERIOD_REGISTER;
+_SHARED State states[CORES];
+_SIMLOCAL Core core[CORES];
+_SIMLOCAL int coreid[CORES];
+
+const UseCase *usecases[] = {
+  &usecase0, &usecase1, &usecase2, &usecase3, &usecase4, &usecase5, &usecase6,
+  &usecase7, &usecase8, &usecase9, &usecase10, &usecase11,
+  &usecase12, &usecase14,
+#ifdef ONEWAYCHANNELS
+  &usecase13
+#endif
+};
+
+// per core arena for the local state of the use-cases
+static _SIMLOCAL char statearena[CORES][STATEARENASIZE] CACHEALIGNED;
+static _SIMLOCAL int statearenaused[CORES];
+
+const UseCase *getusecase(int id) {
+  for(int i = 0; i < NUSECASES; i++)
+    if (usecases[i]->id == id)
+      return usecases[i];
+  return NULL;
+}
+
+void *statealloc(int cpuid, int size) {
+  // keep the local state word aligned
+  size = (size + sizeof(long long) - 1) & ~(int)(sizeof(long long) - 1);
+  if (statearenaused[cpuid] + size > STATEARENASIZE)
+    return NULL;
+  void *p = &statearena[cpuid][statearenaused[cpuid]];
+  statearenaused[cpuid] += size;
+  memset(p, 0, size);
+  return p;
+}
+
+void statearenareset() {
+  for(int c = 0; c < CORES; c++)
+    statearenaused[c] = 0;
+}
+
+bool usecasestatesinit(const UseCase *usecase) {
+  memset(states, 0, sizeof(states));
+  for(int c = 0; c < CORES; c++) {
+    states[c].runcore = true;
+    states[c].local = statealloc(c, usecase->localsize);
+    if (states[c].local == NULL) {
+      sweepprintf("use-case %d: no room for %d bytes of local state on core %d\n",
+                  usecase->id, usecase->localsize, c);
+      return false;
+    }
+  }
+  return true;
+}
+
 //static volatile _UNCACHED int testval = -1;
 static volatile _UNCACHED int _nextcore = -1;
 
@@ -34,11 +91,27 @@ void defaultstatework(State** state, int cpuid){
     // the other cores 1..CORES-1 to stop using the global flag 'runcores'
     if (alldone(cpuid))
       runcores = false;
+  } else {
+    waitidle(cpuid);
   }
 }
 
+// core 0 stops a use-case that is not done TIMEOUTLATENCIES times the largest
+// worst-case latency of the NoC after its first round
+#ifndef TIMEOUTLATENCIES
+#define TIMEOUTLATENCIES 100000
+#endif
+
+unsigned int gettimeoutcycles() {
+  unsigned long long cycles = (unsigned long long)TIMEOUTLATENCIES * getmaxlatency();
+  return cycles < INT_MAX ? (unsigned int)cycles : INT_MAX;
+}
+
 void timeoutcheckcore0(State** state){
-  if((*state)->loopcount == 1e6) {
+  if((*state)->loopcount == 0)
+    (*state)->starttime = getnoccycles();
+  if((*state)->runcore &&
+     (unsigned int)getnoccycles() - (*state)->starttime > gettimeoutcycles()) {
     (*state)->runcore = false; 
     // signal to stop the slave cores
     runcores = false;
@@ -46,6 +119,75 @@ void timeoutcheckcore0(State** state){
   } 
 }
 
+#ifndef RUNONPATMOS
+static _SIMLOCAL CoreWait corewaitsdefault[CORES];
+// NULL: the default waits (backends that do not switch them)
+_SIMLOCAL CoreWait *corewaits;
+
+static CoreWait *corewait(int cpuid) {
+  return (corewaits != NULL ? corewaits : corewaitsdefault) + cpuid;
+}
+
+void waitrx(int cpuid, int rxslot, int w) {
+  CoreWait *wait = corewait(cpuid);
+  wait->waiting = true;
+  if (wait->nrx == WAITRXMAX) {
+    wait->overflow = true;
+    return;
+  }
+  wait->rxaddr[wait->nrx] = &core[cpuid].rx[rxslot][w];
+  wait->rxvalue[wait->nrx] = core[cpuid].rx[rxslot][w];
+  wait->nrx++;
+}
+
+void waitnoccycles(int cpuid, unsigned int noccycles) {
+  CoreWait *wait = corewait(cpuid);
+  // the earliest time wins
+  if (!wait->timed || (int)(noccycles - wait->until) < 0)
+    wait->until = noccycles;
+  wait->waiting = true;
+  wait->timed = true;
+}
+
+void waitstate(int cpuid, int othercore) {
+  CoreWait *wait = corewait(cpuid);
+  wait->waiting = true;
+  if (wait->nstate == CORES) {
+    wait->overflow = true;
+    return;
+  }
+  wait->statecore[wait->nstate] = othercore;
+  wait->statevalue[wait->nstate] = states[othercore].state;
+  wait->nstate++;
+}
+
+void waitidle(int cpuid) {
+  corewait(cpuid)->waiting = true;
+}
+
+bool waitready(int cpuid) {
+  CoreWait *wait = corewait(cpuid);
+  if (!wait->waiting || wait->overflow)
+    return true;
+  for (int i = 0; i < wait->nrx; i++)
+    if (*wait->rxaddr[i] != wait->rxvalue[i])
+      return true;
+  for (int i = 0; i < wait->nstate; i++)
+    if (states[wait->statecore[i]].state != wait->statevalue[i])
+      return true;
+  return wait->timed && (int)(getnoccycles() - wait->until) >= 0;
+}
+
+void waitclear(int cpuid) {
+  CoreWait *wait = corewait(cpuid);
+  wait->waiting = false;
+  wait->overflow = false;
+  wait->nrx = 0;
+  wait->timed = false;
+  wait->nstate = 0;
+}
+#endif
+
 int nextcore() {
   _nextcore++;
   if (_nextcore == CORES)
@@ -71,12 +213,12 @@ void zeroouttxmem(int cpuid) {
 void holdandgowork(int cpuid) {
   zeroouttxmem(cpuid);
   spinwork(1e6);
-  coreready[cpuid] = true;
+  coreflags[cpuid].ready = true;
   bool allcoresready = false;
   while(!allcoresready){
     allcoresready = true;
     for(int i = 0; i < CORES; i++) 
-      if (coreready[i] == false)
+      if (coreflags[i].ready == false)
         allcoresready = false;
   }
 }
@@ -86,10 +228,10 @@ void holdandgowork(int cpuid) {
 // so we must wait for all cores to finish before core 0 signals to the 
 // other cores to stop using 'runcores = false'
 bool alldone(int cpuid) {
-  coredone[cpuid] = true;
+  coreflags[cpuid].done = true;
   bool allcoresdone = true;
   for(int i = 0; i < CORES; i++) 
-    allcoresdone = allcoresdone && coredone[i];
+    allcoresdone = allcoresdone && coreflags[i].done;
   
   return allcoresdone;
 }
@@ -98,20 +240,36 @@ bool alldone(int cpuid) {
 const char* allfinishedok() {
   bool allcoresfinishedok = true;
   for(int i = 0; i < CORES; i++) 
-    allcoresfinishedok = allcoresfinishedok && coredone[i];
+    allcoresfinishedok = allcoresfinishedok && coreflags[i].done;
   
   return (allcoresfinishedok ? "pass" : "fail");
 }
 
+#if !defined(RUNONPATMOS) && !defined(RUNONPOSIX) && !defined(RUNONVERILATOR)
+_SIMLOCAL bool noctimestamps;
+#endif
+
 // used for synchronizing printf from the different cores
 int getcycles() {
 #ifdef RUNONPATMOS
   volatile _IODEV int *io_ptr = (volatile _IODEV int *)0xf0020004; 
   return (unsigned int)*io_ptr;
+#elif defined(RUNONVERILATOR)
+  return gethwcycles();
+#elif defined(RUNONPOSIX)
+  // one time base for all core processes (clock() is per process),
+  // kept positive for the sync_printf timestamps
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int)((now.tv_sec * 1000000 + now.tv_nsec / 1000) & 0x7fffffff);
 #else
-  clock_t now_t;
-  now_t = clock();
-  return (int)now_t;
+  if (noctimestamps)
+    return getnoccycles();
+  // cpu time of the calling thread, as clock() counts it, but a psweep
+  // thread that simulates its own NoC does not count the other threads
+  struct timespec now;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+  return (int)((now.tv_sec * 1000000 + now.tv_nsec / 1000) & 0x7fffffff);
   //This was real clock cycles on Ubunty
   //unsigned long a, d;
   //__asm__ volatile ("rdtsc" : "=a" (a), "=d" (d));
@@ -136,10 +294,14 @@ void recordhyperperiodwork(int cpuid, unsigned int* hyperperiods) {
 
 // mappings
 static const char *rstr = ROUTESSTRING;
-static int tx_core_tdmslots_map[CORES][TDMSLOTS];
-static int rx_core_tdmslots_map[CORES][TDMSLOTS];
-// route strings
-static char *routes[TDMSLOTS];
+static _SIMLOCAL int tx_core_tdmslots_map[CORES][TDMSLOTS];
+static _SIMLOCAL int rx_core_tdmslots_map[CORES][TDMSLOTS];
+// the rx slot of the route of each tx slot and back (the same for all cores)
+static _SIMLOCAL int rxslotoftxslot[TDMSLOTS];
+static _SIMLOCAL int txslotofrxslot[TDMSLOTS];
+// route strings (in routechars, which holds ROUTESSTRING with '\0' for '|')
+static _SIMLOCAL char routechars[sizeof(ROUTESSTRING)];
+static _SIMLOCAL char *routes[TDMSLOTS];
 
 // get coreid from NoC grid position
 int getcoreid(int row, int col, int n) {
@@ -148,17 +310,21 @@ int getcoreid(int row, int col, int n) {
 
 // convert the routes string into separate routes 
 void initroutestrings() {
-  printf("initroutestrings:\n");
+  sweepprintf("initroutestrings:\n");
+#ifdef GENERATEDROUTESFILE
+  sweepprintf("%dx%d grid, %d slots from %s\n", GRIDROWS, GRIDCOLS, TDMSLOTS, GENERATEDROUTESFILE);
+#endif
   int start = 0;
   int stop = 0;
+  memcpy(routechars, rstr, sizeof(routechars));
   for(int i = 0; i < TDMSLOTS; i++){
     while(rstr[stop] != '|')
       stop++;
-    routes[i] = calloc(stop - start + 1 , 1);
-    strncpy(routes[i], &rstr[start], stop - start);
+    routes[i] = &routechars[start];
+    routechars[stop] = '\0';
     stop++;
     start = stop;
-    printf("%s\n", routes[i]);
+    sweepprintf("%s\n", routes[i]);
   }
 }
 
@@ -170,18 +336,26 @@ void txrxmapsinit() {
 //   this is done by tracking the grid index for each of the possible directins of
 //   'n', 'e', 's', and 'w'. From the destination grid position the core id is 
 //   calculated (using getcoreid(gridx, gridy, n). 
-  for(int tx_i = 0; tx_i < GRIDN; tx_i++){
-    for(int tx_j = 0; tx_j < GRIDN; tx_j++){
+// each cluster (CLUSTERS) is a grid of its own, numbered after the previous ones
+ for(int cluster = 0; cluster < CLUSTERS; cluster++){
+  int base = cluster * CLUSTERCORES;
+  for(int tx_i = 0; tx_i < GRIDROWS; tx_i++){
+    for(int tx_j = 0; tx_j < GRIDCOLS; tx_j++){
     // simulate each route for the given rx core
       for(int slot = 0; slot < TDMSLOTS; slot++){
       // the tx and rx tdm slot are known by now
         char *route = routes[slot];
 
-        int txcoreid = getcoreid(tx_i, tx_j, GRIDN);
+        int txcoreid = base + getcoreid(tx_i, tx_j, GRIDCOLS);
         int rxcoreid = -1;
 
         int txtdmslot = slot;
-        int rxtdmslot = (strlen(route)) % 3; 
+        // the rx NI fills its slots in the order the words arrive, which is
+        // the order of the route lengths (the 'l' is the arrival cycle)
+        int rxtdmslot = 0;
+        for(int i = 0; i < TDMSLOTS; i++)
+          if (strlen(routes[i]) < strlen(route))
+            rxtdmslot++;
 
       // now for the rx core id
         int rx_i = tx_i;
@@ -189,52 +363,59 @@ void txrxmapsinit() {
         for(int r = 0; r < strlen(route); r++){
           switch(route[r]){
            case 'n':
-           rx_i = (rx_i - 1 >= 0 ? rx_i - 1 : GRIDN - 1);
+           rx_i = (rx_i - 1 >= 0 ? rx_i - 1 : GRIDROWS - 1);
            break;
            case 's':
-           rx_i = (rx_i + 1 < GRIDN ? rx_i + 1 : 0);
+           rx_i = (rx_i + 1 < GRIDROWS ? rx_i + 1 : 0);
            break;
            case 'e':
-           rx_j = (rx_j + 1 < GRIDN ? rx_j + 1 : 0);
+           rx_j = (rx_j + 1 < GRIDCOLS ? rx_j + 1 : 0);
            break;
            case 'w':
-           rx_j = (rx_j - 1 >= 0 ? rx_j - 1 : GRIDN - 1);
+           rx_j = (rx_j - 1 >= 0 ? rx_j - 1 : GRIDCOLS - 1);
            break;
          }
        }        
 
-       rxcoreid = getcoreid(rx_i, rx_j, GRIDN);
+       rxcoreid = base + getcoreid(rx_i, rx_j, GRIDCOLS);
 
      // fill in the rx core id in the tx slot map
        tx_core_tdmslots_map[txcoreid][txtdmslot] = rxcoreid;
      // fill in the tx core id in the rx slot map
        rx_core_tdmslots_map[rxcoreid][rxtdmslot] = txcoreid;
+       rxslotoftxslot[txtdmslot] = rxtdmslot;
+       txslotofrxslot[rxtdmslot] = txtdmslot;
      }
    }
+  }
  }
+  latencyinit();
 }
 
 // will print the TX and RX TDM slots for each core
 void showmappings() {
-  printf("Transmit memory blocks and receive memory blocks (see Fig. 3 in the paper):\n");
+  sweepprintf("Transmit memory blocks and receive memory blocks (see Fig. 3 in the paper):\n");
   for(int i = 0; i < CORES; i++){
-    printf("  Core %d tdm slots:\n", i);
+    sweepprintf("  Core %d tdm slots:\n", i);
     // show them like in the paper
     for(int j = TDMSLOTS-1; j >= 0; j--){
-      printf("    tx slot %d:   to rx core %d rx slot %d\n", 
-             j, getrxcorefromtxcoreslot(i, j), //tx_core_tdmslots_map[i][j],
-             getrxslotfromrxcoretxcoreslot(tx_core_tdmslots_map[i][j], i, j));//getrxcorefromtxcoreslot(i, j)); 
+      sweepprintf("    tx slot %d:   to rx core %d rx slot %d\n", 
+                  j, getrxcorefromtxcoreslot(i, j), //tx_core_tdmslots_map[i][j],
+                  getrxslotfromrxcoretxcoreslot(tx_core_tdmslots_map[i][j], i, j));//getrxcorefromtxcoreslot(i, j)); 
     }
     for(int j = TDMSLOTS-1; j >= 0; j--){
-      printf("    rx slot %d: from tx core %d tx slot %d\n", 
-             j, gettxcorefromrxcoreslot(i, j), //rx_core_tdmslots_map[i][j],
-             gettxslotfromtxcorerxcoreslot(rx_core_tdmslots_map[i][j], i, j));//gettxcorefromrxcoreslot(i, j)); 
+      sweepprintf("    rx slot %d: from tx core %d tx slot %d\n", 
+                  j, gettxcorefromrxcoreslot(i, j), //rx_core_tdmslots_map[i][j],
+                  gettxslotfromtxcorerxcoreslot(rx_core_tdmslots_map[i][j], i, j));//gettxcorefromrxcoreslot(i, j)); 
     }
   }
 }
 
 // get the rx tdm slot based on rx core, tx core and tx (TDM) slot index
 int getrxslotfromrxcoretxcoreslot(int rxcore, int txcore, int txslot) {
+  // a pair can have more than one slot
+  if (txslot >= 0 && txslot < TDMSLOTS && tx_core_tdmslots_map[txcore][txslot] == rxcore)
+    return rxslotoftxslot[txslot];
   int rxslot = -1;
   for(int i = 0; i < TDMSLOTS; i++){
     int txcorecandidate = gettxcorefromrxcoreslot(rxcore, i);  
@@ -248,6 +429,9 @@ int getrxslotfromrxcoretxcoreslot(int rxcore, int txcore, int txslot) {
 
 // get the tx tdm slot based on tx core, rx core and rx (TDM) slot index
 int gettxslotfromtxcorerxcoreslot(int txcore, int rxcore, int rxslot) {
+  // a pair can have more than one slot
+  if (rxslot >= 0 && rxslot < TDMSLOTS && rx_core_tdmslots_map[rxcore][rxslot] == txcore)
+    return txslotofrxslot[rxslot];
   int txslot = -1;
   for(int i = 0; i < TDMSLOTS; i++){
     int rxcorecandidate = getrxcorefromtxcoreslot(txcore, i);  
@@ -268,3 +452,72 @@ int getrxcorefromtxcoreslot(int txcore, int txslot) {
 int gettxcorefromrxcoreslot(int rxcore, int rxslot) {
   return rx_core_tdmslots_map[rxcore][rxslot];
 }
+
+// the slots from txcore to rxcore in the order of the tx slots, each with
+// the rx slot that its route leads to
+void channelinit(Channel *ch, int txcore, int rxcore) {
+  ch->slots = 0;
+  for(int i = 0; i < TDMSLOTS && ch->slots < PAIRSLOTSMAX; i++){
+    if (tx_core_tdmslots_map[txcore][i] != rxcore)
+      continue;
+    ch->txslot[ch->slots] = i;
+    ch->rxslot[ch->slots] = rxslotoftxslot[i];
+    ch->tx[ch->slots] = core[txcore].tx[i];
+    ch->rx[ch->slots] = core[rxcore].rx[rxslotoftxslot[i]];
+    ch->slots++;
+  }
+}
+
+// length of the TDM schedule in clock cycles, which is the longest route
+// (one word delivered from all to all)
+int getschedulelength() {
+  int len = 0;
+  for(int i = 0; i < TDMSLOTS; i++){
+    if ((int)strlen(routes[i]) > len)
+      len = strlen(routes[i]);
+  }
+  return len;
+}
+
+// clock cycles a word spends in the routers on the route of a tx slot
+// the leading spaces are the cycles the route waits before it is injected
+int getroutehops(int txslot) {
+  char *route = routes[txslot];
+  int wait = 0;
+  while(route[wait] == ' ')
+    wait++;
+  return strlen(route) - wait;
+}
+
+// cycle of the schedule in which the route of a tx slot is injected
+int getrouteinject(int txslot) {
+  char *route = routes[txslot];
+  int wait = 0;
+  while(route[wait] == ' ')
+    wait++;
+  return wait;
+}
+
+// clock cycles for one memory block (WORDS words) delivered from all to all
+int gethyperperiodcycles() {
+  return WORDS * getschedulelength();
+}
+
+// worst-case write-to-visible latency in clock cycles for a word written by
+// txcore in its tx slot to rxcore: a word that is written just after the NI 
+// has read it waits one hyperperiod, then it travels its route and passes
+// the NI pipeline on both sides (see onewaylatency.h)
+int getlatencybound(int txcore, int rxcore) {
+  return getwordlatency(txcore, rxcore, 0).worst;
+}
+
+// the time base for NoC measurements: clock cycles on patmos and verilator
+// and simulated NoC cycles on the PC (the simulator delivers one hyperperiod
+// per round)
+int getnoccycles() {
+#if defined(RUNONPATMOS) || defined(RUNONVERILATOR)
+  return getcycles();
+#else
+  return HYPERPERIOD_REGISTER * gethyperperiodcycles();
+#endif
+}
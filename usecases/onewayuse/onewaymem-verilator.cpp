@@ -0,0 +1,262 @@
+/*
+  One-Way Shared Memory
+  Runs the use-cases on the OneWayMem hardware, verilated
+
+  Copyright: CBS, DTU
+  Authors: Rasmus Ulslev Pedersen, Martin Schoeberl
+  License: Simplified BSD
+*/
+
+#include "onewaysim.h"
+
+#include <sys/time.h>
+#include "verilated.h"
+#include "VOneWayMem.h"
+
+// The Verilog of OneWayMem(2, 1024) from 'make hardware' is compiled with
+// verilator and replaces simcontrol(). The cores step through their state
+// machines like in the simulator and work on their tx/rx images in
+// alltxmem/allrxmem. After each step, hwsync() clocks the hardware and
+// connects the images to the memPorts of the nodes: each cycle, the write
+// port of a node takes the next tx word that the core has changed and the
+// read port reads the next rx word into the rx image. A step ends when all
+// changed tx words are written and all rx words have been read once.
+//
+// getcycles() and getnoccycles() are the hardware clock cycles, so the
+// use-cases report true cycle counts. The rx image is refreshed once per
+// step, so the latency a core sees includes up to one refresh of
+// TDMSLOTS * WORDS cycles on top of the NoC latency.
+//
+// make verilator usecase=<id>
+
+#if NOCNODES != 4 || WORDS != 256
+#error "OneWayMem(2, 1024) has 4 nodes with 256 words per slot"
+#endif
+
+int alltxmem[CORES][TDMSLOTS][WORDS];
+int allrxmem[CORES][TDMSLOTS][WORDS];
+
+// the tx words in the hardware memory
+static int hwtxmem[CORES][TDMSLOTS][WORDS];
+
+static VOneWayMem *top;
+static unsigned long long hwcycles;
+
+// the memory port of one node (memSize 1024: 10 address bits)
+typedef struct MemPort {
+  SData *rdaddr;
+  SData *wraddr;
+  IData *wrdata;
+  CData *wrena;
+  IData *rddata;
+} MemPort;
+
+#define MEMPORT(i) { &top->io_memPorts_##i##_rdAddr, &top->io_memPorts_##i##_wrAddr, \
+  &top->io_memPorts_##i##_wrData, &top->io_memPorts_##i##_wrEna, &top->io_memPorts_##i##_rdData }
+
+static MemPort memports[CORES];
+
+// the memory address is the slot (upper bits) and the word (lower bits)
+static int hwaddr(int slot, int w) {
+  return slot * WORDS + w;
+}
+
+extern "C" int gethwcycles() {
+  return (int)hwcycles;
+}
+
+void statework(State **state, int cpuid) {
+  *state = &states[cpuid];
+  (*state)->runcore = true;
+}
+
+// one clock cycle
+static void hwclock() {
+  top->clk = 0;
+  top->eval();
+  top->clk = 1;
+  top->eval();
+  hwcycles++;
+  HYPERPERIOD_REGISTER = hwcycles / gethyperperiodcycles();
+  TDMROUND_REGISTER = hwcycles / getschedulelength();
+}
+
+static void hwreset() {
+  top->reset = 1;
+  for (int i = 0; i < 4; i++)
+    hwclock();
+  top->reset = 0;
+}
+
+// clock the hardware until the changed tx words are written and all rx words
+// are read once, returns the number of cycles
+static int hwsync() {
+  int txpos[CORES];
+  int rdpos = 0;
+  int cycles = 0;
+  bool txpending = true;
+  for (int c = 0; c < CORES; c++)
+    txpos[c] = 0;
+
+  while (txpending || rdpos < TDMSLOTS * WORDS) {
+    txpending = false;
+    for (int c = 0; c < CORES; c++) {
+      MemPort *port = &memports[c];
+      *port->wrena = 0;
+      // next changed tx word
+      while (txpos[c] < TDMSLOTS * WORDS) {
+        int slot = txpos[c] / WORDS;
+        int w = txpos[c] % WORDS;
+        txpos[c]++;
+        if (alltxmem[c][slot][w] != hwtxmem[c][slot][w]) {
+          hwtxmem[c][slot][w] = alltxmem[c][slot][w];
+          *port->wraddr = hwaddr(slot, w);
+          *port->wrdata = hwtxmem[c][slot][w];
+          *port->wrena = 1;
+          break;
+        }
+      }
+      txpending = txpending || (txpos[c] < TDMSLOTS * WORDS);
+      if (rdpos < TDMSLOTS * WORDS)
+        *port->rdaddr = hwaddr(rdpos / WORDS, rdpos % WORDS);
+    }
+    hwclock();
+    cycles++;
+    // the read address is registered, the data is there after the clock edge
+    if (rdpos < TDMSLOTS * WORDS) {
+      for (int c = 0; c < CORES; c++)
+        allrxmem[c][rdpos / WORDS][rdpos % WORDS] = *memports[c].rddata;
+      rdpos++;
+    }
+  }
+  for (int c = 0; c < CORES; c++)
+    *memports[c].wrena = 0;
+  return cycles;
+}
+
+// clear the images and the hardware memories
+static void nocmem() {
+  for (int i = 0; i < CORES; i++) {
+    for (int j = 0; j < TDMSLOTS; j++) {
+      core[i].tx[j] = alltxmem[i][j];
+      core[i].rx[j] = allrxmem[i][j];
+      for (int w = 0; w < WORDS; w++) {
+        alltxmem[i][j][w] = 0;
+        // forces a write of all words
+        hwtxmem[i][j][w] = -1;
+      }
+    }
+  }
+  hwsync();
+  // deliver the zeros to all rx memories
+  for (int i = 0; i < gethyperperiodcycles() + getschedulelength(); i++)
+    hwclock();
+  hwsync();
+}
+
+void nocinit()
+{
+  printf("in nocinit()...\n");
+  txrxmapsinit();
+  showmappings();
+
+  top = new VOneWayMem;
+  MemPort ports[CORES] = { MEMPORT(0), MEMPORT(1), MEMPORT(2), MEMPORT(3) };
+  for (int c = 0; c < CORES; c++) {
+    memports[c] = ports[c];
+    coreid[c] = c;
+  }
+  hwreset();
+  nocmem();
+}
+
+// step the cores and the hardware until the use-case is done
+static void hwcontrol(const UseCase *usecase)
+{
+  while (states[0].runcore) {
+    for (int c = 0; c < CORES; c++)
+      usecase->corefunc(&coreid[c]);
+    hwsync();
+  }
+}
+
+static double walltime() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//verilator main
+///////////////////////////////////////////////////////////////////////////////
+
+// usage: VOneWayMem all | <use-case id> ...
+//   the selected use-cases run one after the other
+int main(int argc, char *argv[])
+{
+  const UseCase *selected[NUSECASES];
+  int nselected = 0;
+
+  Verilated::commandArgs(argc, argv);
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "all") == 0) {
+      for (int u = 0; u < NUSECASES && nselected < NUSECASES; u++)
+        selected[nselected++] = usecases[u];
+    } else if (argv[i][0] != '+') {
+      const UseCase *usecase = getusecase(atoi(argv[i]));
+      if (usecase == NULL || nselected == NUSECASES) {
+        printf("Unimplemented use-case %s. Exit\n", argv[i]);
+        exit(0);
+      }
+      selected[nselected++] = usecase;
+    }
+  }
+  if (nselected == 0) {
+    printf("usage: %s all | <use-case id> ...\n", argv[0]);
+    for (int u = 0; u < NUSECASES; u++)
+      printf("  %d: %s\n", usecases[u]->id, usecases[u]->name);
+    exit(0);
+  }
+
+  nocinit();
+
+  for (int i = 0; i < nselected; i++) {
+    const UseCase *usecase = selected[i];
+    printf("*******************************************\n");
+    printf("****onewaymem: run use-case %d on verilated OneWayMem****\n", usecase->id);
+    printf("*******************************************\n");
+    printf("USECASE == %d: %s\n", usecase->id, usecase->name);
+
+    nocmem();
+    statearenareset();
+    if (!usecasestatesinit(usecase))
+      break;
+    for (int c = 0; c < CORES; c++)
+      coreflags[c].done = false;
+    runcores = true;
+
+    unsigned long long startcycles = hwcycles;
+    double starttime = walltime();
+    hwcontrol(usecase);
+    double seconds = walltime() - starttime;
+    unsigned long long cycles = hwcycles - startcycles;
+    printf("Done...\n");
+
+    for (int c = 0; c < CORES; ++c) {
+      printf("Sync print from core %d:\n", c);
+      sync_print_core(c);
+    }
+    sync_printreset();
+
+    printf("***************************************************************\n");
+    printf("Use-case %d result [pass/fail]: %s\n", usecase->id, allfinishedok());
+    printf("%llu clock cycles in %.3f s: %.0f cycles/s\n", cycles, seconds,
+           seconds > 0 ? cycles / seconds : 0.0);
+    printf("***************************************************************\n");
+  }
+
+  top->final();
+  delete top;
+  return 0;
+}
@@ -0,0 +1,51 @@
+//onewaymonitor.h
+#ifndef ONEWAYMONITOR_H
+#define ONEWAYMONITOR_H
+
+#include <stddef.h>
+
+// Live monitor segment of the PC simulator (a.out -m <name>), a POSIX shared
+// memory segment that onewaymem-monitor.c attaches to while the simulation
+// runs. It holds a header, one MonitorSlot for each rx slot, and a copy of
+// the rx memory [cores][tdmslots][words]. The simulator updates the slots and
+// the copy when it delivers words. After a delivery, the rx slots hold the
+// words of the tx slots that are routed to them, so the copy shows the tx
+// memory as well.
+//
+// The header is a sequence lock: seq is odd while the simulator delivers a
+// round, and a reader retries when seq was odd or has changed while it
+// copied the segment.
+
+#define MONITORMAGIC "OWMON1"
+#define MONITORNAME "/oneway-monitor"
+
+typedef struct MonitorHeader {
+  char magic[8];
+  int cores;
+  int tdmslots;
+  int words;
+  // the use-case that runs (-1 for several at once)
+  int usecase;
+  volatile unsigned int seq;
+  // the last delivered round
+  volatile unsigned int round;
+  // cleared when the simulator is done
+  volatile int running;
+} MonitorHeader;
+
+typedef struct MonitorSlot {
+  // the tx core and tx slot that are routed to the rx slot
+  int txcore;
+  int txslot;
+  // rounds in which a word of the slot changed, and the last of them
+  unsigned int updates;
+  unsigned int lastround;
+} MonitorSlot;
+
+// the slots and the rx memory of a segment
+#define MONITORSLOTS(header) ((MonitorSlot *)((MonitorHeader *)(header) + 1))
+#define MONITORRX(header) ((int *)(MONITORSLOTS(header) + (header)->cores * (header)->tdmslots))
+#define MONITORSIZE(cores, tdmslots, words) (sizeof(MonitorHeader) + \
+  (size_t)(cores) * (tdmslots) * (sizeof(MonitorSlot) + (words) * sizeof(int)))
+
+#endif
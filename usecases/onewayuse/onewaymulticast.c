@@ -0,0 +1,108 @@
+//onewaymulticast.c
+#include "onewaymulticast.h"
+#include "onewaylatency.h"
+
+void multicastinit(MulticastTree *tree, int root, int policy, int fanout) {
+  int base = root - root % CLUSTERCORES;
+  tree->root = root;
+  tree->policy = policy;
+  tree->fanout = (policy == MULTICASTDIRECT || fanout < 1) ? CLUSTERCORES - 1 : fanout;
+  tree->members = CLUSTERCORES;
+  for (int c = 0; c < CORES; c++)
+    tree->position[c] = -1;
+  // the other cores of the cluster after the root, by id
+  for (int i = 0; i < CLUSTERCORES; i++)
+    tree->order[i] = base + (root - base + i) % CLUSTERCORES;
+  if (policy == MULTICASTNEAR) {
+    // insertion sort by the hops of the route from the root (stable, so by
+    // id on equal hops)
+    for (int i = 2; i < CLUSTERCORES; i++) {
+      int c = tree->order[i];
+      int hops = getroutehops(gettxslotfromtxcorerxcoreslot(root, c, -1));
+      int j = i;
+      while (j > 1 && getroutehops(gettxslotfromtxcorerxcoreslot(root, tree->order[j - 1], -1)) > hops) {
+        tree->order[j] = tree->order[j - 1];
+        j--;
+      }
+      tree->order[j] = c;
+    }
+  }
+  for (int i = 0; i < CLUSTERCORES; i++) {
+    int c = tree->order[i];
+    tree->position[c] = i;
+    tree->txslot[i] = -1;
+    tree->rxslot[i] = -1;
+    if (i > 0) {
+      int parent = tree->order[(i - 1) / tree->fanout];
+      tree->txslot[i] = gettxslotfromtxcorerxcoreslot(parent, c, -1);
+      tree->rxslot[i] = getrxslotfromrxcoretxcoreslot(c, parent, tree->txslot[i]);
+    }
+  }
+}
+
+int getmulticastparent(const MulticastTree *tree, int core) {
+  int i = tree->position[core];
+  return i > 0 ? tree->order[(i - 1) / tree->fanout] : -1;
+}
+
+int getmulticastchildren(const MulticastTree *tree, int core) {
+  int i = tree->position[core];
+  if (i < 0)
+    return 0;
+  int first = i * tree->fanout + 1;
+  int last = first + tree->fanout;
+  last = (last < tree->members) ? last : tree->members;
+  return (first < last) ? last - first : 0;
+}
+
+int getmulticastdepth(const MulticastTree *tree, int core) {
+  int depth = 0;
+  for (int i = tree->position[core]; i > 0; i = (i - 1) / tree->fanout)
+    depth++;
+  return depth;
+}
+
+// write the message into the tx slots to the children of the core at
+// position i
+static int multicastchildren(const MulticastTree *tree, int i, const volatile _SPM int *from,
+                             const unsigned int *data, int w, int n) {
+  int cpuid = tree->order[i];
+  int words = 0;
+  for (int k = i * tree->fanout + 1; k <= i * tree->fanout + tree->fanout && k < tree->members; k++) {
+    volatile _SPM int *to = core[cpuid].tx[tree->txslot[k]] + w;
+    for (int j = 0; j < n; j++)
+      to[j] = (from != NULL) ? from[j] : (int)data[j];
+    words += n;
+  }
+  return words;
+}
+
+int multicastsend(const MulticastTree *tree, const unsigned int *data, int w, int n) {
+  return multicastchildren(tree, 0, NULL, data, w, n);
+}
+
+int multicastforward(const MulticastTree *tree, int cpuid, int w, int n) {
+  int i = tree->position[cpuid];
+  if (i <= 0)
+    return 0;
+  return multicastchildren(tree, i, core[cpuid].rx[tree->rxslot[i]] + w, NULL, w, n);
+}
+
+void multicastread(const MulticastTree *tree, int cpuid, unsigned int *data, int w, int n) {
+  volatile _SPM int *from = core[cpuid].rx[tree->rxslot[tree->position[cpuid]]] + w;
+  for (int j = 0; j < n; j++)
+    data[j] = from[j];
+}
+
+unsigned int getmulticastlatency(const MulticastTree *tree, int core, int w, int n,
+                                 unsigned int forwardcycles) {
+  unsigned int latency = 0;
+  for (int c = core; c != tree->root; c = getmulticastparent(tree, c)) {
+    int parent = getmulticastparent(tree, c);
+    latency += getmessagelatency(parent, c, w, n).worst;
+    // the copy of a relay
+    if (parent != tree->root)
+      latency += forwardcycles;
+  }
+  return latency;
+}
@@ -0,0 +1,70 @@
+//onewaymulticast.h
+#ifndef ONEWAYMULTICAST_H
+#define ONEWAYMULTICAST_H
+
+#include "onewaysim.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Multicast of a message from a root core to the other cores of its cluster
+// over a relay tree on the slot mappings. The root writes the message only
+// into the tx slots to its children, and each core with children copies it
+// from its rx slot from its parent into its tx slots to its children, once
+// per loop. The root writes fanout instead of CORES - 1 copies, and a core
+// gets the message after one NoC channel per tree level and one loop per
+// relay on the way.
+//
+// The policy orders the cores in a tree with fanout children per core (the
+// children of position i are the positions i * fanout + 1 .. i * fanout +
+// fanout, so there are about log_fanout(CORES) levels):
+//   MULTICASTDIRECT: all cores are children of the root (direct fan-out)
+//   MULTICASTTREE:   the cores in the order of their ids after the root
+//   MULTICASTNEAR:   the cores in the order of the route hops from the root,
+//                    so the relays are the cores closest to the root
+// The message is the words w .. w+n-1 of the slots; every core builds the
+// same tree itself.
+
+#define MULTICASTDIRECT 0
+#define MULTICASTTREE 1
+#define MULTICASTNEAR 2
+
+typedef struct MulticastTree {
+  int root;
+  int policy;
+  int fanout;
+  // the cores in tree order (order[0] is the root)
+  int members;
+  int order[CLUSTERCORES];
+  // the position of each core in order (-1 when it is not in the tree)
+  int position[CORES];
+  // for each position: the tx slot of the parent and the rx slot of the core
+  int txslot[CLUSTERCORES];
+  int rxslot[CLUSTERCORES];
+} MulticastTree;
+
+// the tree of policy over the cluster of root
+void multicastinit(MulticastTree *tree, int root, int policy, int fanout);
+
+// the tree around a core (-1 for no parent)
+int getmulticastparent(const MulticastTree *tree, int core);
+int getmulticastchildren(const MulticastTree *tree, int core);
+int getmulticastdepth(const MulticastTree *tree, int core);
+
+// the root writes a message, a relay forwards it (both return the words
+// written into tx slots), and a core reads it from its parent
+int multicastsend(const MulticastTree *tree, const unsigned int *data, int w, int n);
+int multicastforward(const MulticastTree *tree, int cpuid, int w, int n);
+void multicastread(const MulticastTree *tree, int cpuid, unsigned int *data, int w, int n);
+
+// worst-case latency from the write of the root until core can read the
+// message, when the loop of a relay takes at most forwardcycles
+unsigned int getmulticastlatency(const MulticastTree *tree, int core, int w, int n,
+                                 unsigned int forwardcycles);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
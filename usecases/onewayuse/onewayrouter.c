@@ -0,0 +1,318 @@
+//onewayrouter.c
+#include "onewayrouter.h"
+
+#define NORTH 0
+#define EAST 1
+#define SOUTH 2
+#define WEST 3
+#define LOCAL 4
+#define PORTS 5
+
+// no route is longer than the routes string
+#define SCHEDMAX ((int)sizeof(ROUTESSTRING))
+
+// no changed word in the flit
+#define UNCHANGED 0xffffffffu
+
+typedef struct Flit {
+  int data;
+  bool valid;
+  // model only: where the flit came from, and the round start when the word
+  // was written (UNCHANGED when the NI read the same word before)
+  short txcore;
+  short txslot;
+  unsigned int written;
+} Flit;
+
+// no input: the output register takes an invalid flit
+#define IDLE -1
+
+// schedule: the input port of each output port in each cycle (or IDLE), and
+// the cycles where the NIs inject
+static _SIMLOCAL int schedlen;
+static _SIMLOCAL int sched[SCHEDMAX][PORTS];
+static _SIMLOCAL bool schedvalid[SCHEDMAX];
+static _SIMLOCAL int neighbor[CORES][PORTS];
+
+// router output registers (double buffered) and the TDM counters
+static _SIMLOCAL Flit routerout[2][CORES][PORTS];
+static _SIMLOCAL int current;
+static _SIMLOCAL int counter;
+static _SIMLOCAL int delay;
+
+// NIs: tx and rx address counters (slot and word), registered read address
+// and valid of the tx side
+static _SIMLOCAL int txupper[CORES];
+static _SIMLOCAL int txlower[CORES];
+static _SIMLOCAL int rdslot[CORES];
+static _SIMLOCAL int rdword[CORES];
+static _SIMLOCAL bool rdvalid[CORES];
+static _SIMLOCAL int rxupper[CORES];
+static _SIMLOCAL int rxlower[CORES];
+// the words as the NIs read them the last time
+static _SIMLOCAL int txseen[CORES][TDMSLOTS][WORDS];
+
+// statistics
+static _SIMLOCAL unsigned int cycle;
+static _SIMLOCAL unsigned long long cycles;
+static _SIMLOCAL unsigned long long flits;
+static _SIMLOCAL unsigned long long misrouted;
+static _SIMLOCAL unsigned long long portflits[CORES][PORTS];
+static _SIMLOCAL unsigned int latmin[CORES][CORES];
+static _SIMLOCAL unsigned int latmax[CORES][CORES];
+static _SIMLOCAL unsigned long long latsum[CORES][CORES];
+static _SIMLOCAL unsigned int latcount[CORES][CORES];
+static _SIMLOCAL double seconds;
+// the simulator routing of each tx core and tx slot
+static _SIMLOCAL int rxcoreof[CORES][TDMSLOTS];
+static _SIMLOCAL int rxslotof[CORES][TDMSLOTS];
+
+static int portof(char c) {
+  switch (c) {
+    case 'n': return NORTH;
+    case 'e': return EAST;
+    case 's': return SOUTH;
+    case 'w': return WEST;
+    default: return LOCAL;
+  }
+}
+
+// the input port that the next hop of a flit leaving on a port uses
+static char nextfrom(char c) {
+  switch (c) {
+    case 'n': return 's';
+    case 'e': return 'w';
+    case 's': return 'n';
+    case 'w': return 'e';
+    default: return 'l';
+  }
+}
+
+// the schedule of ROUTESSTRING, as Schedule.getSchedule() builds it
+static void routerschedule() {
+  const char *routes = ROUTESSTRING;
+  const char *route[TDMSLOTS];
+  int len[TDMSLOTS];
+  int start = 0;
+  schedlen = 0;
+  for (int i = 0; i < TDMSLOTS; i++) {
+    int stop = start;
+    while (routes[stop] != '|')
+      stop++;
+    route[i] = &routes[start];
+    len[i] = stop - start;
+    schedlen = (len[i] > schedlen) ? len[i] : schedlen;
+    start = stop + 1;
+  }
+  for (int j = 0; j < SCHEDMAX; j++)
+    for (int p = 0; p < PORTS; p++)
+#ifdef SIMROUTERNORTH
+      sched[j][p] = NORTH;
+#else
+      sched[j][p] = IDLE;
+#endif
+  memset(schedvalid, 0, sizeof(schedvalid));
+  for (int i = 0; i < TDMSLOTS; i++) {
+    char from = 'l';
+    for (int j = 0; j < len[i]; j++) {
+      char to = route[i][j];
+      if (to != ' ') {
+        sched[j][portof(to)] = portof(from);
+        from = nextfrom(to);
+      }
+    }
+  }
+  // a route starts injecting in the cycle of its first hop
+  int line = 0;
+  for (int i = 0; i < schedlen - 1 && line < TDMSLOTS; i++) {
+    schedvalid[i] = i < len[line] && route[line][i] != ' ';
+    if (schedvalid[i])
+      line++;
+  }
+
+  // the torus of Network.scala
+  for (int r = 0; r < CORES; r++) {
+    int i = r / GRIDCOLS;
+    int j = r % GRIDCOLS;
+    neighbor[r][NORTH] = ((i + GRIDROWS - 1) % GRIDROWS) * GRIDCOLS + j;
+    neighbor[r][EAST] = i * GRIDCOLS + (j + 1) % GRIDCOLS;
+    neighbor[r][SOUTH] = ((i + 1) % GRIDROWS) * GRIDCOLS + j;
+    neighbor[r][WEST] = i * GRIDCOLS + (j + GRIDCOLS - 1) % GRIDCOLS;
+    neighbor[r][LOCAL] = r;
+  }
+}
+
+void routerreset() {
+  routerschedule();
+  memset(routerout, 0, sizeof(routerout));
+  current = 0;
+  counter = 0;
+  delay = 0;
+  memset(txupper, 0, sizeof(txupper));
+  memset(txlower, 0, sizeof(txlower));
+  memset(rdslot, 0, sizeof(rdslot));
+  memset(rdword, 0, sizeof(rdword));
+  memset(rdvalid, 0, sizeof(rdvalid));
+  memset(rxupper, 0, sizeof(rxupper));
+  memset(rxlower, 0, sizeof(rxlower));
+  memset(txseen, 0, sizeof(txseen));
+  // the counters start with the next round
+  cycle = HYPERPERIOD_REGISTER * WORDS * schedlen;
+  cycles = 0;
+  flits = 0;
+  misrouted = 0;
+  memset(portflits, 0, sizeof(portflits));
+  memset(latcount, 0, sizeof(latcount));
+  memset(latsum, 0, sizeof(latsum));
+  memset(latmax, 0, sizeof(latmax));
+  memset(latmin, 0xff, sizeof(latmin));
+  seconds = 0;
+  for (int c = 0; c < CORES; c++) {
+    for (int j = 0; j < TDMSLOTS; j++) {
+      rxcoreof[c][j] = getrxcorefromtxcoreslot(c, j);
+      rxslotof[c][j] = getrxslotfromrxcoretxcoreslot(rxcoreof[c][j], c, j);
+    }
+  }
+}
+
+// one clock cycle of all routers and NIs, round is the start of the round
+static void routercycle(const int (*tx)[TDMSLOTS][WORDS], int (*rx)[TDMSLOTS][WORDS],
+                        unsigned int round) {
+  Flit (*out)[PORTS] = routerout[current];
+  Flit (*next)[PORTS] = routerout[1 - current];
+  const int *from = sched[delay];
+
+  for (int r = 0; r < CORES; r++) {
+    // the tx side of the NI: the word at the registered read address
+    Flit local;
+    local.valid = rdvalid[r];
+    local.data = tx[r][rdslot[r]][rdword[r]];
+    local.txcore = r;
+    local.txslot = rdslot[r];
+    local.written = UNCHANGED;
+    if (local.valid) {
+      int *seen = &txseen[r][rdslot[r]][rdword[r]];
+      if (*seen != local.data) {
+        local.written = round;
+        *seen = local.data;
+      }
+    }
+
+    // the rx side of the NI: the local output register of the router
+    Flit *in = &out[r][LOCAL];
+    if (in->valid) {
+      rx[r][rxupper[r]][rxlower[r]] = in->data;
+      if (rxcoreof[in->txcore][in->txslot] != r || rxslotof[in->txcore][in->txslot] != rxupper[r])
+        misrouted++;
+      if (in->written != UNCHANGED) {
+        // readable in the next cycle
+        unsigned int lat = cycle + 1 - in->written;
+        int t = in->txcore;
+        latmin[t][r] = (lat < latmin[t][r]) ? lat : latmin[t][r];
+        latmax[t][r] = (lat > latmax[t][r]) ? lat : latmax[t][r];
+        latsum[t][r] += lat;
+        latcount[t][r]++;
+      }
+      if (++rxupper[r] == TDMSLOTS) {
+        rxupper[r] = 0;
+        rxlower[r] = (rxlower[r] + 1) % WORDS;
+      }
+    }
+
+    // the router: each output register takes the scheduled input
+    for (int p = 0; p < PORTS; p++) {
+      int q = from[p];
+      if (q == IDLE) {
+        next[r][p].valid = false;
+        continue;
+      }
+      Flit *f = (q == LOCAL) ? &local : &out[neighbor[r][q]][q ^ 2];
+      next[r][p] = *f;
+      portflits[r][p] += f->valid;
+    }
+
+    // the NI reads the next word in the injecting cycles
+    rdvalid[r] = schedvalid[counter];
+    rdslot[r] = txupper[r];
+    rdword[r] = txlower[r];
+    if (rdvalid[r]) {
+      flits++;
+      if (++txupper[r] == TDMSLOTS) {
+        txupper[r] = 0;
+        txlower[r] = (txlower[r] + 1) % WORDS;
+      }
+    }
+  }
+
+  current = 1 - current;
+  delay = counter;
+  counter = (counter + 1 == schedlen) ? 0 : counter + 1;
+  cycle++;
+  cycles++;
+}
+
+void routerround(unsigned int start, const int *tx, int *rx) {
+  const int (*txmem)[TDMSLOTS][WORDS] = (const int (*)[TDMSLOTS][WORDS])tx;
+  int (*rxmem)[TDMSLOTS][WORDS] = (int (*)[TDMSLOTS][WORDS])rx;
+  int hyperperiod = WORDS * schedlen;
+  struct timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+
+  // Skipped rounds: the tx memory did not change, so after one round the
+  // flits and their valid pattern repeat each round. Only the first round
+  // is modeled, and its counts are added for the others.
+  if ((int)(start - cycle) >= hyperperiod) {
+    unsigned int skipped = (start - cycle) / hyperperiod;
+    unsigned long long before[CORES][PORTS];
+    memcpy(before, portflits, sizeof(before));
+    unsigned long long flitsbefore = flits;
+    for (int i = 0; i < hyperperiod; i++)
+      routercycle(txmem, rxmem, cycle);
+    for (int r = 0; r < CORES; r++)
+      for (int p = 0; p < PORTS; p++)
+        portflits[r][p] += (skipped - 1) * (portflits[r][p] - before[r][p]);
+    flits += (skipped - 1) * (flits - flitsbefore);
+    cycles += (unsigned long long)(skipped - 1) * hyperperiod;
+  }
+  cycle = start;
+
+  for (int i = 0; i < hyperperiod; i++)
+    routercycle(txmem, rxmem, start);
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  seconds += (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+void routerreport() {
+  printf("router model: %llu cycles, %llu flits, %.1f Mcycles/s, %llu misrouted flits\n",
+         cycles, flits, seconds > 0 ? cycles / seconds / 1e6 : 0.0, misrouted);
+  for (int r = 0; r < CORES; r++) {
+    printf("router model: router %2d output utilization n/e/s/w/l:", r);
+    for (int p = 0; p < PORTS; p++)
+      printf(" %3d%%", cycles > 0 ? (int)(portflits[r][p] * 100 / cycles) : 0);
+    printf("\n");
+  }
+  unsigned int min = UNCHANGED;
+  unsigned int max = 0;
+  unsigned long long sum = 0;
+  unsigned long long count = 0;
+  int over = 0;
+  for (int t = 0; t < CORES; t++) {
+    for (int r = 0; r < CORES; r++) {
+      if (latcount[t][r] == 0)
+        continue;
+      min = (latmin[t][r] < min) ? latmin[t][r] : min;
+      max = (latmax[t][r] > max) ? latmax[t][r] : max;
+      sum += latsum[t][r];
+      count += latcount[t][r];
+      if ((int)latmax[t][r] > getlatencybound(t, r)) {
+        if (over++ == 0)
+          printf("router model: core %d to core %d takes up to %u cycles, over the bound %d\n",
+                 t, r, latmax[t][r], getlatencybound(t, r));
+      }
+    }
+  }
+  if (count > 0)
+    printf("router model: write-to-rx latency %u..%u cycles (mean %.1f) for %llu words, %d core pairs over the bound\n",
+           min, max, (double)sum / count, count, over);
+}
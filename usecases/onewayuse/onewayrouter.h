@@ -0,0 +1,37 @@
+//onewayrouter.h
+#ifndef ONEWAYROUTER_H
+#define ONEWAYROUTER_H
+
+#include "onewaysim.h"
+
+// Flit-level model of OneWayMem for the PC simulator (SIMFLAGS="-D SIMROUTER"):
+// the torus of S4NOC routers of Network.scala, each moving the flits of its
+// five ports from one output register to the next per clock cycle as the
+// schedule of Schedule.getSchedule() says, and the NIs of Node.scala, which
+// read the tx memory with one cycle delay in the slots where the schedule
+// injects, and write the rx memory at the rx address counter. The schedule
+// is parsed from ROUTESSTRING like getSchedule() does. An output that no route
+// uses in a cycle gets an invalid flit. Router.scala instead connects it to
+// input port 0 (north), the default of the schedule table, which is modeled
+// with SIMFLAGS="-D SIMROUTER -D SIMROUTERNORTH": on 2x2 nodes this makes no
+// difference, on larger grids it copies the flits that come in from north to
+// the unused outputs, and these copies end up in the rx memories.
+//
+// Next to the data, the model tracks for each flit the tx core and tx slot,
+// and whether it carries a word that changed since the NI read it the last
+// time. So it counts the flits that end up in another rx slot than the
+// simulator routes them to, the write-to-rx latency of the changed words for
+// each core pair, and the valid flits on each router output.
+
+// reset the routers and NIs (the memories are not touched)
+void routerreset();
+
+// run the cycles of one round that starts at the NoC cycle start: the NIs
+// read tx [CORES][TDMSLOTS][WORDS] and write rx; rounds that were skipped
+// since the previous call are caught up
+void routerround(unsigned int start, const int *tx, int *rx);
+
+// print the cycles, utilization, latencies, and misrouted flits
+void routerreport();
+
+#endif
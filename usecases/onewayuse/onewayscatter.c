@@ -0,0 +1,192 @@
+//onewayscatter.c
+#include "onewayscatter.h"
+#include "onewaylatency.h"
+
+int getscattertilewords(int unitwords) {
+  return (SCATTERITEMMAX / unitwords) * unitwords;
+}
+
+int getscattertiles(const ScatterJob *job) {
+  return (job->inwords + job->tilewords - 1) / job->tilewords;
+}
+
+// the slot from core to othercore (tx) and from othercore to core (rx)
+static volatile _SPM int *scattertx(int cpuid, int othercore) {
+  return core[cpuid].tx[gettxslotfromtxcorerxcoreslot(cpuid, othercore, -1)];
+}
+
+static int scatterrxslot(int cpuid, int othercore) {
+  return getrxslotfromrxcoretxcoreslot(cpuid, othercore,
+                                       gettxslotfromtxcorerxcoreslot(othercore, cpuid, -1));
+}
+
+static volatile _SPM int *scatterrx(int cpuid, int othercore) {
+  return core[cpuid].rx[scatterrxslot(cpuid, othercore)];
+}
+
+// the other cores of the cluster of the master
+static int scatterworker(int master, int i) {
+  int base = master - master % CLUSTERCORES;
+  return base + (master - base + 1 + i) % CLUSTERCORES;
+}
+
+// first word of the buffer for sequence number seq
+static int scatterbuf(unsigned int seq) {
+  return 1 + ((seq - 1) % DOUBLEBUFFERS) * SCATTERBUFWORDS;
+}
+
+void scatterinit(Scatter *sc, int cpuid, int master) {
+  sc->cpuid = cpuid;
+  sc->master = master;
+  for (int c = 0; c < CORES; c++) {
+    sc->txseq[c] = 0;
+    sc->rxseq[c] = 0;
+    sc->rxsettle[c] = 0;
+    sc->ended[c] = false;
+  }
+  if (cpuid == master) {
+    for (int i = 0; i < CLUSTERCORES - 1; i++)
+      scattertx(cpuid, scatterworker(master, i))[SCATTERACK] = 0;
+  } else {
+    scattertx(cpuid, master)[SCATTERACK] = 0;
+  }
+  sc->nexttile = 0;
+  sc->computing = false;
+  sc->tile = -1;
+  sc->resultwords = 0;
+  sc->readytime = 0;
+  sc->tiles = 0;
+  // a core outside the cluster of the master has no work
+  sc->done = (cpuid / CLUSTERCORES != master / CLUSTERCORES);
+}
+
+// a buffer to othercore is free
+static bool scatterfree(Scatter *sc, int othercore) {
+  unsigned int ack = scatterrx(sc->cpuid, othercore)[SCATTERACK];
+  return sc->txseq[othercore] + 1 - ack <= DOUBLEBUFFERS;
+}
+
+// write a tile or a result to othercore, the words and the tail first and
+// the head last (othercore takes it when it has settled)
+static void scatterpass(Scatter *sc, int othercore, int tile, const int *words, int n) {
+  unsigned int seq = sc->txseq[othercore] + 1;
+  volatile _SPM int *buf = scattertx(sc->cpuid, othercore) + scatterbuf(seq);
+  buf[SCATTERTAIL] = seq;
+  buf[SCATTERTILE] = tile;
+  buf[SCATTERLENGTH] = n;
+  for (int k = 0; k < n; k++)
+    buf[SCATTERLENGTH + 1 + k] = words[k];
+  buf[SCATTERHEAD] = seq;
+  sc->txseq[othercore] = seq;
+}
+
+// the next tile or result from othercore has arrived and settled: its
+// index, length, and words
+static bool scattertake(Scatter *sc, int othercore, int *tile, int *words, int *n) {
+  unsigned int seq = sc->rxseq[othercore] + 1;
+  volatile _SPM int *buf = scatterrx(sc->cpuid, othercore) + scatterbuf(seq);
+  if ((unsigned int)buf[SCATTERHEAD] != seq || (unsigned int)buf[SCATTERTAIL] != seq)
+    return false;
+  if (!bufsettled(&sc->rxsettle[othercore]))
+    return false;
+  sc->rxsettle[othercore] = 0;
+  *tile = buf[SCATTERTILE];
+  *n = buf[SCATTERLENGTH];
+  *n = (*n > SCATTERITEMMAX) ? SCATTERITEMMAX : *n;
+  for (int k = 0; k < *n; k++)
+    words[k] = buf[SCATTERLENGTH + 1 + k];
+  sc->rxseq[othercore] = seq;
+  // credit back
+  scattertx(sc->cpuid, othercore)[SCATTERACK] = seq;
+  return true;
+}
+
+// gather the results that have arrived and scatter the next tiles, and the
+// end to each worker once all tiles are out
+static void scattermaster(Scatter *sc, const ScatterJob *job) {
+  int words[SCATTERITEMMAX];
+  int tiles = getscattertiles(job);
+  bool allended = true;
+  for (int i = 0; i < CLUSTERCORES - 1; i++) {
+    int w = scatterworker(sc->master, i);
+    int tile;
+    int n;
+    while (scattertake(sc, w, &tile, words, &n)) {
+      if (tile >= 0 && tile < tiles && n <= job->outwords) {
+        for (int k = 0; k < n; k++)
+          job->out[tile * job->outwords + k] = words[k];
+        sc->tiles++;
+      }
+    }
+    while (sc->nexttile < tiles && scatterfree(sc, w)) {
+      int first = sc->nexttile * job->tilewords;
+      int n = job->inwords - first;
+      n = (n < job->tilewords) ? n : job->tilewords;
+      scatterpass(sc, w, sc->nexttile, job->in + first, n);
+      sc->nexttile++;
+    }
+    if (sc->nexttile == tiles && !sc->ended[w] && scatterfree(sc, w)) {
+      scatterpass(sc, w, -1, words, -1);
+      sc->ended[w] = true;
+    }
+    allended = allended && sc->ended[w];
+  }
+  sc->done = allended && sc->tiles == tiles;
+}
+
+// pass the result on when it is ready, then take and compute the next tile
+static void scatterworkerstep(Scatter *sc, const ScatterJob *job) {
+  int words[SCATTERITEMMAX];
+  if (sc->computing) {
+    if ((int)(getnoccycles() - sc->readytime) < 0 || !scatterfree(sc, sc->master))
+      return;
+    scatterpass(sc, sc->master, sc->tile, sc->result, sc->resultwords);
+    sc->computing = false;
+    sc->tiles++;
+  }
+  int n;
+  if (!scattertake(sc, sc->master, &sc->tile, words, &n))
+    return;
+  if (n < 0) {
+    sc->done = true;
+    return;
+  }
+  sc->resultwords = job->kernel(words, n, sc->result);
+  sc->readytime = getnoccycles() + job->cycles * n;
+  sc->computing = true;
+}
+
+bool scatterstep(Scatter *sc, const ScatterJob *job) {
+  if (sc->done)
+    return true;
+  if (sc->cpuid == sc->master)
+    scattermaster(sc, job);
+  else
+    scatterworkerstep(sc, job);
+  return sc->done;
+}
+
+void scatterwait(Scatter *sc) {
+  if (sc->done)
+    return;
+  if (sc->cpuid == sc->master) {
+    for (int i = 0; i < CLUSTERCORES - 1; i++) {
+      int w = scatterworker(sc->master, i);
+      int rxslot = scatterrxslot(sc->cpuid, w);
+      waitrx(sc->cpuid, rxslot, scatterbuf(sc->rxseq[w] + 1) + SCATTERHEAD);
+      waitrx(sc->cpuid, rxslot, SCATTERACK);
+      if (sc->rxsettle[w] != 0)
+        waitnoccycles(sc->cpuid, sc->rxsettle[w]);
+    }
+  } else if (sc->computing && (int)(getnoccycles() - sc->readytime) < 0) {
+    waitnoccycles(sc->cpuid, sc->readytime);
+  } else {
+    int rxslot = scatterrxslot(sc->cpuid, sc->master);
+    waitrx(sc->cpuid, rxslot, SCATTERACK);
+    if (!sc->computing) {
+      waitrx(sc->cpuid, rxslot, scatterbuf(sc->rxseq[sc->master] + 1) + SCATTERHEAD);
+      if (sc->rxsettle[sc->master] != 0)
+        waitnoccycles(sc->cpuid, sc->rxsettle[sc->master]);
+    }
+  }
+}
@@ -0,0 +1,96 @@
+//onewayscatter.h
+#ifndef ONEWAYSCATTER_H
+#define ONEWAYSCATTER_H
+
+#include "onewaysim.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// An array computation spread over the cores of a cluster. The master core
+// cuts its input array into tiles that fit into a buffer of a slot and
+// scatters them to the other cores (the workers), each worker computes the
+// result of a tile with the kernel of the job, and the master gathers the
+// results into its output array at the place of their tile. The master
+// gives the next tile to any worker with a free buffer, so faster workers
+// get more tiles.
+//
+// The streams between the master and a worker are those of use-case 6 and
+// onewaydataflow.h: DOUBLEBUFFERS buffers of SCATTERBUFWORDS words after the
+// credit word, each with the head and tail sequence numbers around the tile
+// index, the length, and the words, and a tile or result is taken one
+// hyperperiod after its head and tail show up, as the NI can send the words
+// of one write over two hyperperiods (see bufsettled in onewaylatency.h). So
+// the next tiles of a worker move over the NoC while it computes. A worker takes a tile, computes its result, and
+// passes the result on when the modeled compute time (the cycles per input
+// word of the job) has passed. A tile of length -1 ends the work of a worker.
+
+#define SCATTERACK 0
+#define SCATTERBUFWORDS ((WORDS - 1) / DOUBLEBUFFERS)
+// tile words: head, tile index, length, words, tail
+#define SCATTERHEAD 0
+#define SCATTERTILE 1
+#define SCATTERLENGTH 2
+#define SCATTERTAIL (SCATTERBUFWORDS - 1)
+#define SCATTERITEMMAX (SCATTERBUFWORDS - 4)
+
+// the result of the n words of a tile into out, returns the result words
+typedef int (*ScatterKernel)(const int *in, int n, int *out);
+
+typedef struct ScatterJob {
+  // input and output array of the master
+  const int *in;
+  int *out;
+  int inwords;
+  // input words of a tile and result words of a full tile
+  int tilewords;
+  int outwords;
+  ScatterKernel kernel;
+  // modeled cpu cycles of the kernel per input word
+  unsigned int cycles;
+} ScatterJob;
+
+// the largest tile of whole units of unitwords that fits into a buffer
+int getscattertilewords(int unitwords);
+// the tiles of a job
+int getscattertiles(const ScatterJob *job);
+
+typedef struct Scatter {
+  int cpuid;
+  int master;
+  // the streams to and from each core (the master for a worker)
+  unsigned int txseq[CORES];
+  unsigned int rxseq[CORES];
+  // noc cycle when the next tile or result from each core is whole (see
+  // bufsettled)
+  unsigned int rxsettle[CORES];
+  // master: the next tile and the workers that have their end
+  int nexttile;
+  bool ended[CORES];
+  // worker: the result of the tile it computes and the noc cycle when it is
+  // ready
+  bool computing;
+  int tile;
+  int resultwords;
+  int result[SCATTERITEMMAX];
+  unsigned int readytime;
+  // tiles computed (worker) or gathered (master), and the end is through
+  int tiles;
+  bool done;
+} Scatter;
+
+// the scatter state of core, also clears its credits
+void scatterinit(Scatter *sc, int cpuid, int master);
+
+// one loop of the master or a worker, returns true when it is done
+bool scatterstep(Scatter *sc, const ScatterJob *job);
+
+// wait hints for a core that is not done
+void scatterwait(Scatter *sc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
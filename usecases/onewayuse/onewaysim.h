@@ -15,6 +15,7 @@
 #include <stdbool.h>
 #include <stdarg.h>
 #include <string.h>
+#include <limits.h>
 #ifndef RUNONPATMOS
 #include <time.h>
 #endif
@@ -26,13 +27,65 @@
   #define RUNONPATMOS
 #endif
 
+// the backend in onewaymem-verilator.cpp is C++
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// RUNONPOSIX is set by 'make posix': each core is a Linux process, see
+// onewaymem-posix.c. Data that the cores share in main memory on patmos
+// (_UNCACHED and _SHARED) is placed in the onewayshared section, which is
+// mapped shared between the core processes.
+//
+// RUNINSWEEP is set by 'make psweep': each configuration is built as a shared
+// library and each sweep thread simulates its own NoC with it, see
+// onewaymem-psweep.c. The simulator globals (_SIMLOCAL and _SHARED) are then
+// thread local, and sweepprintf() writes to the log of the thread.
+//
+// SIMSNAPSHOT is set for the simulator on the PC (onewaymem-simulator.c):
+// the simulator globals (_SIMLOCAL and _SHARED) are placed in the onewaysim
+// section, which a snapshot saves to a file and a restore maps back. The
+// data that the cores share on patmos (_UNCACHED) is in the onewayuncached
+// section, which a snapshot saves as well and a trace records.
+#if !defined(RUNONPATMOS) && !defined(RUNONPOSIX) && !defined(RUNINSWEEP) && !defined(RUNONVERILATOR)
+  #define SIMSNAPSHOT
+#endif
+#ifdef RUNONPOSIX
+  #define _SHARED __attribute__((section("onewayshared")))
+#elif defined(RUNINSWEEP)
+  #define _SHARED _Thread_local
+#elif defined(SIMSNAPSHOT)
+  #define _SHARED __attribute__((section("onewaysim")))
+#else
+  #define _SHARED
+#endif
+#ifdef RUNINSWEEP
+  #define _SIMLOCAL _Thread_local
+#elif defined(SIMSNAPSHOT)
+  #define _SIMLOCAL _SHARED
+#else
+  #define _SIMLOCAL
+#endif
+
+// the prints of a use-case run (the sync prints, the results) go to the log
+// of the sweep thread with RUNINSWEEP, and to stdout otherwise
+#ifdef RUNINSWEEP
+  int sweepprintf(const char *format, ...);
+#else
+  #define sweepprintf printf
+#endif
+
 #ifdef RUNONPATMOS
   #include "libcorethread/corethread.h"
 #else
   // define as nothing when just simulating on the PC
   #define _SPM
   #define _IODEV
-  #define _UNCACHED
+  #ifdef SIMSNAPSHOT
+    #define _UNCACHED __attribute__((section("onewayuncached")))
+  #else
+    #define _UNCACHED _SHARED
+  #endif
   #include <sched.h>
 #endif
 
@@ -44,29 +97,328 @@
 "   el|"
 #define FOURNODES_N 4
 
+#define NINENODES "nel|"\
+" nwl|"\
+"  esl|"\
+"   wsl|"\
+"     nl|"\
+"      el|"\
+"       sl|"\
+"        wl|"
+#define NINENODES_N 9
+
+#define SIXTEENNODES "nneel|"\
+" esl|"\
+"   neel|"\
+"    nnel|"\
+"     wnnl|"\
+"       eesl|"\
+"        nl|"\
+"         nel|"\
+"          nwl|"\
+"           nnl|"\
+"            eel|"\
+"             swl|"\
+"               el|"\
+"                sl|"\
+"                 wl|"
+#define SIXTEENNODES_N 16
+
+// 5x5, schedule length 27, from onewaymem-schedule.c -i 200000 5 5
+#define TWENTYFIVENODES "wsl|"\
+" enel|"\
+"  wl|"\
+"   swsl|"\
+"    nl|"\
+"     nnl|"\
+"      wwl|"\
+"       swwl|"\
+"        sl|"\
+"         nel|"\
+"          nwl|"\
+"           sseel|"\
+"            el|"\
+"             wwnl|"\
+"              sswwl|"\
+"               eel|"\
+"                nneel|"\
+"                 esl|"\
+"                  nnel|"\
+"                   wnnl|"\
+"                    wwnnl|"\
+"                     ssl|"\
+"                      esel|"\
+"                       essl|"
+#define TWENTYFIVENODES_N 25
+
+// 6x6, schedule length 39, from onewaymem-schedule.c -i 200000 6 6
+#define THIRTYSIXNODES "sssl|"\
+" eenel|"\
+"  neneel|"\
+"   sl|"\
+"    sswsl|"\
+"     wl|"\
+"      nnwwl|"\
+"       esl|"\
+"        esssel|"\
+"         eeel|"\
+"          nl|"\
+"           wssl|"\
+"            nwnl|"\
+"             esel|"\
+"              enel|"\
+"               wwsl|"\
+"                sessl|"\
+"                 nnl|"\
+"                  eeessl|"\
+"                   wsl|"\
+"                    nel|"\
+"                     wwsssl|"\
+"                      eel|"\
+"                       wwl|"\
+"                        eesssel|"\
+"                         nnel|"\
+"                          el|"\
+"                           wnl|"\
+"                            essl|"\
+"                             wwnl|"\
+"                              eennl|"\
+"                               ssl|"\
+"                                eessl|"\
+"                                 seeel|"\
+"                                  wwssl|"
+#define THIRTYSIXNODES_N 36
+
+// 7x7, schedule length 52, from onewaymem-schedule.c -i 200000 7 7
+#define FORTYNINENODES "wnnnl|"\
+" swswl|"\
+"  sl|"\
+"   esesel|"\
+"    nwl|"\
+"     swl|"\
+"      essl|"\
+"       wwssswl|"\
+"        eel|"\
+"         wnwnwl|"\
+"          el|"\
+"           nl|"\
+"            ssswwl|"\
+"             nwnnwwl|"\
+"              esl|"\
+"               esel|"\
+"                essel|"\
+"                 nennl|"\
+"                  nwwwl|"\
+"                   ssswl|"\
+"                    enenel|"\
+"                     enel|"\
+"                      sswwwl|"\
+"                       wnnl|"\
+"                        sseesl|"\
+"                         ennneel|"\
+"                          ssl|"\
+"                           wwwl|"\
+"                            ennnel|"\
+"                             swwl|"\
+"                              sesseel|"\
+"                               swwwl|"\
+"                                nnl|"\
+"                                 esssl|"\
+"                                  nwnwl|"\
+"                                   neeel|"\
+"                                     nnnl|"\
+"                                      seeel|"\
+"                                       wwl|"\
+"                                        sswl|"\
+"                                         nneel|"\
+"                                          enl|"\
+"                                           sssl|"\
+"                                            wnnnwl|"\
+"                                             eeel|"\
+"                                              wl|"\
+"                                               wnwl|"\
+"                                                ennl|"
+#define FORTYNINENODES_N 49
+
+// 8x8, schedule length 82, from onewaymem-schedule.c -i 200000 8 8
+#define SIXTYFOURNODES "sseesseel|"\
+" enneel|"\
+"  sswwsswl|"\
+"   wl|"\
+"    nl|"\
+"     nwl|"\
+"      nwnnl|"\
+"       neenneel|"\
+"        sseessel|"\
+"         wwwl|"\
+"          sl|"\
+"           swl|"\
+"            nwwwl|"\
+"             nnnel|"\
+"              ssssel|"\
+"               enel|"\
+"                wnnwwl|"\
+"                 wwnl|"\
+"                  ssssl|"\
+"                   eeesel|"\
+"                    nnnwwwl|"\
+"                     wwl|"\
+"                      eseeesl|"\
+"                       nnl|"\
+"                        sssl|"\
+"                         nneeeel|"\
+"                          wwsl|"\
+"                           nnnl|"\
+"                            wsswl|"\
+"                             wnnnwl|"\
+"                              wssssl|"\
+"                               eel|"\
+"                                wnnwl|"\
+"                                 eeeel|"\
+"                                  wswswl|"\
+"                                   nnneeel|"\
+"                                    sel|"\
+"                                     wnnl|"\
+"                                      sswsl|"\
+"                                       wswwl|"\
+"                                         eeel|"\
+"                                          swsl|"\
+"                                           seel|"\
+"                                            nneel|"\
+"                                             ssl|"\
+"                                              wsswsl|"\
+"                                               nnel|"\
+"                                                el|"\
+"                                                 sessel|"\
+"                                                  nel|"\
+"                                                   nnneel|"\
+"                                                    essl|"\
+"                                                      wsswwsl|"\
+"                                                       neeel|"\
+"                                                         sseel|"\
+"                                                            seeel|"\
+"                                                             sssel|"\
+"                                                              wwssssl|"\
+"                                                                neeeel|"\
+"                                                                    sseeel|"\
+"                                                                     essseel|"\
+"                                                                         ssseeeel|"\
+"                                                                           essssel|"
+#define SIXTYFOURNODES_N 64
+
 // do edit this to set up the NoC grid and buffer
+// (or override NOCNODES, CLUSTERS, WORDS, and DOUBLEBUFFERS with -D, as 'make sweep' does)
+// the grid has GRIDROWS x GRIDCOLS cores, numbered row by row
+// with CLUSTERS > 1, there are CLUSTERS such grids (one NoC each) of
+// CLUSTERCORES cores, numbered cluster by cluster, which exchange words only
+// through the gateway cores of onewaycluster.h
+#ifndef NOCNODES
+#define NOCNODES 4
+#endif
+#ifndef CLUSTERS
+#define CLUSTERS 1
+#endif
+#if defined(GENERATEDROUTESFILE)
+// the schedule that 'make schedule rows=R cols=C' wrote (onewaymem-schedule.c),
+// named in full, e.g., -D GENERATEDROUTESFILE=\"onewayroutes-3x5.h\", so that
+// no header that an older schedule left behind is taken instead
+#include GENERATEDROUTESFILE
+#define ROUTESSTRING GENERATEDNODES
+#define CLUSTERCORES (GENERATEDROWS * GENERATEDCOLS)
+#define TDMSLOTS GENERATEDSLOTS
+#define GRIDROWS GENERATEDROWS
+#define GRIDCOLS GENERATEDCOLS
+#elif defined(GENERATEDROUTES)
+#error "name the header of 'make schedule' with -D GENERATEDROUTESFILE, see README.md"
+#elif NOCNODES == 64
+#define ROUTESSTRING SIXTYFOURNODES
+#define CLUSTERCORES SIXTYFOURNODES_N
+#define GRIDROWS 8
+#define GRIDCOLS 8
+#elif NOCNODES == 49
+#define ROUTESSTRING FORTYNINENODES
+#define CLUSTERCORES FORTYNINENODES_N
+#define GRIDROWS 7
+#define GRIDCOLS 7
+#elif NOCNODES == 36
+#define ROUTESSTRING THIRTYSIXNODES
+#define CLUSTERCORES THIRTYSIXNODES_N
+#define GRIDROWS 6
+#define GRIDCOLS 6
+#elif NOCNODES == 25
+#define ROUTESSTRING TWENTYFIVENODES
+#define CLUSTERCORES TWENTYFIVENODES_N
+#define GRIDROWS 5
+#define GRIDCOLS 5
+#elif NOCNODES == 16
+#define ROUTESSTRING SIXTEENNODES
+#define CLUSTERCORES SIXTEENNODES_N
+#define GRIDROWS 4
+#define GRIDCOLS 4
+#elif NOCNODES == 9
+#define ROUTESSTRING NINENODES
+#define CLUSTERCORES NINENODES_N
+#define GRIDROWS 3
+#define GRIDCOLS 3
+#else
 #define ROUTESSTRING FOURNODES
-#define CORES FOURNODES_N
+#define CLUSTERCORES FOURNODES_N
+#define GRIDROWS 2
+#define GRIDCOLS 2
+#endif
+#define CORES (CLUSTERS * CLUSTERCORES)
+#if CLUSTERS > 1 && (defined(RUNONPATMOS) || defined(RUNONVERILATOR) || defined(SIMROUTER))
+#error "CLUSTERS > 1 runs only on the simulator with instant copy and on the posix backend"
+#endif
 //#define MEMBUF 256
 //#define WORDS MEMBUF 
+#ifndef WORDS
 #define WORDS 256 
+#endif
 
 // do not edit
-// grid side size 
-#define GRIDN ((int)sqrt(CORES))
-// one core configuration
-#define TDMSLOTS (CORES - 1)
+// one core configuration: a tx and an rx slot for each route, one for each
+// other core of the cluster unless a weighted schedule gives some core pairs
+// more slots
+#ifndef TDMSLOTS
+#define TDMSLOTS (CLUSTERCORES - 1)
+#endif
+// the most slots of one core pair
+#define PAIRSLOTSMAX (TDMSLOTS - CLUSTERCORES + 2)
+// NI pipeline cycles: two for the tx memory read and one for the rx memory write
+#define NIDELAY 3
+
+// per core data that different cores write in their loops is kept in its own
+// cache line(s), so cores running as host threads (or on a cache-coherent
+// target) do not share lines; a multiple of the line size of the PC and patmos
+#define CACHELINE 64
+#define CACHEALIGNED __attribute__((aligned(CACHELINE)))
+
+// start and done flags of one core
+typedef struct CoreFlags {
+  bool ready;
+  bool done;
+} CACHEALIGNED CoreFlags;
+
+// sync_printf message counter of one core in its own cache line
+typedef struct PrintCursor {
+  int mi;
+} CACHEALIGNED PrintCursor;
 
 // patmos hardware registers provided via Scala HDL
-volatile _UNCACHED bool runcores;
-volatile _UNCACHED bool coreready[CORES];
-volatile _UNCACHED bool coredone[CORES];
+extern volatile _UNCACHED bool runcores;
+extern volatile _UNCACHED CoreFlags coreflags[CORES];
+#if defined(RUNONPOSIX) || defined(RUNINSWEEP) || defined(SIMSNAPSHOT)
+// a section (or thread local) can only be set on the registers, not on their type
+typedef volatile unsigned int PATMOS_REGISTER;
+#else
 typedef volatile _UNCACHED unsigned int PATMOS_REGISTER;
+#endif
 
 // one word delivered from all to all
-PATMOS_REGISTER TDMROUND_REGISTER;
+extern _SHARED PATMOS_REGISTER TDMROUND_REGISTER;
 // one memory block delivered (word for word) from all to all
-PATMOS_REGISTER HYPERPERIOD_REGISTER;
+extern _SHARED PATMOS_REGISTER HYPERPERIOD_REGISTER;
 
 // shared common simulation structs
 typedef struct Core
@@ -85,7 +437,22 @@ typedef struct Core
 } Core;
 
 // declare noc consisting of cores
-extern Core core[CORES];
+extern _SIMLOCAL Core core[CORES];
+
+// the slots of a core pair as one channel of slots * WORDS words: word w is
+// in tx[w / WORDS] of the tx core and in rx[w / WORDS] of the rx core. With
+// a weighted schedule, a pair can have more than one slot.
+typedef struct Channel {
+  int slots;
+  int txslot[PAIRSLOTSMAX];
+  int rxslot[PAIRSLOTSMAX];
+  volatile _SPM int *tx[PAIRSLOTSMAX];
+  volatile _SPM int *rx[PAIRSLOTSMAX];
+} Channel;
+
+#define CHANNELWORDS(ch) ((ch)->slots * WORDS)
+#define CHANNELTX(ch, w) ((ch)->tx[(w) / WORDS][(w) % WORDS])
+#define CHANNELRX(ch, w) ((ch)->rx[(w) / WORDS][(w) % WORDS])
 
 // a struct for the handshake push message
 #define HANDSHAKEMSGSIZE 8
@@ -139,7 +506,9 @@ typedef struct es_msg_t
 
 // how many ("double") buffers overlaid on each core's tx/rx buffer (of size WORDS) 
 // 2, 4, 8, ...
+#ifndef DOUBLEBUFFERS
 #define DOUBLEBUFFERS 2
+#endif
 #define DBUFSIZE WORDS/DOUBLEBUFFERS
 // a struct for one buffer
 typedef struct buffer_t
@@ -149,66 +518,158 @@ typedef struct buffer_t
   volatile _SPM int *data;
 } buffer_t;
 
+// streaming throughput: word 0 of each slot carries the rx side's credit (the
+// last consumed sequence number) back to the tx side, the other words hold
+// DOUBLEBUFFERS buffers with the sequence number in their first and last word
+#define STREAMACKWORD 0
+#define STREAMBUFSIZE ((WORDS - 1) / DOUBLEBUFFERS)
+#define STREAMPAYLOAD (STREAMBUFSIZE - 2)
+// buffers streamed from each core to each other core
+#define STREAMBUFFERS 32
+
+// all-pairs latency: samples per (tx core, rx core) pair and the watched word
+#define LATSAMPLES 64
+#define LATWORD 0
+
+// cluster routes: words of each route and latency samples per route
+#define CLUSTERWORDS 8
+#define CLUSTERSAMPLES 32
+
+// multicast: the root core, the tree (see onewaymulticast.h), the words of
+// the message, and latency samples per core
+#define MULTICASTROOT 1
+#ifndef MULTICASTPOLICY
+#define MULTICASTPOLICY 1
+#endif
+#ifndef MULTICASTFANOUT
+#define MULTICASTFANOUT 2
+#endif
+#define MULTICASTWORDS 3
+#define MULTICASTSAMPLES 32
+
+// inbox: words of each message slot (see onewayinbox.h), messages from each
+// producer, and the aggregator polls each rx slot (1) or uses the inbox (0)
+#ifndef INBOXWORDS
+#define INBOXWORDS 8
+#endif
+#define INBOXMESSAGES 32
+#ifndef INBOXPOLL
+#define INBOXPOLL 0
+#endif
+
+// codec: words of the slot region and of the state published over it (see
+// onewaycodec.h), delta size in percent of the region that starts a new
+// keyframe, state updates per channel, and words changed per update
+#ifndef CODECWORDS
+#define CODECWORDS 64
+#endif
+#ifndef CODECSTATE
+#define CODECSTATE (4 * CODECWORDS)
+#endif
+#define CODECREKEY 50
+#define CODECUPDATES 256
+#define CODECCHANGES 2
+
+// dataflow: stages of a pipeline (see onewaydataflow.h), words of the
+// accumulator of a stage, items of the source and their words, and the
+// distance of the cores of two stages
+#define DATAFLOWSTAGESMAX 8
+#define DATAFLOWACC 4
+#define DATAFLOWITEMS 128
+#define DATAFLOWITEMWORDS 8
+#ifndef DATAFLOWSTRIDE
+#define DATAFLOWSTRIDE 1
+#endif
+
+// scatter/gather: the master core, the matrix of the matrix-vector product
+// (see onewayscatter.h, a row fits into a buffer of a slot), and the modeled
+// cpu cycles per multiply-add
+#define SCATTERMASTER 0
+#define SCATTERROWS 256
+#if (WORDS - 1) / DOUBLEBUFFERS - 4 < 16
+#define SCATTERCOLS ((WORDS - 1) / DOUBLEBUFFERS - 4)
+#else
+#define SCATTERCOLS 16
+#endif
+#ifndef SCATTERMACCYCLES
+#define SCATTERMACCYCLES 64
+#endif
+
+// typed channels (onewaychannel.hpp, use-case 13 in C++ with 'make
+// channels'): the items of the ring channel and its depth
+#define CHANNELITEMS 256
+#define CHANNELDEPTH 4
+
+// wait hints: the events of use-case 14
+#define HINTEVENTS 30
+
 // state that can be shared
 typedef struct State {
   // State common to any use-case
   int state;
   // loop counter for control loop
   int loopcount;
+  // NoC cycles at the first loop (for the timeout)
+  unsigned int starttime;
   // when the core is running (not in the final waiting state)
   bool corerunning;
   // when the core is just spinning in the last waiting state
   bool coredone;
   // the global flag (mirroed locally)
   bool runcore;
-  // Local state per use-case as needed
-#if USECASE==0
-  // ...
+  // local state of the running use-case (allocated from the per core state arena)
+  void *local;
+} CACHEALIGNED State;
 
-#elif USECASE==1
-  // ...
+//#ifndef RUNONPATMOS
+extern _SHARED State states[CORES];
+//#endif
 
-#elif USECASE==2
-  unsigned int step;
-  unsigned int txcnt;
-  unsigned int hyperperiod;
-  unsigned int starttime;
-  unsigned int endtime;
-  unsigned int blockno;
-  // set up the use case so all cores will send a handshake message to the other cores
-  // and receive the appropriate acknowledgement
-  handshakemsg_t hmsg_out[TDMSLOTS];
-  handshakemsg_t hmsg_in[TDMSLOTS];
-  handshakeack_t hmsg_ack_out[TDMSLOTS];
-  handshakeack_t hmsg_ack_in[TDMSLOTS];
-  unsigned int prevhyperperiod[TDMSLOTS];
-
-#elif USECASE==3
-  int txcnt;
-  es_msg_t esmsg_out;
-  es_msg_t esmsg_in[TDMSLOTS];
-
-#elif USECASE==4
-  int txcnt;
-  int roundstate;
-  unsigned int starttime;
-  unsigned int endtime;
-  // double buffers on tx
-  buffer_t buf_out[TDMSLOTS][DOUBLEBUFFERS];
-  // double buffers on rx
-  buffer_t buf_in[TDMSLOTS][DOUBLEBUFFERS];
+// a use-case registers its core function and the size of its local state
+typedef struct UseCase
+{
+  int id;
+  const char *name;
+  // the core function called by each core (see noccontrol and nocstart)
+  void (*corefunc)(void *);
+  // bytes of local state for each core (State.local)
+  int localsize;
+  // words used from the start of each tx/rx slot (WORDS for the whole slot),
+  //   use-cases that fit together in a slot can run at once on one NoC
+  int slotwords;
+} UseCase;
+
+// the registered use-cases (one per onewaymem-usecase<id>.c)
+extern const UseCase usecase0, usecase1, usecase2, usecase3, usecase4, usecase5, usecase6, usecase7,
+  usecase8, usecase9, usecase10, usecase11, usecase12, usecase14;
+// use-case 13 is C++ (onewaymem-usecase13.cpp) and only in the simulator
+// of 'make channels', which defines ONEWAYCHANNELS
+#ifdef ONEWAYCHANNELS
+extern const UseCase usecase13;
+#define NUSECASES 15
+#else
+#define NUSECASES 14
 #endif
-} State;
+extern const UseCase *usecases[];
 
-//#ifndef RUNONPATMOS
-  State states[CORES];
-//#endif
+// get a registered use-case by id (NULL if there is none)
+const UseCase *getusecase(int id);
+
+// bytes in the state arena of each core, which holds the local state of the
+// use-cases that run at once
+#define STATEARENASIZE (1024 + 512 * TDMSLOTS)
+// allocate zeroed local state from the state arena of core cpuid (NULL if full)
+void *statealloc(int cpuid, int size);
+// free all local state of all cores
+void statearenareset();
+// clear the common state and allocate the local state of a use-case for all cores
+bool usecasestatesinit(const UseCase *usecase);
 
 // init patmos (simulated) internals
-Core core[CORES];
+extern _SIMLOCAL Core core[CORES];
 // signal used to stop terminate the cores
 
-int coreid[CORES];
+extern _SIMLOCAL int coreid[CORES];
 
 void nocinit();
 void nocstart();
@@ -227,20 +688,26 @@ void corethreadtbswork(void *cidptr);
 void corethreadhswork(void *noarg);
 void corethreadeswork(void *noarg);
 void corethreadsdbwork(void *noarg);
+void corethreadlatwork(void *noarg);
+void corethreadstrwork(void *noarg);
 
 // uses the router string (e.g., "nel, nl, el", ...)
 // to generate the mappings that rxcorefromtxcoreslot and 
 // txcorefromrxcoreslot use.
 void txrxmapsinit();
 
-// get tx slot from txcore, rxcore, and rxslot
+// get tx slot from txcore, rxcore, and rxslot (the first slot of the pair
+// when rxslot is not one of its slots)
 int gettxslotfromtxcorerxcoreslot(int txcore, int rxcore, int rxslot);
-// get rx slot from rxcore, txcore, and txslot
+// get rx slot from rxcore, txcore, and txslot (the first slot of the pair
+// when txslot is not one of its slots)
 int getrxslotfromrxcoretxcoreslot(int rxcore, int txcore, int txslot);
 // get the rx core based on tx core and tx (TDM) slot index
 int getrxcorefromtxcoreslot(int txcore, int txslot);
 // get the tx core based on tx core and rx (TDM) slot index
 int gettxcorefromrxcoreslot(int rxcore, int rxslot);
+// the channel of all slots from txcore to rxcore
+void channelinit(Channel *ch, int txcore, int rxcore);
 
 #ifndef RUNONPATMOS
 int get_cpuid();
@@ -250,6 +717,14 @@ int get_cpuid();
 void initroutestrings();
 void showmappings();
 
+// schedule timing derived from the route string
+int getschedulelength();
+int getroutehops(int txslot);
+int getrouteinject(int txslot);
+int gethyperperiodcycles();
+// worst-case write-to-visible latency in cycles from tx core to rx core
+int getlatencybound(int txcore, int rxcore);
+
 void recordhyperperiodwork(int cpuid, unsigned int* hyperperiods);
 void holdandgowork(int cpuid);
 bool alldone(int cpuid);
@@ -257,18 +732,86 @@ const char* allfinishedok();
 void spinwork(unsigned int waitcycles);
 void statework(State **state, int cpuid);
 void defaultstatework(State **state, int cpuid);
+// stop the use-case when core 0 is not done gettimeoutcycles() NoC cycles
+// after its first round
+unsigned int gettimeoutcycles();
 void timeoutcheckcore0(State** state);
 
+// Wait hints for the event-driven simulator. A core that stays in its state
+// until something changes tells what it waits for before it returns. The
+// simulator then does not call it again until one of the declared events has
+// happened, skips the rounds where no core can make progress, and reports a
+// deadlock when no core of a use-case can ever make progress. A core without
+// a hint is called every round. On patmos the cores poll and the hints are
+// compiled away, the other backends ignore them.
+//   waitrx:        word w of rx slot rxslot changes
+//   waitnoccycles: getnoccycles() reaches noccycles
+//   waitstate:     the state of core othercore changes
+//   waitidle:      nothing, the core is done or stuck
+#define WAITRXMAX (2 * TDMSLOTS + 2)
+typedef struct CoreWait {
+  bool waiting;
+  // more events than fit: poll
+  bool overflow;
+  int nrx;
+  volatile _SPM int *rxaddr[WAITRXMAX];
+  int rxvalue[WAITRXMAX];
+  bool timed;
+  unsigned int until;
+  int nstate;
+  int statecore[CORES];
+  int statevalue[CORES];
+} CACHEALIGNED CoreWait;
+
+#ifdef RUNONPATMOS
+#define waitrx(cpuid, rxslot, w)
+#define waitnoccycles(cpuid, noccycles)
+#define waitstate(cpuid, othercore)
+#define waitidle(cpuid)
+#else
+// the waits of the use-case that runs (the simulator switches them)
+extern _SIMLOCAL CoreWait *corewaits;
+void waitrx(int cpuid, int rxslot, int w);
+void waitnoccycles(int cpuid, unsigned int noccycles);
+void waitstate(int cpuid, int othercore);
+void waitidle(int cpuid);
+// true when the core has no hint or one of its events has happened
+bool waitready(int cpuid);
+void waitclear(int cpuid);
+#endif
+
 #ifdef RUNONPATMOS
 #define ONEWAY_BASE ((volatile _IODEV int *) 0xE8000000)
 extern volatile _SPM int *alltxmem;
 extern volatile _SPM int *allrxmem;
+#elif defined(RUNONPOSIX)
+// the tx and rx window of each core in a shared memory segment, laid out
+// like the ONEWAY_BASE window of a patmos core (slot j at word j*WORDS)
+extern volatile int *alltxmem[CORES];
+extern volatile int *allrxmem[CORES];
 #else
-extern int alltxmem[CORES][CORES - 1][WORDS];
-extern int allrxmem[CORES][CORES - 1][WORDS];
+extern _SIMLOCAL int alltxmem[CORES][TDMSLOTS][WORDS];
+extern _SIMLOCAL int allrxmem[CORES][TDMSLOTS][WORDS];
 #endif
 
-// get cycles (patmos) or time (pc)
+// get cycles (patmos and verilator) or microseconds (pc: cpu time of the
+// simulator thread, wall time of the posix core processes)
 int getcycles();
+// get cycles (patmos and verilator) or simulated NoC cycles (pc)
+int getnoccycles();
+#if !defined(RUNONPATMOS) && !defined(RUNONPOSIX) && !defined(RUNONVERILATOR)
+// set by the simulator while it records (-t) or replays (-r) a trace: then
+// getcycles() returns getnoccycles(), so the time stamps that the use-cases
+// write into their tx words are the same in the trace and in its replay
+extern _SIMLOCAL bool noctimestamps;
+#endif
+#ifdef RUNONVERILATOR
+// clock cycles of the verilated OneWayMem hardware
+int gethwcycles();
+#endif
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif //  ONEWAYSIM_H
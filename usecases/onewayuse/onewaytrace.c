@@ -0,0 +1,323 @@
+//onewaytrace.c
+#include "onewaytrace.h"
+#include "onewaysim.h"
+#include "onewaykernels.h"
+
+#include <zlib.h>
+
+// the records are collected here and written to the gzip stream when full
+#define TRACEBUFSIZE (64 * 1024)
+
+// the trace is a resource of the process, so it is not part of a snapshot
+static gzFile tracefile;
+static TraceHeader traceheader;
+static unsigned char tracebuf[TRACEBUFSIZE];
+static int tracebuflength;
+// the memories and states as of the last traced round
+static unsigned int *tracetx;
+static unsigned int *tracerx;
+static int *tracestates;
+static unsigned int *traceshared;
+static unsigned int traceround;
+// a round block has been started (writing)
+static bool tracestarted;
+// the shared words of the round as (core, word, value) (reading)
+static int *tracesharedwrites;
+static int ntracesharedwrites;
+// the tag after the records of the current round (reading)
+static int tracetag;
+
+static int traceslotwords() {
+  return traceheader.cores * traceheader.tdmslots * traceheader.words;
+}
+
+static bool tracealloc() {
+  tracetx = calloc(traceslotwords(), sizeof(unsigned int));
+  tracerx = calloc(traceslotwords(), sizeof(unsigned int));
+  tracestates = calloc(traceheader.cores, sizeof(int));
+  traceshared = calloc(traceheader.shared + 1, sizeof(unsigned int));
+  tracesharedwrites = calloc(3 * traceheader.cores * traceheader.shared + 1, sizeof(int));
+  traceround = 0;
+  tracestarted = false;
+  ntracesharedwrites = 0;
+  return tracetx != NULL && tracerx != NULL && tracestates != NULL && traceshared != NULL &&
+    tracesharedwrites != NULL;
+}
+
+static void tracefree() {
+  free(tracetx);
+  free(tracerx);
+  free(tracestates);
+  free(traceshared);
+  free(tracesharedwrites);
+  tracetx = NULL;
+  tracerx = NULL;
+  tracestates = NULL;
+  traceshared = NULL;
+  tracesharedwrites = NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// writing
+///////////////////////////////////////////////////////////////////////////////
+
+static void traceflush() {
+  if (tracebuflength > 0)
+    gzwrite(tracefile, tracebuf, tracebuflength);
+  tracebuflength = 0;
+}
+
+static void traceputc(unsigned char c) {
+  if (tracebuflength == TRACEBUFSIZE)
+    traceflush();
+  tracebuf[tracebuflength++] = c;
+}
+
+static void traceputvarint(unsigned int v) {
+  while (v >= 0x80) {
+    traceputc((v & 0x7f) | 0x80);
+    v >>= 7;
+  }
+  traceputc(v);
+}
+
+static void traceputround(unsigned int round) {
+  if (tracestarted)
+    return;
+  traceputc(TRACEROUND);
+  traceputvarint(round - traceround);
+  traceround = round;
+  tracestarted = true;
+}
+
+// the runs of changed words, and the words copied to old
+static void traceputruns(int first, const int *now, unsigned int *old, int words) {
+  int end = 0;
+  while (first >= 0) {
+    int start = end + first;
+    int last = start;
+    while (last < words && (unsigned int)now[last] != old[last])
+      last++;
+    traceputvarint(start - end);
+    traceputvarint(last - start);
+    for (int w = start; w < last; w++) {
+      traceputvarint(now[w] ^ old[w]);
+      old[w] = now[w];
+    }
+    end = last;
+    first = (end < words) ? kernelcompare(now + end, old + end, words - end) : -1;
+  }
+  traceputvarint(0);
+  traceputvarint(0);
+}
+
+// the changed words of one slot
+static void traceputslot(int tag, int c, int j, unsigned int round,
+                         const int *now, unsigned int *old) {
+  int first = kernelcompare(now, old, traceheader.words);
+  if (first < 0)
+    return;
+  traceputround(round);
+  traceputc(tag);
+  traceputvarint(c);
+  traceputvarint(j);
+  traceputruns(first, now, old, traceheader.words);
+}
+
+bool tracewriteopen(const char *path, const TraceHeader *header) {
+  traceheader = *header;
+  tracefile = gzopen(path, "wb1");
+  if (tracefile == NULL || !tracealloc()) {
+    printf("trace: cannot write %s\n", path);
+    return false;
+  }
+  tracebuflength = 0;
+  for (int i = 0; i < 4; i++)
+    traceputc(TRACEMAGIC[i]);
+  traceputvarint(TRACEVERSION);
+  traceputvarint(header->cores);
+  traceputvarint(header->tdmslots);
+  traceputvarint(header->words);
+  traceputvarint(header->usecase);
+  traceputvarint(header->shared);
+  return true;
+}
+
+void tracewriteshared(unsigned int round, int core, const int *shared) {
+  int first = kernelcompare(shared, traceshared, traceheader.shared);
+  if (first < 0)
+    return;
+  traceputround(round);
+  traceputc(TRACESHARED);
+  traceputvarint(core);
+  traceputruns(first, shared, traceshared, traceheader.shared);
+}
+
+void tracewriteround(unsigned int round, const int *tx, const int *rx, const int *corestates) {
+  for (int c = 0; c < traceheader.cores; c++) {
+    if (corestates[c] != tracestates[c]) {
+      traceputround(round);
+      traceputc(TRACESTATE);
+      traceputvarint(c);
+      traceputvarint(((unsigned int)corestates[c] << 1) ^ (unsigned int)(corestates[c] >> 31));
+      tracestates[c] = corestates[c];
+    }
+  }
+  int words = traceheader.words;
+  for (int c = 0; c < traceheader.cores; c++) {
+    for (int j = 0; j < traceheader.tdmslots; j++) {
+      int i = (c * traceheader.tdmslots + j) * words;
+      traceputslot(TRACETX, c, j, round, tx + i, tracetx + i);
+    }
+  }
+  for (int c = 0; c < traceheader.cores; c++) {
+    for (int j = 0; j < traceheader.tdmslots; j++) {
+      int i = (c * traceheader.tdmslots + j) * words;
+      traceputslot(TRACERX, c, j, round, rx + i, tracerx + i);
+    }
+  }
+  tracestarted = false;
+}
+
+void tracewriteclose(unsigned int rounds) {
+  traceputc(TRACEEND);
+  traceputvarint(rounds);
+  traceflush();
+  gzclose(tracefile);
+  tracefile = NULL;
+  tracefree();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// reading
+///////////////////////////////////////////////////////////////////////////////
+
+static int tracegetc() {
+  int c = gzgetc(tracefile);
+  return c < 0 ? TRACEEND : c;
+}
+
+static unsigned int tracegetvarint() {
+  unsigned int v = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    int c = gzgetc(tracefile);
+    if (c < 0)
+      break;
+    v |= (unsigned int)(c & 0x7f) << shift;
+    if ((c & 0x80) == 0)
+      break;
+  }
+  return v;
+}
+
+// apply the runs of words to old, and to mem, or to the shared writes of
+// core when mem is NULL and core is not -1
+static void tracegetruns(int *mem, unsigned int *old, int words, int core) {
+  int w = 0;
+  for (;;) {
+    w += tracegetvarint();
+    int count = tracegetvarint();
+    if (count == 0)
+      break;
+    for (; count > 0; count--, w++) {
+      unsigned int delta = tracegetvarint();
+      if (w < words) {
+        old[w] ^= delta;
+        if (mem != NULL) {
+          mem[w] = old[w];
+        } else if (core >= 0 && ntracesharedwrites < traceheader.cores * traceheader.shared) {
+          int *write = &tracesharedwrites[3 * ntracesharedwrites++];
+          write[0] = core;
+          write[1] = w;
+          write[2] = old[w];
+        }
+      }
+    }
+  }
+}
+
+// apply the runs of one slot
+static void tracegetslot(int *mem, unsigned int *old) {
+  int c = tracegetvarint();
+  int j = tracegetvarint();
+  bool valid = c < traceheader.cores && j < traceheader.tdmslots;
+  int i = valid ? (c * traceheader.tdmslots + j) * traceheader.words : 0;
+  tracegetruns((mem != NULL) ? mem + i : NULL, old + i, valid ? traceheader.words : 0, -1);
+}
+
+bool tracereadopen(const char *path, TraceHeader *header) {
+  tracefile = gzopen(path, "rb");
+  char magic[4];
+  if (tracefile == NULL || gzread(tracefile, magic, 4) != 4 ||
+      memcmp(magic, TRACEMAGIC, 4) != 0 || tracegetvarint() != TRACEVERSION) {
+    printf("trace: %s is not a trace\n", path);
+    if (tracefile != NULL)
+      gzclose(tracefile);
+    tracefile = NULL;
+    return false;
+  }
+  header->cores = tracegetvarint();
+  header->tdmslots = tracegetvarint();
+  header->words = tracegetvarint();
+  header->usecase = tracegetvarint();
+  header->shared = tracegetvarint();
+  traceheader = *header;
+  if (!tracealloc()) {
+    gzclose(tracefile);
+    tracefile = NULL;
+    return false;
+  }
+  tracetag = tracegetc();
+  return true;
+}
+
+bool tracereadround(unsigned int *round) {
+  if (tracetag != TRACEROUND) {
+    *round = (tracetag == TRACEEND) ? tracegetvarint() : traceround;
+    tracetag = -1;
+    return false;
+  }
+  traceround += tracegetvarint();
+  *round = traceround;
+  return true;
+}
+
+void tracereadapply(int *tx, int *rx, int *corestates) {
+  ntracesharedwrites = 0;
+  for (;;) {
+    tracetag = tracegetc();
+    if (tracetag == TRACESTATE) {
+      int c = tracegetvarint();
+      unsigned int z = tracegetvarint();
+      if (c < traceheader.cores) {
+        tracestates[c] = (int)(z >> 1) ^ -(int)(z & 1);
+        if (corestates != NULL)
+          corestates[c] = tracestates[c];
+      }
+    } else if (tracetag == TRACETX) {
+      tracegetslot(tx, tracetx);
+    } else if (tracetag == TRACERX) {
+      tracegetslot(rx, tracerx);
+    } else if (tracetag == TRACESHARED) {
+      int c = tracegetvarint();
+      tracegetruns(NULL, traceshared, traceheader.shared, c < traceheader.cores ? c : -1);
+    } else {
+      return;
+    }
+  }
+}
+
+void tracereadshared(int core, int *shared) {
+  for (int i = 0; i < ntracesharedwrites; i++) {
+    const int *write = &tracesharedwrites[3 * i];
+    if (write[0] == core)
+      shared[write[1]] = write[2];
+  }
+}
+
+void tracereadclose() {
+  if (tracefile != NULL)
+    gzclose(tracefile);
+  tracefile = NULL;
+  tracefree();
+}
@@ -0,0 +1,74 @@
+//onewaytrace.h
+#ifndef ONEWAYTRACE_H
+#define ONEWAYTRACE_H
+
+#include <stdbool.h>
+
+// Binary trace of the simulated NoC traffic (PC simulator only, uses zlib).
+//
+// A trace is a gzip stream with a header (the magic "OWTR", the version,
+// CORES, TDMSLOTS, WORDS, the use-case id, and the words of the shared data)
+// followed by one block per round in which something changed:
+//   TRACEROUND  round - previous traced round
+//   TRACESTATE  core, state                  (a core that changed its state)
+//   TRACETX     core, slot, runs of words    (the tx words the cores wrote)
+//   TRACERX     core, slot, runs of words    (the words that the NoC delivered)
+//   TRACESHARED core, runs of words          (the shared data a core wrote)
+// and a final TRACEEND with the number of simulated rounds. A run is the
+// words skipped since the previous run, the word count, and each word as the
+// xor with its previous value; a count of 0 ends the runs of a slot. All
+// numbers are LEB128 varints, the states zigzag encoded. The tx and rx words
+// are the difference to the previous round, so a word that is written twice
+// in one round is traced once, with its value at the end of the round. The
+// shared data (the _UNCACHED data of the use-cases) is traced after each call
+// of a core, so that a replay can apply it in the order of the cores.
+
+#define TRACEMAGIC "OWTR"
+#define TRACEVERSION 2
+
+#define TRACEEND 0
+#define TRACEROUND 1
+#define TRACESTATE 2
+#define TRACETX 3
+#define TRACERX 4
+#define TRACESHARED 5
+
+// dimensions and use-case of a trace
+typedef struct TraceHeader {
+  int cores;
+  int tdmslots;
+  int words;
+  int usecase;
+  // words of the shared data
+  int shared;
+} TraceHeader;
+
+// start a trace of one use-case, the tx and rx memories start out cleared
+bool tracewriteopen(const char *path, const TraceHeader *header);
+
+// trace the shared data [shared] after a core was called in a round
+void tracewriteshared(unsigned int round, int core, const int *shared);
+
+// trace a round: tx and rx are [cores][tdmslots][words], corestates [cores]
+void tracewriteround(unsigned int round, const int *tx, const int *rx, const int *corestates);
+
+// end the trace after the given number of rounds
+void tracewriteclose(unsigned int rounds);
+
+// open a trace for replay
+bool tracereadopen(const char *path, TraceHeader *header);
+
+// the next traced round, false at the end of the trace, where round is the
+// number of simulated rounds
+bool tracereadround(unsigned int *round);
+
+// apply the words and states of the round to the traced memories and states
+void tracereadapply(int *tx, int *rx, int *corestates);
+
+// apply the shared data that core wrote in the round (only the words that
+// changed are written)
+void tracereadshared(int core, int *shared);
+
+void tracereadclose();
+
+#endif
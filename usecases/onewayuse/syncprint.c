@@ -17,11 +17,12 @@
 //  call sync_printall to print them after the most
 //  important code has run.
 //  don't not use sync_printf when running cycle accurate code (e.g. wcet)
-static char strings[PRINTCORES][SYNCPRINTBUF][LINECHARS];
+//  the buffers are _SHARED so core 0 can print the messages of core processes
+static _SHARED char strings[PRINTCORES][SYNCPRINTBUF][LINECHARS] CACHEALIGNED;
 // clock cycles
-static unsigned long timestamps[PRINTCORES][SYNCPRINTBUF];
+static _SHARED unsigned long timestamps[PRINTCORES][SYNCPRINTBUF] CACHEALIGNED;
 // message counter per core
-static int mi[PRINTCORES];
+static _SHARED PrintCursor cursors[PRINTCORES];
 
 // make sync_printf and info_printf thread safe
 static volatile _UNCACHED int printtoken = -1;
@@ -34,17 +35,17 @@ void sync_printf(const int cid, const char *format, ...)
   //while(printtoken != -1){};
   
   printtoken = cid;
-  if (mi[cid] < SYNCPRINTBUF)
+  if (cursors[cid].mi < SYNCPRINTBUF)
   {
     int val = 0;
-    timestamps[cid][mi[cid]] = getcycles(); //(unsigned long)val;
+    timestamps[cid][cursors[cid].mi] = getcycles(); //(unsigned long)val;
     va_list args;
     va_start(args, format);
-    vsprintf(&strings[cid][mi[cid]][0], format, args);
+    vsprintf(&strings[cid][cursors[cid].mi][0], format, args);
     // enable the next line for "peeking at syncprintf"
-    //printf("Syncprint: %s", &strings[cid][mi[cid]][0]);
+    //printf("Syncprint: %s", &strings[cid][cursors[cid].mi][0]);
     va_end(args);
-    mi[cid]++;
+    cursors[cid].mi++;
   }
   printtoken = -1;
 }
@@ -69,7 +70,7 @@ void sync_printall()
     unsigned long smallest = 0xffffffff;
     for (int c = 0; c < PRINTCORES; c++)
     {
-      if (minmark[c] < mi[c])
+      if (minmark[c] < cursors[c].mi)
       {
         if (timestamps[c][minmark[c]] <= smallest)
         {
@@ -78,16 +79,16 @@ void sync_printall()
         }
       }
     }
-    printf("[cycle=%'lu, core=%d, msg#=%2d] %s", 
-           timestamps[closestcoreid][minmark[closestcoreid]], closestcoreid,
-           minmark[closestcoreid], strings[closestcoreid][minmark[closestcoreid]]);
+    sweepprintf("[cycle=%'lu, core=%d, msg#=%2d] %s", 
+                timestamps[closestcoreid][minmark[closestcoreid]], closestcoreid,
+                minmark[closestcoreid], strings[closestcoreid][minmark[closestcoreid]]);
     
     minmark[closestcoreid]++;
     print = false;
     for (int c = 0; c < PRINTCORES; c++)
     {
       // are we done?
-      if (minmark[c] < mi[c])
+      if (minmark[c] < cursors[c].mi)
       {
         print = true;
         break;
@@ -116,7 +117,7 @@ void sync_print_core(int id)
     unsigned long smallest = 0xffffffff;
     for (int c = 0; c < PRINTCORES; c++)
     {
-      if (minmark[c] < mi[c])
+      if (minmark[c] < cursors[c].mi)
       {
         if (timestamps[c][minmark[c]] <= smallest)
         {
@@ -126,10 +127,10 @@ void sync_print_core(int id)
       }
     }
     if (closestcoreid == id){
-      printf("  [cyc%06d cpuid%02d #%02d] %s", 
-             (int)timestamps[closestcoreid][minmark[closestcoreid]], 
-             closestcoreid, minmark[closestcoreid], 
-             strings[closestcoreid][minmark[closestcoreid]]);
+      sweepprintf("  [cyc%06d cpuid%02d #%02d] %s", 
+                  (int)timestamps[closestcoreid][minmark[closestcoreid]], 
+                  closestcoreid, minmark[closestcoreid], 
+                  strings[closestcoreid][minmark[closestcoreid]]);
     }
 
     minmark[closestcoreid]++;
@@ -137,7 +138,7 @@ void sync_print_core(int id)
     for (int c = 0; c < PRINTCORES; c++)
     {
       // done?
-      if (minmark[c] < mi[c])
+      if (minmark[c] < cursors[c].mi)
       {
         print = true;
         break;
@@ -145,3 +146,10 @@ void sync_print_core(int id)
     }
   }
 }
+
+// drop all messages
+void sync_printreset()
+{
+  for (int c = 0; c < PRINTCORES; c++)
+    cursors[c].mi = 0;
+}
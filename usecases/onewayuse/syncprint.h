@@ -26,6 +26,10 @@
 // configure max. chars per line
 #define LINECHARS    120
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 // Example: sync_printf(cid, "Core %d got new buffer...\n", cid);
 void sync_printf(int, const char *format, ...);
 
@@ -35,5 +39,11 @@ void sync_printf(int, const char *format, ...);
 void sync_printall();
 // Printing just for one core at a time
 void sync_print_core(int id);
+// Drop all collected messages (e.g., before the next use-case runs)
+void sync_printreset();
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif